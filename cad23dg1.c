@@ -1,5 +1,6 @@
 /* Simple CLI converter: .cad -> .txt
  * Usage: cad23dg1 <input.cad> [output.txt]
+ *        cad23dg1 --flat-check <input.cad>   (list non-planar faces, no export)
  */
 // A little CLI frontend so I can use the existing components to convert Iwamoto 3D-CAD files to Fundoshi-Kun format - Sunlit
 
@@ -11,11 +12,31 @@
 #include "cad_export_3dg1.h"
 #include "cad_core.h"
 
+/* Batch planarity audit: one line per non-planar face, exit code 4 if any */
+static int flat_check(CadCore* core, const char* inpath) {
+    int count = CadCore_FlatCheck(core, CAD_FLAT_TOLERANCE, NULL, 0);
+    if (count < 0) return 2;
+    CadIndex* warped = (CadIndex*)malloc((size_t)(count > 0 ? count : 1) * sizeof(CadIndex));
+    if (!warped) return 2;
+    CadCore_FlatCheck(core, CAD_FLAT_TOLERANCE, warped, count);
+    for (int i = 0; i < count; i++) {
+        fprintf(stdout, "%s: polygon %d deviation %.6f\n", inpath, (int)warped[i],
+                CadCore_GetPolygonDeviation(core, warped[i]));
+    }
+    fprintf(stdout, "%s: %d non-planar faces (tolerance %g)\n", inpath, count, CAD_FLAT_TOLERANCE);
+    free(warped);
+    return count > 0 ? 4 : 0;
+}
+
 int main(int argc, char** argv) {
-    if (argc < 2) {
+    int check_flat = argc >= 2 && strcmp(argv[1], "--flat-check") == 0;
+    if (argc < 2 + check_flat) {
         fprintf(stderr, "Usage: %s <input.cad> [output.txt]\n", argc > 0 ? argv[0] : "cad23dg1");
+        fprintf(stderr, "       %s --flat-check <input.cad>\n", argc > 0 ? argv[0] : "cad23dg1");
         return 1;
     }
+    argv += check_flat;
+    argc -= check_flat;
 
     const char* inpath = argv[1];
     char outpath[1024];
@@ -39,18 +60,34 @@ int main(int argc, char** argv) {
         }
     }
 
+    /* Load through the core so the live-slot index used by the exporter is built */
     CadCore core;
-    memset(&core, 0, sizeof(core));
+    CadCore_Init(&core);
 
-    if (!CadFile_Load(inpath, &core.data)) {
+    if (!CadCore_LoadFile(&core, inpath)) {
         fprintf(stderr, "Failed to load CAD file '%s'\n", inpath);
+        CadCore_Destroy(&core);
         return 2;
     }
 
-    if (!CadExport_3DG1(&core, outpath)) {
+    if (check_flat) {
+        int status = flat_check(&core, inpath);
+        CadCore_Destroy(&core);
+        return status;
+    }
+
+    int off_points, off_objects, duplicates;
+    CadCore_GetMergeStatus(&core, &off_points, &off_objects, &duplicates);
+    fprintf(stdout, "Merge status: %d off-grid points, %d off-grid objects, %d duplicate edges%s\n",
+            off_points, off_objects, duplicates,
+            off_points == 0 && off_objects == 0 && duplicates == 0 ? " (fully merged)" : "");
+
+    if (!CadExport_3DG1(&core, outpath, NULL)) {
         fprintf(stderr, "Failed to export Fundoshi-Kun file '%s'\n", outpath);
+        CadCore_Destroy(&core);
         return 3;
     }
 
+    CadCore_Destroy(&core);
     return 0;
 }
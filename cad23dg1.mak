@@ -1,10 +1,10 @@
 # Makefile to build my little command line frontend for the components I've cherrypicked
-# replaces gcc -Iinclude src/cad_file.c src/cad_export_3dg1.c cad23dg1.c -o cad23dg1.exe
+# replaces gcc -Iinclude src/cad_file.c src/cad_core.c src/cad_export_3dg1.c cad23dg1.c -o cad23dg1.exe
 
 CC := gcc
-CFLAGS := -O2 -Wall
+CFLAGS := -O2 -Wall -fopenmp
 INCLUDES := -Iinclude
-SRCS := src/cad_file.c src/cad_export_3dg1.c cad23dg1.c
+SRCS := src/cad_file.c src/cad_core.c src/cad_export_3dg1.c cad23dg1.c
 TARGET := cad23dg1.exe
 
 .PHONY: all clean
@@ -7,6 +7,7 @@
 
 #include "cad_file.h"
 #include <stdint.h>
+#include <stddef.h>
 
 /* ----------------------------------------------------------------------------
    Constants
@@ -25,14 +26,308 @@ typedef enum {
 
 /* ----------------------------------------------------------------------------
    Selection state
+   Sparse sets: a dense list of selected indices plus a per-slot position
+   in that list, giving O(1) select, deselect and membership and a clear
+   proportional to the selection size. Deselect moves the last entry into
+   the hole, so list order is selection order only until the first deselect.
    ---------------------------------------------------------------------------- */
 typedef struct {
-    int16_t selectedPoints[CAD_MAX_POINTS];
-    int16_t selectedPolygons[CAD_MAX_POLYGONS];
+    CadIndex* selectedPoints;    /* Dense list, sized to the point pool capacity */
+    CadIndex* selectedPolygons;  /* Dense list, sized to the polygon pool capacity */
+    CadIndex* pointSlot;         /* Per point: position in selectedPoints (-1 = not selected) */
+    CadIndex* polygonSlot;       /* Per polygon: position in selectedPolygons */
     int pointCount;
     int polygonCount;
 } CadSelection;
 
+/* ----------------------------------------------------------------------------
+   Free slot lists
+   Stacks of deleted slots below each pool's high-water mark, so that
+   allocation pops a slot in O(1) instead of scanning for flags == 0
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    CadIndex* freePoints;        /* Sized to the matching pool capacity */
+    CadIndex* freePolygons;
+    CadIndex* freeObjects;
+    int pointCount;
+    int polygonCount;
+    int objectCount;
+} CadFreeList;
+
+/* ----------------------------------------------------------------------------
+   Live-slot bitsets
+   One bit per pool slot (set while flags != 0) and running active counts,
+   maintained by the add/delete functions. Live elements are enumerated a
+   64-bit word at a time with CadCore_NextLivePoint and friends.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    uint64_t* points;            /* (capacity + 63) / 64 words per pool */
+    uint64_t* polygons;
+    uint64_t* objects;
+    int pointCount;              /* Active elements */
+    int polygonCount;
+    int objectCount;
+} CadLiveSlots;
+
+/* ----------------------------------------------------------------------------
+   Point-to-polygon adjacency
+   One node per (polygon, vertex) pair. Each node sits in its point's use
+   list (doubly linked) and in its polygon's node list, so a polygon's
+   membership can be dropped in O(npoints) and a point's users listed in
+   O(uses). Maintained by the add/delete/link operations below.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    CadIndex polygon;            /* Polygon using the point */
+    CadIndex point;              /* Vertex */
+    CadIndex nextInPoint;        /* Next use of the same point (-1 = end) */
+    CadIndex prevInPoint;        /* Previous use of the same point (-1 = head) */
+    CadIndex nextInPolygon;      /* Next node of the same polygon / free list link */
+} CadUseNode;
+
+typedef struct {
+    CadIndex* pointFirstUse;     /* Per point, sized to pool capacity (-1 = orphan) */
+    CadIndex* polygonFirstUse;   /* Per polygon, sized to pool capacity */
+    CadUseNode* nodes;
+    int nodeCount;               /* High-water mark */
+    int nodeCapacity;
+    CadIndex freeNode;           /* Head of the free node list (-1 = none) */
+} CadAdjacency;
+
+/* ----------------------------------------------------------------------------
+   Flattened polygon index
+   Compressed-sparse-row copy of the vertex chains: polygon i's vertices are
+   vertices[offsets[i] .. offsets[i + 1]), walked like the renderer walks
+   them (npoints vertices, stopping at an invalid or repeated point); dead
+   slots are empty. Built in one pass on first use and rebuilt once the
+   polygon topology generation (see change tracking) moves on.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    CadIndex* offsets;           /* polygonCount + 1 entries */
+    CadIndex* vertices;
+    int polygonCount;            /* Polygon high-water mark when built */
+    int vertexCount;
+    int offsetCapacity;
+    int vertexCapacity;
+    uint32_t generation;         /* Polygon topology generation it was built from */
+} CadPolygonIndex;
+
+/* ----------------------------------------------------------------------------
+   Point spatial hash
+   Uniform grid of CAD_SPATIAL_CELL_SIZE cubes hashed into a power-of-two
+   bucket table; each bucket chains its points through per-point links.
+   Add, move and delete re-bucket one point in O(1). Whole-model edits
+   (load, clear, compaction, snapshot restore) invalidate it and the next
+   query rebuilds it in one pass.
+   ---------------------------------------------------------------------------- */
+#define CAD_SPATIAL_CELL_SIZE 1.0  /* World units per cell edge (the merge grid) */
+
+typedef struct {
+    CadIndex* buckets;           /* Head point per bucket (-1 = empty) */
+    int bucketCount;             /* Power of two */
+    CadIndex* next;              /* Per point, sized to pool capacity */
+    CadIndex* prev;
+    CadIndex* bucket;            /* Per point: bucket holding it (-1 = not indexed) */
+    int pointCount;              /* Indexed points */
+    int valid;                   /* 0 = rebuild before the next query */
+} CadSpatialHash;
+
+/* ----------------------------------------------------------------------------
+   Merge status
+   Running counts behind the merge checks, so querying them is O(1):
+   points with a coordinate off the integer grid (a bit per point, updated
+   when a point is added, moved or deleted), duplicate edges of the vertex
+   walks (consecutive vertices in one grid cell, closing edge included;
+   a count per polygon, retaken when the polygon is relinked and for the
+   users of a moved point) and off-grid objects (recounted when the object
+   geometry generation moves on; objects are few). Whole-model edits
+   invalidate it and the next query recounts in one pass.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    uint64_t* pointOffGrid;      /* Per point, sized to pool capacity */
+    uint8_t* polygonDuplicates;  /* Per polygon: duplicate edges counted */
+    int offGridPoints;
+    int offGridObjects;
+    int duplicateEdges;
+    uint32_t objectGeometry;     /* Objects generation offGridObjects was counted at */
+    int valid;                   /* 0 = recount before the next query */
+} CadMergeStatus;
+
+/* ----------------------------------------------------------------------------
+   Flat check cache
+   Per polygon: the unit Newell normal of its walk and the largest distance
+   of a vertex from the plane through the walk's centroid, kept until the
+   polygon is relinked or one of its points moves (a bit per polygon says
+   which entries are current). CadCore_FlatCheck recomputes the stale ones.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    double* deviation;           /* Per polygon, sized to pool capacity */
+    double* normal;              /* Per polygon: x, y, z (0 if degenerate) */
+    uint64_t* current;           /* Per polygon: entry is up to date */
+} CadFlatCache;
+
+/* ----------------------------------------------------------------------------
+   Polygon sort tree
+   BSP tree built by CadCore_SortPolygons, flattened into arrays: nodes in
+   pre-order (a node's front subtree follows it, then its back subtree) and
+   each node's faces, the ones lying in its plane, as a run of faces[] in
+   the same order. Any eye position walks it back to front in O(n). Valid
+   while the point geometry and polygon generations it was built at hold.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    double plane[4];             /* Unit normal and offset: front side has n.p > d */
+    CadIndex front;              /* Child nodes (-1 = none) */
+    CadIndex back;
+    int firstFace;               /* Run of faces[] lying in the plane */
+    int faceCount;
+} CadBspNode;
+
+typedef struct {
+    CadBspNode* nodes;
+    int nodeCount;
+    int nodeCapacity;
+    CadIndex* faces;             /* Polygon indices, node by node */
+    int faceCount;
+    int faceCapacity;
+    uint32_t pointGeometry;      /* Generations it was built at (0 = none) */
+    uint32_t polygonGeometry;
+    uint32_t polygonTopology;
+} CadBspTree;
+
+/* ----------------------------------------------------------------------------
+   Object hierarchy
+   Live objects flattened depth-first along parentObject, children in index
+   order, so each subtree is the run order[position[o] .. subtreeEnd[o]).
+   Roots are objects without a live parent; a parent cycle is broken at its
+   lowest index. world[] accumulates the offsets down the tree. A point
+   belongs to the first object in that order whose group walks it, and
+   owned points are listed object by object in the same order, so a
+   subtree's points are a run of points[] as well. World coordinates are
+   kept per point (local + owner's world offset); while every offset is
+   zero they are the model's own arrays. The order is rebuilt when the
+   object, polygon or point topology changes, the offsets when the object
+   geometry does; CadCore_SetObjectOffset refreshes just its subtree.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    CadIndex* order;             /* Objects, depth-first */
+    int count;
+    CadIndex* position;          /* Per object: index in order (-1 = dead) */
+    CadIndex* subtreeEnd;        /* Per object: one past its last descendant in order */
+    CadIndex* parent;            /* Per object: parent in the tree (-1 = root) */
+    double* world;               /* Per object: accumulated offset x, y, z */
+    CadIndex* polygonObject;     /* Per polygon: object whose group walks it (-1 = ungrouped) */
+    CadIndex* pointObject;       /* Per point: owning object (-1 = none) */
+    int* pointStart;             /* Per order position, plus an end: run of points[] owned */
+    CadIndex* points;
+    double* worldX;              /* Per point: world position (unused while identity) */
+    double* worldY;
+    double* worldZ;
+    int identity;                /* Every world offset is zero */
+    int objectCapacity;          /* Allocated entries of the per-object ... */
+    int polygonCapacity;         /* ... per-polygon ... */
+    int pointCapacity;           /* ... and per-point arrays */
+    uint32_t objectTopology;     /* Generations it is current for (0 = none) */
+    uint32_t objectGeometry;
+    uint32_t polygonTopology;
+    uint32_t pointTopology;
+    uint32_t pointGeometry;      /* World coordinates */
+} CadHierarchy;
+
+/* ----------------------------------------------------------------------------
+   Change tracking
+   Per-pool generation counters, bumped by every mutating CadCore function:
+   geometry for coordinate/attribute edits, topology for relinks, both for
+   add and delete. Derived data records the generation it was built from and
+   rebuilds when it differs. The dirty range is the span of slots touched
+   since the last CadCore_ClearDirtyRanges (first > last when none); the
+   GUI clears them once per frame after drawing the views.
+   Generation 0 is never current, so a zeroed cache always starts stale.
+   Independently, a bit per CAD_SNAPSHOT_PAGE_SLOTS slots records writes
+   since the model last matched the snapshot base (see Snapshots); selection
+   flag changes set it too.
+   ---------------------------------------------------------------------------- */
+#define CAD_SNAPSHOT_PAGE_SHIFT 8
+#define CAD_SNAPSHOT_PAGE_SLOTS (1 << CAD_SNAPSHOT_PAGE_SHIFT)
+
+typedef struct {
+    uint32_t geometry;
+    uint32_t topology;
+    CadIndex dirtyFirst;
+    CadIndex dirtyLast;
+    uint64_t* snapshotPages;     /* Pages written since the last capture/restore */
+} CadPoolChanges;
+
+typedef struct {
+    CadPoolChanges points;       /* geometry = coordinates, topology = slots and nextPoint links */
+    CadPoolChanges polygons;     /* topology = slots and vertex walks */
+    CadPoolChanges objects;      /* geometry = offsets, topology = slots and links */
+} CadChangeTracker;
+
+/* ----------------------------------------------------------------------------
+   Undo journal
+   Inverse deltas recorded by the mutating functions: the prior contents of
+   every record an edit group touches (once per group) plus the free-slot
+   pops and pushes it made. Undo and redo swap those records back in
+   reverse or forward order, so they cost the size of the edit, not the
+   model. Groups nest; every mutator opens an implicit one, and the GUI
+   wraps a drag in an explicit group so it undoes as one step. Oldest
+   groups are dropped once the retained deltas exceed limitBytes.
+   Rebuilding the free lists (load, clear, compaction) resets the history.
+   ---------------------------------------------------------------------------- */
+#define CAD_UNDO_DEFAULT_LIMIT (8u << 20)  /* Bytes of retained deltas */
+
+typedef enum {
+    CAD_DELTA_POINT = 0,         /* Prior point record and coordinates */
+    CAD_DELTA_POLYGON,           /* Prior polygon record */
+    CAD_DELTA_OBJECT,            /* Prior object record */
+    CAD_DELTA_ALLOC,             /* Slot taken from the free list or the high-water mark */
+    CAD_DELTA_FREE               /* Slot pushed onto the free list */
+} CadDeltaKind;
+
+typedef enum {
+    CAD_POOL_POINTS = 0,
+    CAD_POOL_POLYGONS,
+    CAD_POOL_OBJECTS
+} CadPoolKind;
+
+typedef struct {
+    uint8_t kind;                /* CadDeltaKind */
+    uint8_t pool;                /* CadPoolKind (ALLOC/FREE) */
+    uint8_t fromFreeList;        /* ALLOC: popped (1) or appended at the high-water mark (0) */
+    CadIndex index;
+    union {
+        struct {
+            CadPoint record;
+            double x, y, z;
+        } point;
+        CadPolygon polygon;
+        CadObject object;
+    } u;                         /* Swapped with the live record on undo/redo */
+} CadDelta;
+
+typedef struct {
+    int firstDelta;
+    int deltaCount;
+} CadUndoGroup;
+
+typedef struct {
+    CadDelta* deltas;
+    int deltaCount;
+    int deltaCapacity;
+    CadUndoGroup* groups;
+    int groupCount;              /* Closed groups, undone ones included */
+    int groupCapacity;
+    int groupBase;               /* Oldest retained group */
+    int cursor;                  /* [groupBase, cursor) undoable, [cursor, groupCount) redoable */
+    int depth;                   /* Open group nesting */
+    int openFirst;               /* First delta of the open group (-1 = none yet) */
+    int replaying;               /* Set while undo/redo applies deltas */
+    int failed;                  /* Open group lost to an allocation failure */
+    size_t limitBytes;
+    uint64_t* pointRecorded;     /* Per-slot bits: already recorded by the open group */
+    uint64_t* polygonRecorded;
+    uint64_t* objectRecorded;
+} CadJournal;
+
 /* ----------------------------------------------------------------------------
    Core CAD state
    ---------------------------------------------------------------------------- */
@@ -46,12 +341,48 @@ typedef struct {
     /* Selection */
     CadSelection selection;
     
+    /* Slot allocation */
+    CadFreeList freeList;
+    CadLiveSlots live;
+    
+    /* Point-to-polygon reverse index */
+    CadAdjacency adjacency;
+    
+    /* Cached CSR view of the polygon chains (see CadCore_GetPolygonIndex) */
+    CadPolygonIndex polygonIndex;
+    
+    /* Point coordinates bucketed by grid cell (see CadCore_FindPointsNear) */
+    CadSpatialHash spatial;
+    
+    /* Off-grid and duplicate-edge counts (see CadCore_GetMergeStatus) */
+    CadMergeStatus mergeStatus;
+    
+    /* Planarity per polygon (see CadCore_FlatCheck) */
+    CadFlatCache flatCache;
+    
+    /* Painter's order of the faces (see CadCore_SortPolygons) */
+    CadBspTree bsp;
+    
+    /* Depth-first objects and world positions (see CadCore_GetHierarchy) */
+    CadHierarchy hierarchy;
+    
+    /* Capacity the selection, free-list, live-slot and adjacency arrays are sized for */
+    int pointCapacity;
+    int polygonCapacity;
+    int objectCapacity;
+    
     /* Active editing */
-    int16_t newPoint;         /* Most recently registered point */
-    int16_t newPolygon;       /* Most recently registered polygon */
-    int16_t rootPolygon;      /* Previously registered polygon */
-    int16_t creatingPoint;   /* Previously registered point */
-    int16_t firstPoint;       /* First point */
+    CadIndex newPoint;         /* Most recently registered point */
+    CadIndex newPolygon;       /* Most recently registered polygon */
+    CadIndex rootPolygon;      /* Previously registered polygon */
+    CadIndex creatingPoint;   /* Previously registered point */
+    CadIndex firstPoint;       /* First point */
+    
+    /* Change generations and dirty ranges for derived data */
+    CadChangeTracker changes;
+    
+    /* Undo/redo history */
+    CadJournal journal;
     
     /* Dirty flag */
     int isDirty;             /* Has unsaved changes */
@@ -64,6 +395,20 @@ void CadCore_Init(CadCore* core);
 void CadCore_Destroy(CadCore* core);
 void CadCore_Clear(CadCore* core);
 
+/* Rebuild free slot lists, live-slot bitsets and active counts from record
+   flags (after loading or bulk edits) */
+void CadCore_RebuildFreeLists(CadCore* core);
+
+/* Rebuild the point-to-polygon index from the chains (after loading or bulk edits) */
+void CadCore_RebuildAdjacency(CadCore* core);
+
+/* Reserve pool capacity up front (0 leaves a pool unchanged).
+   Returns 0 on allocation failure or if a count exceeds CAD_MAX_INDEX + 1. */
+int CadCore_Reserve(CadCore* core, int objects, int polygons, int points);
+
+/* Reset every pool's dirty range to empty (generations keep counting) */
+void CadCore_ClearDirtyRanges(CadCore* core);
+
 /* ----------------------------------------------------------------------------
    File operations
    ---------------------------------------------------------------------------- */
@@ -73,40 +418,92 @@ int CadCore_SaveFile(CadCore* core, const char* filename);
 /* ----------------------------------------------------------------------------
    Point operations
    ---------------------------------------------------------------------------- */
-int16_t CadCore_AddPoint(CadCore* core, double x, double y, double z);
-int CadCore_DeletePoint(CadCore* core, int16_t pointIndex);
-CadPoint* CadCore_GetPoint(CadCore* core, int16_t index);
-int CadCore_IsPointValid(CadCore* core, int16_t index);
+CadIndex CadCore_AddPoint(CadCore* core, double x, double y, double z);
+int CadCore_DeletePoint(CadCore* core, CadIndex pointIndex);
+CadPoint* CadCore_GetPoint(CadCore* core, CadIndex index);
+int CadCore_IsPointValid(CadCore* core, CadIndex index);
+
+/* Point coordinates (stored as structure of arrays in core->data) */
+int CadCore_GetPointPosition(const CadCore* core, CadIndex index, double* x, double* y, double* z);
+int CadCore_SetPointPosition(CadCore* core, CadIndex index, double x, double y, double z);
+int CadCore_MovePoint(CadCore* core, CadIndex index, double dx, double dy, double dz);
+
+/* List live points within radius of (x, y, z), in no particular order.
+   Fills up to maxCount entries of out (may be NULL) and returns the total
+   number found. Only the cells overlapping the query sphere are visited. */
+int CadCore_FindPointsNear(const CadCore* core, double x, double y, double z, double radius,
+                           CadIndex* out, int maxCount);
 
 /* ----------------------------------------------------------------------------
    Polygon operations
    ---------------------------------------------------------------------------- */
-int16_t CadCore_AddPolygon(CadCore* core, int16_t firstPoint, uint8_t color, uint8_t npoints);
-int CadCore_DeletePolygon(CadCore* core, int16_t polygonIndex);
-CadPolygon* CadCore_GetPolygon(CadCore* core, int16_t index);
-int CadCore_IsPolygonValid(CadCore* core, int16_t index);
-int CadCore_AddPointToPolygon(CadCore* core, int16_t polygonIndex, int16_t pointIndex);
+CadIndex CadCore_AddPolygon(CadCore* core, CadIndex firstPoint, uint8_t color, uint8_t npoints);
+int CadCore_DeletePolygon(CadCore* core, CadIndex polygonIndex);
+CadPolygon* CadCore_GetPolygon(CadCore* core, CadIndex index);
+int CadCore_IsPolygonValid(CadCore* core, CadIndex index);
+int CadCore_AddPointToPolygon(CadCore* core, CadIndex polygonIndex, CadIndex pointIndex);
+
+/* Relink a point's chain successor (updates every polygon passing through it) */
+int CadCore_SetNextPoint(CadCore* core, CadIndex pointIndex, CadIndex nextPoint);
+
+/* Flattened polygon index, rebuilt first if the topology changed since the
+   last call. Returns NULL on allocation failure. The pointer stays valid
+   until the next topology edit. */
+const CadPolygonIndex* CadCore_GetPolygonIndex(const CadCore* core);
+
+/* List polygons whose vertex chain uses a point. Fills up to maxCount
+   entries of out (may be NULL) and returns the total number of uses. */
+int CadCore_GetPointPolygons(CadCore* core, CadIndex pointIndex, CadIndex* out, int maxCount);
 
 /* ----------------------------------------------------------------------------
    Object operations
    ---------------------------------------------------------------------------- */
-int16_t CadCore_AddObject(CadCore* core, int16_t parentObject, double ox, double oy, double oz);
-int CadCore_DeleteObject(CadCore* core, int16_t objectIndex);
-CadObject* CadCore_GetObject(CadCore* core, int16_t index);
-int CadCore_IsObjectValid(CadCore* core, int16_t index);
+
+/* New objects are appended to their parent's child list (childObject /
+   nextBrother); roots (parentObject -1, or not a live object) to the
+   sibling chain of the first root. Deleting unlinks the object; its
+   children become roots. */
+CadIndex CadCore_AddObject(CadCore* core, CadIndex parentObject, double ox, double oy, double oz);
+int CadCore_DeleteObject(CadCore* core, CadIndex objectIndex);
+CadObject* CadCore_GetObject(CadCore* core, CadIndex index);
+int CadCore_IsObjectValid(CadCore* core, CadIndex index);
+
+/* Set an object's offset from its parent. Refreshes the cached world
+   offsets and point positions of its subtree only. */
+int CadCore_SetObjectOffset(CadCore* core, CadIndex objectIndex, double ox, double oy, double oz);
+
+/* ----------------------------------------------------------------------------
+   Object hierarchy
+   ---------------------------------------------------------------------------- */
+
+/* Depth-first object order and world offsets, refreshed first if stale.
+   Returns NULL on allocation failure. */
+const CadHierarchy* CadCore_GetHierarchy(const CadCore* core);
+
+/* Accumulated offset of an object; zero for an invalid one.
+   Returns 0 if the object is invalid or on allocation failure. */
+int CadCore_GetObjectWorldOffset(const CadCore* core, CadIndex objectIndex, double out[3]);
+
+/* World coordinates of every point slot, indexed like data.pointX..Z.
+   The arrays stay valid until the next edit. Returns 0 on allocation
+   failure. */
+int CadCore_GetWorldPoints(const CadCore* core, const double** x, const double** y, const double** z);
 
 /* ----------------------------------------------------------------------------
    Selection operations
    ---------------------------------------------------------------------------- */
 void CadCore_ClearSelection(CadCore* core);
-void CadCore_SelectPoint(CadCore* core, int16_t pointIndex);
-void CadCore_SelectPolygon(CadCore* core, int16_t polygonIndex);
-void CadCore_DeselectPoint(CadCore* core, int16_t pointIndex);
-void CadCore_DeselectPolygon(CadCore* core, int16_t polygonIndex);
-int CadCore_IsPointSelected(CadCore* core, int16_t pointIndex);
-int CadCore_IsPolygonSelected(CadCore* core, int16_t polygonIndex);
+void CadCore_SelectPoint(CadCore* core, CadIndex pointIndex);
+void CadCore_SelectPolygon(CadCore* core, CadIndex polygonIndex);
+void CadCore_DeselectPoint(CadCore* core, CadIndex pointIndex);
+void CadCore_DeselectPolygon(CadCore* core, CadIndex polygonIndex);
+int CadCore_IsPointSelected(CadCore* core, CadIndex pointIndex);
+int CadCore_IsPolygonSelected(CadCore* core, CadIndex polygonIndex);
 void CadCore_SelectAll(CadCore* core);
 
+/* Rebuild the selection sets from the records' selectFlag (after loading) */
+void CadCore_RebuildSelection(CadCore* core);
+
 /* ----------------------------------------------------------------------------
    Edit mode
    ---------------------------------------------------------------------------- */
@@ -116,24 +513,121 @@ CadEditMode CadCore_GetEditMode(CadCore* core);
 /* ----------------------------------------------------------------------------
    Linked list helpers
    ---------------------------------------------------------------------------- */
-int16_t CadCore_GetFirstPointOfPolygon(CadCore* core, int16_t polygonIndex);
-int16_t CadCore_GetNextPoint(CadCore* core, int16_t pointIndex);
-int16_t CadCore_GetNextPolygon(CadCore* core, int16_t polygonIndex);
-int16_t CadCore_GetFirstPolygonOfObject(CadCore* core, int16_t objectIndex);
+CadIndex CadCore_GetFirstPointOfPolygon(CadCore* core, CadIndex polygonIndex);
+CadIndex CadCore_GetNextPoint(CadCore* core, CadIndex pointIndex);
+CadIndex CadCore_GetNextPolygon(CadCore* core, CadIndex polygonIndex);
+CadIndex CadCore_GetFirstPolygonOfObject(CadCore* core, CadIndex objectIndex);
 
 /* ----------------------------------------------------------------------------
    Validation
    ---------------------------------------------------------------------------- */
-int CadCore_ValidatePolygon(CadCore* core, int16_t polygonIndex);
-int CadCore_ValidatePoint(CadCore* core, int16_t pointIndex);
+int CadCore_ValidatePolygon(CadCore* core, CadIndex polygonIndex);
+int CadCore_ValidatePoint(CadCore* core, CadIndex pointIndex);
 
 /* ----------------------------------------------------------------------------
-   Statistics
+   Statistics (O(1), counts are maintained incrementally)
    ---------------------------------------------------------------------------- */
 int CadCore_GetActivePointCount(CadCore* core);
 int CadCore_GetActivePolygonCount(CadCore* core);
 int CadCore_GetActiveObjectCount(CadCore* core);
 
+/* ----------------------------------------------------------------------------
+   Undo / redo
+   ---------------------------------------------------------------------------- */
+
+/* Group the mutations between Begin and End into one undo step (nestable) */
+void CadCore_BeginUndoGroup(CadCore* core);
+void CadCore_EndUndoGroup(CadCore* core);
+
+/* Revert or reapply one step; return 0 if there is none or a group is open */
+int CadCore_Undo(CadCore* core);
+int CadCore_Redo(CadCore* core);
+int CadCore_CanUndo(const CadCore* core);
+int CadCore_CanRedo(const CadCore* core);
+
+/* Cap the memory held by retained steps (oldest steps are dropped first) */
+void CadCore_SetUndoLimit(CadCore* core, size_t bytes);
+
+/* Drop all undo and redo steps */
+void CadCore_ClearUndo(CadCore* core);
+
+/* ----------------------------------------------------------------------------
+   Compaction
+   Packs live points, polygons and objects to the front of their pools in
+   index order and rewrites every link, the selection and the editing
+   cursors through old -> new remap tables (-1 for dropped slots). Pool
+   capacity is kept. Links into dead slots become -1.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    CadIndex* points;            /* Indexed by old slot, pointCount entries */
+    CadIndex* polygons;
+    CadIndex* objects;
+    int pointCount;              /* Old high-water marks */
+    int polygonCount;
+    int objectCount;
+} CadRemap;
+
+/* Returns 0 on allocation failure (model unchanged). If remap is not NULL
+   it receives the tables; release them with CadCore_FreeRemap. */
+int CadCore_Compact(CadCore* core, CadRemap* remap);
+void CadCore_FreeRemap(CadRemap* remap);
+
+/* ----------------------------------------------------------------------------
+   Snapshots
+   Named copies of the pools split into refcounted pages of
+   CAD_SNAPSHOT_PAGE_SLOTS records. The store remembers the page table the
+   model last matched (its base); a capture shares every base page the
+   model has not written since, and a restore copies back only the pages
+   that differ, so snapshots cost roughly the edits between them. Derived
+   indexes are rebuilt after a restore and the undo history is reset.
+   ---------------------------------------------------------------------------- */
+#define CAD_SNAPSHOT_SLOTS 10
+#define CAD_SNAPSHOT_NAME  32
+
+typedef struct CadSnapshotPage CadSnapshotPage;
+
+typedef struct {
+    CadSnapshotPage** pages[3];  /* Indexed by CadPoolKind */
+    int pageCount[3];
+    int count[3];                /* High-water marks */
+} CadPageTable;
+
+typedef struct {
+    char name[CAD_SNAPSHOT_NAME];
+    int used;
+    uint32_t serial;             /* Capture order */
+    CadPageTable table;
+} CadSnapshot;
+
+typedef struct {
+    CadSnapshot slots[CAD_SNAPSHOT_SLOTS];
+    CadPageTable base;           /* Pages the model's clean pages equal */
+    uint32_t nextSerial;
+} CadSnapshotStore;
+
+void CadCore_InitSnapshots(CadSnapshotStore* store);
+void CadCore_FreeSnapshots(CadSnapshotStore* store);
+
+/* Capture the model into a free slot, replacing the oldest snapshot when
+   all are used. Returns the slot, or -1 on allocation failure. */
+int CadCore_TakeSnapshot(CadCore* core, CadSnapshotStore* store, const char* name);
+
+/* Replace the model with a snapshot. Returns 0 on allocation failure or an
+   empty slot (model unchanged). */
+int CadCore_RestoreSnapshot(CadCore* core, CadSnapshotStore* store, int slot);
+
+void CadCore_DeleteSnapshot(CadSnapshotStore* store, int slot);
+
+/* ----------------------------------------------------------------------------
+   Live element iteration
+   Return the first live index >= from, or -1 when there is none:
+     for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0;
+          i = CadCore_NextLivePoint(core, i + 1)) { ... }
+   ---------------------------------------------------------------------------- */
+CadIndex CadCore_NextLivePoint(const CadCore* core, CadIndex from);
+CadIndex CadCore_NextLivePolygon(const CadCore* core, CadIndex from);
+CadIndex CadCore_NextLiveObject(const CadCore* core, CadIndex from);
+
 /* ----------------------------------------------------------------------------
    Merge detection
    ---------------------------------------------------------------------------- */
@@ -141,16 +635,216 @@ int CadCore_GetActiveObjectCount(CadCore* core);
 /* Convert coordinate to integer (round half up) - matches original Convert() function */
 int CadCore_ConvertCoordinate(double coord);
 
-/* Check if coordinates are merged (all coordinates are integers) */
+/* Merge status counts (see Merge status); any output may be NULL. O(1)
+   unless a whole-model edit left a recount pending. */
+void CadCore_GetMergeStatus(CadCore* core, int* offGridPoints, int* offGridObjects, int* duplicateEdges);
+
+/* Check if coordinates are merged (all coordinates are integers); O(1) */
 int CadCore_AreCoordinatesMerged(CadCore* core);
 
-/* Check if points are merged (no duplicate points at same grid location) */
+/* Check if points are merged (no duplicate points at same grid location); O(1) */
 int CadCore_ArePointsMerged(CadCore* core);
 
-/* Check if all merge operations have been applied */
+/* Check if all merge operations have been applied; O(1) */
 int CadCore_IsFullyMerged(CadCore* core);
 
-/* Check if a point is connected to any polygon (not orphaned) */
-int CadCore_IsPointConnected(CadCore* core, int16_t pointIndex);
+/* Check if a point is connected to any polygon (not orphaned); O(1) */
+int CadCore_IsPointConnected(CadCore* core, CadIndex pointIndex);
+
+/* ----------------------------------------------------------------------------
+   Flat check
+   ---------------------------------------------------------------------------- */
+
+/* Faces whose vertices stray further than this from their plane */
+#define CAD_FLAT_TOLERANCE 0.01
+
+/* Bring the flat check cache up to date (stale polygons in parallel, SIMD
+   per polygon), then fill up to maxCount indices of the polygons with 4 or
+   more walked points deviating more than tolerance into out (may be NULL).
+   Returns the total number of such polygons, or -1 on allocation failure. */
+int CadCore_FlatCheck(CadCore* core, double tolerance, CadIndex* out, int maxCount);
+
+/* Cached deviation of a polygon from its plane, or -1 if the entry is
+   stale or the polygon has fewer than 3 walked points */
+double CadCore_GetPolygonDeviation(const CadCore* core, CadIndex polygonIndex);
+
+/* ----------------------------------------------------------------------------
+   Transform
+   Affine transforms are 4x3 row-major matrices m[12], mapping (x, y, z) to
+     (m[0]x + m[1]y + m[2]z  + m[3],
+      m[4]x + m[5]y + m[6]z  + m[7],
+      m[8]x + m[9]y + m[10]z + m[11]).
+   ---------------------------------------------------------------------------- */
+void CadCore_MatrixTranslate(double m[12], double dx, double dy, double dz);
+
+/* Rotation by angle radians about the axis (0 = X, 1 = Y, 2 = Z) through
+   (cx, cy, cz), counterclockwise looking down the axis */
+void CadCore_MatrixRotate(double m[12], int axis, double angle, double cx, double cy, double cz);
+
+/* Uniform scale by factor about (cx, cy, cz) */
+void CadCore_MatrixScale(double m[12], double factor, double cx, double cy, double cz);
+
+/* Unique live points a transform of the selection moves: the selected
+   points, or with polygons set the walked points of the selected polygons.
+   Fills up to maxCount entries of out (may be NULL) and returns the total,
+   or -1 on allocation failure. Tools collect once per drag and hand the
+   list to CadCore_TransformPoints every frame. */
+int CadCore_CollectSelectionPoints(CadCore* core, int polygons, CadIndex* out, int maxCount);
+
+/* Apply m to each listed point (listed at most once; dead entries are
+   skipped), two points per SIMD step. Returns the number of points moved. */
+int CadCore_TransformPoints(CadCore* core, const CadIndex* points, int count, const double m[12]);
+
+/* Collect and transform in one undo step. Returns the number of points
+   moved, or -1 on allocation failure (model unchanged). */
+int CadCore_TransformSelection(CadCore* core, int polygons, const double m[12]);
+
+/* Reverse the winding of the listed polygons (each listed at most once;
+   the list may be the selection's).
+   A face whose points no other face walks is relinked in place; a face
+   sharing points gets a fresh reversed chain so the other walks keep
+   theirs, and points left unused are deleted. One undo step. Returns the
+   number of faces reversed, or -1 on allocation failure (model unchanged). */
+int CadCore_ReversePolygons(CadCore* core, const CadIndex* polygons, int count);
+
+/* Mirror the selection (as CadCore_CollectSelectionPoints) across the
+   plane where coordinate axis (0 = X, 1 = Y, 2 = Z) equals center, then
+   reverse every face whose points all moved so its winding stays
+   consistent. One undo step. Returns the number of points moved, or -1 on
+   allocation failure (model unchanged). */
+int CadCore_ReflectSelection(CadCore* core, int polygons, int axis, double center);
+
+/* ----------------------------------------------------------------------------
+   Face cut
+   ---------------------------------------------------------------------------- */
+
+/* Cut the listed polygons (each listed at most once; the list may be the
+   selection's) along the plane plane[0..2] . p = plane[3] (unit normal).
+   Faces of 3 or more points with vertices further than
+   CAD_COPLANAR_EPSILON on both sides are split into a front and a back
+   piece, with pieces longer than CAD_MAX_FACE_POINTS cut along a
+   diagonal. The front piece keeps the face's slot and the rest follow it
+   in its group, all on fresh chains; pieces of selected faces are
+   selected. An edge cut from several faces gets one cut vertex, keyed by
+   the grid cells of its ends, so neighbouring faces stay welded. One undo
+   step. Stores the number of distinct cut vertices in cutPoints (may be
+   NULL) and returns the number of faces split, or -1 on allocation
+   failure (model unchanged). */
+int CadCore_CutPolygons(CadCore* core, const CadIndex* polygons, int count, const double plane[4],
+                        int* cutPoints);
+
+/* ----------------------------------------------------------------------------
+   Primitives
+   Parametric solids, centred on center with extents size[0..2] along X, Y
+   and Z. Round shapes go around the Y axis.
+   ---------------------------------------------------------------------------- */
+
+typedef enum {
+    CAD_PRIMITIVE_BOX = 0,       /* 6 quads */
+    CAD_PRIMITIVE_CYLINDER = 1,  /* segments side quads and two caps */
+    CAD_PRIMITIVE_SPHERE = 2,    /* segments x rings, triangles at the poles */
+    CAD_PRIMITIVE_CONE = 3,      /* segments side triangles to the +Y apex and a base */
+    CAD_PRIMITIVE_GRID = 4,      /* segments x rings quads in the XZ plane facing +Y */
+    CAD_PRIMITIVE_COUNT
+} CadPrimitiveType;
+
+#define CAD_PRIMITIVE_MAX_SEGMENTS 1024
+
+typedef struct {
+    CadPrimitiveType type;
+    double center[3];
+    double size[3];
+    int segments;                /* Around the axis (grid: cells along X) */
+    int rings;                   /* Sphere: bands pole to pole (grid: cells along Z) */
+    uint8_t color;
+} CadPrimitive;
+
+/* Generate a primitive straight into the pools. Room for every point and
+   face is reserved once, slots are appended past the high-water mark and
+   chains are linked as they are written. Each face walks its own chain,
+   counterclockwise seen from outside; caps wider than CAD_MAX_FACE_POINTS
+   become triangle fans. The faces are consecutive from *firstPolygon (may
+   be NULL) and are appended to object's group (-1 = ungrouped). Segment
+   counts are clamped to sensible ranges. One undo step. Returns the number
+   of faces, or -1 on allocation failure (model unchanged). */
+int CadCore_AddPrimitive(CadCore* core, CadIndex object, const CadPrimitive* primitive, CadIndex* firstPolygon);
+
+/* ----------------------------------------------------------------------------
+   Face copy
+   ---------------------------------------------------------------------------- */
+
+/* Duplicate the listed polygons (the list may be the selection's; repeats
+   are copied once), moved by offset[0..2] (may be NULL). Every distinct
+   point the faces walk is copied once into consecutive new slots, and each
+   copy links to the copy of its original's successor through a dense
+   remap, so the copies share points exactly where the originals do.
+   Copies keep color and side, go to animation frame (-1 = the
+   original's), stay paired when both faces of a double-sided pair are
+   copied, and follow their original in its group. The copies are
+   consecutive from *firstCopy (may be NULL) and are not selected. Linear
+   in the selection, one undo step. Returns the number of faces copied, or
+   -1 on allocation failure (model unchanged). */
+int CadCore_CopyPolygons(CadCore* core, const CadIndex* polygons, int count, const double offset[3], int frame,
+                         CadIndex* firstCopy);
+
+/* ----------------------------------------------------------------------------
+   Merge operations
+   ---------------------------------------------------------------------------- */
+
+/* Merge / Grid Merge: snap every point coordinate and object offset to the
+   nearest multiple of step (1.0 = integers), rounding like
+   CadCore_ConvertCoordinate. SIMD over the coordinate arrays, one undo step.
+   Returns the number of points and objects moved. */
+int CadCore_SnapCoordinates(CadCore* core, double step);
+
+/* Values further than CAD_SNAP_EPSILON * step from the grid. Fill up to
+   maxCount indices of the offending points / objects into out (may be NULL)
+   and return the total number found. */
+#define CAD_SNAP_EPSILON 1e-9
+int CadCore_FindOffGridPoints(const CadCore* core, double step, CadIndex* out, int maxCount);
+int CadCore_FindOffGridObjects(const CadCore* core, double step, CadIndex* out, int maxCount);
+
+/* Point Merge: collapse runs of chain vertices that round to the same
+   integer grid cell (CadCore_ConvertCoordinate) onto the run's first point,
+   along with a last vertex back in its face's first cell. Links and vertex
+   counts are rewritten in one pass and the merged points deleted; faces
+   left with fewer than CAD_MIN_FACE_POINTS vertices are deleted. Expected
+   O(N), one undo step. Returns the number of points merged, or -1 on
+   allocation failure (model unchanged). */
+int CadCore_MergePoints(CadCore* core);
+
+/* Polygon Merge: join faces of one group that share an edge (walked in
+   opposite directions, vertices matched by integer grid cell), have the
+   same color, side and animation and lie in one plane within
+   CAD_COPLANAR_EPSILON, while the result stays convex and within
+   CAD_MAX_FACE_POINTS. Builds a directed edge -> face hash map in one pass,
+   then merges greedily; near-linear in the polygon count, one undo step.
+   Double-sided faces are left alone. Merged faces get a fresh vertex chain
+   and absorbed faces are unlinked from their group. Stores the live polygon
+   count before and after in before / after (may be NULL) and returns the
+   number of faces absorbed, or -1 on allocation failure (model unchanged). */
+#define CAD_COPLANAR_EPSILON 1e-6
+int CadCore_MergePolygons(CadCore* core, int* before, int* after);
+
+/* Polygon Sort: build the BSP tree (see Polygon sort tree) over the live
+   faces, splitting faces that straddle a splitter plane. The first piece
+   keeps the face's slot and the rest are added right after it in its
+   group; all pieces get fresh vertex chains, and pieces longer than
+   CAD_MAX_FACE_POINTS are cut along a diagonal. Splitters are the best of
+   a few faces drawn from a fixed-seed generator, so the build is expected
+   O(n log n) and repeatable. Faces without a plane (lines) never split
+   anything and stay at the first node they straddle. One undo step.
+   Returns the number of faces split, or -1 on allocation failure (model
+   unchanged). */
+int CadCore_SortPolygons(CadCore* core);
+
+/* The tree from the last sort, or NULL if the model changed since */
+const CadBspTree* CadCore_GetBspTree(const CadCore* core);
+
+/* Fill out with the sorted faces back to front as seen from the eye
+   position, in O(n). Returns the number of faces written (at most
+   maxCount), or -1 if there is no current tree or on allocation failure. */
+int CadCore_GetBackToFrontOrder(const CadCore* core, double ex, double ey, double ez,
+                                CadIndex* out, int maxCount);
 
 
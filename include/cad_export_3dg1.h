@@ -2,6 +2,9 @@
 
 #include "cad_core.h"
 
-/* Export CAD data to Fundoshi-Kun format */
-int CadExport_3DG1(const CadCore* core, const char* filename);
+/* Export CAD data to Fundoshi-Kun format. With an eye position and a
+   current Polygon Sort tree, faces are written back to front as seen from
+   the eye (see CadCore_GetBackToFrontOrder); otherwise, or when object
+   offsets move faces away from the model-space tree, in slot order. */
+int CadExport_3DG1(const CadCore* core, const char* filename, const double* eye);
 
@@ -17,10 +17,22 @@
 /* ----------------------------------------------------------------------------
    Maximum counts
    ---------------------------------------------------------------------------- */
-#define CAD_MAX_OBJECTS     256     /* max objects */
-#define CAD_MAX_POINTS      1024    /* max points */
-#define CAD_MAX_POLYGONS    1024    /* max polygons */
 #define CAD_MAX_FACE_POINTS 12      /* max face points */
+#define CAD_MAX_INDEX       0x3FFFFFFF /* max in-memory pool index */
+#define CAD_FILE_MAX_INDEX  32767   /* max index the .cad format can store (int16) */
+
+/* ----------------------------------------------------------------------------
+   Pool growth
+   ---------------------------------------------------------------------------- */
+#define CAD_POOL_MIN_CAPACITY 16    /* first allocation of an empty pool */
+#define CAD_SIMD_ALIGN        32    /* byte alignment of coordinate arrays */
+
+/* ----------------------------------------------------------------------------
+   Element index
+   Links are 32-bit in memory; CadFile_Load/CadFile_Save convert to and
+   from the big-endian int16 links of the on-disk format
+   ---------------------------------------------------------------------------- */
+typedef int32_t CadIndex;
 
 /* ----------------------------------------------------------------------------
    File format tags
@@ -31,14 +43,13 @@
 
 /* ----------------------------------------------------------------------------
    Point record (vertex)
+   Coordinates live in the structure-of-arrays store of CadFileData
+   (pointX/pointY/pointZ) so coordinate-only passes stream contiguous memory
    ---------------------------------------------------------------------------- */
 typedef struct {
     uint8_t  flags;          /* Flags */
     uint8_t  selectFlag;     /* Selection flag */
-    int16_t  nextPoint;      /* Index to next point in polygon (-1 = end) */
-    double   pointx;         /* X coordinate */
-    double   pointy;         /* Y coordinate */
-    double   pointz;         /* Z coordinate */
+    CadIndex nextPoint;      /* Index to next point in polygon (-1 = end) */
 } CadPoint;
 
 /* ----------------------------------------------------------------------------
@@ -47,10 +58,10 @@ typedef struct {
 typedef struct {
     uint8_t  flags;          /* Flags */
     uint8_t  selectFlag;     /* Selection flag */
-    int16_t  nextPolygon;    /* Index to next polygon in same group (-1 = end) */
-    int16_t  firstPoint;     /* Index to first vertex of polygon */
+    CadIndex nextPolygon;    /* Index to next polygon in same group (-1 = end) */
+    CadIndex firstPoint;     /* Index to first vertex of polygon */
     int16_t  animation;      /* Animation frame index */
-    int16_t  both;           /* Opposite side index (double-sided polygon) */
+    CadIndex both;           /* Opposite side index (double-sided polygon) */
     uint8_t  side;           /* Front/back flag */
     uint8_t  color;          /* Polygon color */
     uint8_t  npoints;        /* Vertex count */
@@ -62,10 +73,10 @@ typedef struct {
 typedef struct {
     uint8_t  flags;          /* Flags */
     uint8_t  selectFlag;     /* Selection flag */
-    int16_t  parentObject;   /* Index to parent object (-1 = root) */
-    int16_t  nextBrother;    /* Index to next sibling object (-1 = end) */
-    int16_t  childObject;    /* Index to first child object (-1 = none) */
-    int16_t  firstPolygon;   /* Index to first polygon (-1 = none) */
+    CadIndex parentObject;   /* Index to parent object (-1 = root) */
+    CadIndex nextBrother;    /* Index to next sibling object (-1 = end) */
+    CadIndex childObject;    /* Index to first child object (-1 = none) */
+    CadIndex firstPolygon;   /* Index to first polygon (-1 = none) */
     double   offsetx;        /* Offset X relative to parent */
     double   offsety;        /* Offset Y relative to parent */
     double   offsetz;        /* Offset Z relative to parent */
@@ -73,15 +84,27 @@ typedef struct {
 
 /* ----------------------------------------------------------------------------
    CAD file data structure
+   Pools are heap-allocated and grow geometrically. Slots between the
+   high-water mark (xxxCount) and the capacity are zeroed (flags == 0).
+   Point coordinates are parallel arrays sized to pointCapacity, aligned
+   to CAD_SIMD_ALIGN; coordinates of unused point slots are kept at 0.
    ---------------------------------------------------------------------------- */
 typedef struct {
-    CadObject  objects[CAD_MAX_OBJECTS];
-    CadPolygon polygons[CAD_MAX_POLYGONS];
-    CadPoint   points[CAD_MAX_POINTS];
+    CadObject*  objects;
+    CadPolygon* polygons;
+    CadPoint*   points;
     
-    int objectCount;
+    double*     pointX;      /* Point coordinates (structure of arrays) */
+    double*     pointY;
+    double*     pointZ;
+    
+    int objectCount;         /* High-water marks */
     int polygonCount;
     int pointCount;
+    
+    int objectCapacity;      /* Allocated slots */
+    int polygonCapacity;
+    int pointCapacity;
 } CadFileData;
 
 /* ----------------------------------------------------------------------------
@@ -91,22 +114,32 @@ typedef struct {
 /* Load a .cad file */
 int CadFile_Load(const char* filename, CadFileData* data);
 
-/* Save a .cad file */
+/* Save a .cad file (fails without writing if an index exceeds CAD_FILE_MAX_INDEX) */
 int CadFile_Save(const char* filename, const CadFileData* data);
 
-/* Initialize empty CAD data */
+/* Initialize empty CAD data (does not free; use on uninitialized memory) */
 void CadFile_Init(CadFileData* data);
 
-/* Clear all data */
+/* Clear all data and release pool memory */
 void CadFile_Clear(CadFileData* data);
 
+/* Make sure each pool can hold at least the given number of slots.
+   Returns 0 if a request exceeds CAD_MAX_INDEX + 1 or allocation fails. */
+int CadFile_Reserve(CadFileData* data, int objects, int polygons, int points);
+
 /* Get point by index (returns NULL if invalid) */
-CadPoint* CadFile_GetPoint(CadFileData* data, int16_t index);
+CadPoint* CadFile_GetPoint(CadFileData* data, CadIndex index);
+
+/* Read point coordinates (returns 0 if index is out of range) */
+int CadFile_GetPointPosition(const CadFileData* data, CadIndex index, double* x, double* y, double* z);
+
+/* Write point coordinates (returns 0 if index is out of range) */
+int CadFile_SetPointPosition(CadFileData* data, CadIndex index, double x, double y, double z);
 
 /* Get polygon by index (returns NULL if invalid) */
-CadPolygon* CadFile_GetPolygon(CadFileData* data, int16_t index);
+CadPolygon* CadFile_GetPolygon(CadFileData* data, CadIndex index);
 
 /* Get object by index (returns NULL if invalid) */
-CadObject* CadFile_GetObject(CadFileData* data, int16_t index);
+CadObject* CadFile_GetObject(CadFileData* data, CadIndex index);
 
 
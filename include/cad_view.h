@@ -27,6 +27,7 @@ typedef struct {
     double pan_x, pan_y;   /* Pan offset */
     double rot_x, rot_y;   /* Rotation (for 3D view) */
     int wireframe;         /* 1 = wireframe, 0 = solid */
+    double flat_highlight; /* > 0: tint faces deviating more than this from flat (Flat Check) */
 } CadView;
 
 /* ----------------------------------------------------------------------------
@@ -49,11 +50,23 @@ void CadView_Pan3DVertical(CadView* view, double dy); /* Pan 3D view up/down rel
 void CadView_ProjectPoint(const CadView* view, double x, double y, double z, 
                          int* out_x, int* out_y, int viewport_w, int viewport_h);
 
+/* Project points [first, first + count) of the coordinate arrays in one pass.
+   out_depth (optional) receives view-space depth. */
+void CadView_ProjectPoints(const CadView* view, const CadFileData* data, int first, int count,
+                           int* out_x, int* out_y, double* out_depth,
+                           int viewport_w, int viewport_h);
+
+/* Eye position 'distance' units from the origin toward the viewer, along
+   the view's depth axis (larger depth is nearer). With a distance well
+   outside the model it stands in for the orthographic camera when
+   ordering faces back to front. */
+void CadView_GetEyePosition(const CadView* view, double distance, double eye[3]);
+
 /* ----------------------------------------------------------------------------
    Point selection (find nearest point to screen coordinates)
    Returns point index or -1 if none found within threshold
    ---------------------------------------------------------------------------- */
-int16_t CadView_FindNearestPoint(const CadView* view, const CadCore* core,
+CadIndex CadView_FindNearestPoint(const CadView* view, const CadCore* core,
                                  int screen_x, int screen_y,
                                  int viewport_x, int viewport_y,
                                  int viewport_w, int viewport_h,
@@ -70,7 +83,7 @@ int CadView_FindPointsAtLocation(const CadView* view, const CadCore* core,
                                  int viewport_w, int viewport_h,
                                  int threshold_pixels,
                                  double world_threshold,
-                                 int16_t* out_indices, int max_count);
+                                 CadIndex* out_indices, int max_count);
 
 /* ----------------------------------------------------------------------------
    Unproject screen delta to 3D world delta
@@ -5,9 +5,97 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CAD_HAVE_SSE2
+#endif
 
 #define INVALID_INDEX -1
 
+/* ----------------------------------------------------------------------------
+   Change tracking
+   ---------------------------------------------------------------------------- */
+
+static void widen_dirty_range(CadPoolChanges* pool, CadIndex first, CadIndex last) {
+    if (first > last) return;
+    if (pool->dirtyFirst > pool->dirtyLast) {
+        pool->dirtyFirst = first;
+        pool->dirtyLast = last;
+        return;
+    }
+    if (first < pool->dirtyFirst) pool->dirtyFirst = first;
+    if (last > pool->dirtyLast) pool->dirtyLast = last;
+}
+
+#define BIT_WORDS(n) (((n) + 63) / 64)
+#define PAGE_COUNT(n) (((n) + CAD_SNAPSHOT_PAGE_SLOTS - 1) >> CAD_SNAPSHOT_PAGE_SHIFT)
+
+static void mark_page(CadPoolChanges* pool, CadIndex i) {
+    CadIndex page = i >> CAD_SNAPSHOT_PAGE_SHIFT;
+    pool->snapshotPages[page >> 6] |= (uint64_t)1 << (page & 63);
+}
+
+static void mark_geometry(CadPoolChanges* pool, CadIndex i) {
+    pool->geometry++;
+    widen_dirty_range(pool, i, i);
+    mark_page(pool, i);
+}
+
+static void mark_topology(CadPoolChanges* pool, CadIndex i) {
+    pool->topology++;
+    widen_dirty_range(pool, i, i);
+    mark_page(pool, i);
+}
+
+/* Set or clear every page bit of a pool sized for capacity slots */
+static void fill_pages(CadPoolChanges* pool, int capacity, int dirty) {
+    if (!pool->snapshotPages) return;
+    memset(pool->snapshotPages, dirty ? 0xFF : 0, (size_t)BIT_WORDS(PAGE_COUNT(capacity)) * sizeof(uint64_t));
+}
+
+/* Drop cached planarity (see CadCore_FlatCheck) */
+static void flat_cache_invalidate(CadCore* core, CadIndex p) {
+    if (core->flatCache.current) core->flatCache.current[p >> 6] &= ~((uint64_t)1 << (p & 63));
+}
+
+static void flat_cache_invalidate_all(CadCore* core) {
+    if (!core->flatCache.current) return;
+    memset(core->flatCache.current, 0, (size_t)BIT_WORDS(core->polygonCapacity) * sizeof(uint64_t));
+}
+
+/* Whole-model replacement (load, clear): every current slot is dirty */
+static void mark_all_changed(CadCore* core) {
+    CadChangeTracker* changes = &core->changes;
+    changes->points.geometry++;
+    changes->points.topology++;
+    changes->polygons.geometry++;
+    changes->polygons.topology++;
+    changes->objects.geometry++;
+    changes->objects.topology++;
+    widen_dirty_range(&changes->points, 0, (CadIndex)core->data.pointCount - 1);
+    widen_dirty_range(&changes->polygons, 0, (CadIndex)core->data.polygonCount - 1);
+    widen_dirty_range(&changes->objects, 0, (CadIndex)core->data.objectCount - 1);
+    fill_pages(&changes->points, core->pointCapacity, 1);
+    fill_pages(&changes->polygons, core->polygonCapacity, 1);
+    fill_pages(&changes->objects, core->objectCapacity, 1);
+    core->spatial.valid = 0;
+    core->mergeStatus.valid = 0;
+    flat_cache_invalidate_all(core);
+}
+
+void CadCore_ClearDirtyRanges(CadCore* core) {
+    if (!core) return;
+    core->changes.points.dirtyFirst = 0;
+    core->changes.points.dirtyLast = INVALID_INDEX;
+    core->changes.polygons.dirtyFirst = 0;
+    core->changes.polygons.dirtyLast = INVALID_INDEX;
+    core->changes.objects.dirtyFirst = 0;
+    core->changes.objects.dirtyLast = INVALID_INDEX;
+}
+
 /* ----------------------------------------------------------------------------
    Initialization and cleanup
    ---------------------------------------------------------------------------- */
@@ -25,25 +113,96 @@ void CadCore_Init(CadCore* core) {
     core->rootPolygon = INVALID_INDEX;
     core->creatingPoint = INVALID_INDEX;
     core->firstPoint = INVALID_INDEX;
+    core->adjacency.freeNode = INVALID_INDEX;
+    core->journal.openFirst = INVALID_INDEX;
+    core->journal.limitBytes = CAD_UNDO_DEFAULT_LIMIT;
     
-    /* Initialize selection arrays to invalid */
-    for (int i = 0; i < CAD_MAX_POINTS; i++) {
-        core->selection.selectedPoints[i] = INVALID_INDEX;
-    }
-    for (int i = 0; i < CAD_MAX_POLYGONS; i++) {
-        core->selection.selectedPolygons[i] = INVALID_INDEX;
-    }
+    /* Start at generation 1 with empty ranges */
+    core->changes.points.geometry = core->changes.points.topology = 1;
+    core->changes.polygons.geometry = core->changes.polygons.topology = 1;
+    core->changes.objects.geometry = core->changes.objects.topology = 1;
+    CadCore_ClearDirtyRanges(core);
 }
 
 void CadCore_Destroy(CadCore* core) {
     if (!core) return;
     CadCore_Clear(core);
+    
+    free(core->selection.selectedPoints);
+    free(core->selection.selectedPolygons);
+    free(core->selection.pointSlot);
+    free(core->selection.polygonSlot);
+    free(core->freeList.freePoints);
+    free(core->freeList.freePolygons);
+    free(core->freeList.freeObjects);
+    free(core->adjacency.pointFirstUse);
+    free(core->adjacency.polygonFirstUse);
+    free(core->adjacency.nodes);
+    free(core->live.points);
+    free(core->live.polygons);
+    free(core->live.objects);
+    free(core->polygonIndex.offsets);
+    free(core->polygonIndex.vertices);
+    free(core->journal.deltas);
+    free(core->journal.groups);
+    free(core->journal.pointRecorded);
+    free(core->journal.polygonRecorded);
+    free(core->journal.objectRecorded);
+    free(core->changes.points.snapshotPages);
+    free(core->changes.polygons.snapshotPages);
+    free(core->changes.objects.snapshotPages);
+    core->changes.points.snapshotPages = NULL;
+    core->changes.polygons.snapshotPages = NULL;
+    core->changes.objects.snapshotPages = NULL;
+    free(core->spatial.buckets);
+    free(core->spatial.next);
+    free(core->spatial.prev);
+    free(core->spatial.bucket);
+    memset(&core->spatial, 0, sizeof(core->spatial));
+    free(core->mergeStatus.pointOffGrid);
+    free(core->mergeStatus.polygonDuplicates);
+    memset(&core->mergeStatus, 0, sizeof(core->mergeStatus));
+    free(core->flatCache.deviation);
+    free(core->flatCache.normal);
+    free(core->flatCache.current);
+    memset(&core->flatCache, 0, sizeof(core->flatCache));
+    free(core->bsp.nodes);
+    free(core->bsp.faces);
+    memset(&core->bsp, 0, sizeof(core->bsp));
+    free(core->hierarchy.order);
+    free(core->hierarchy.position);
+    free(core->hierarchy.subtreeEnd);
+    free(core->hierarchy.parent);
+    free(core->hierarchy.world);
+    free(core->hierarchy.polygonObject);
+    free(core->hierarchy.pointObject);
+    free(core->hierarchy.pointStart);
+    free(core->hierarchy.points);
+    free(core->hierarchy.worldX);
+    free(core->hierarchy.worldY);
+    free(core->hierarchy.worldZ);
+    memset(&core->hierarchy, 0, sizeof(core->hierarchy));
+    memset(&core->selection, 0, sizeof(core->selection));
+    memset(&core->freeList, 0, sizeof(core->freeList));
+    memset(&core->live, 0, sizeof(core->live));
+    memset(&core->adjacency, 0, sizeof(core->adjacency));
+    memset(&core->polygonIndex, 0, sizeof(core->polygonIndex));
+    memset(&core->journal, 0, sizeof(core->journal));
+    core->adjacency.freeNode = INVALID_INDEX;
+    core->journal.openFirst = INVALID_INDEX;
+    core->journal.limitBytes = CAD_UNDO_DEFAULT_LIMIT;
+    core->pointCapacity = 0;
+    core->polygonCapacity = 0;
+    core->objectCapacity = 0;
 }
 
 void CadCore_Clear(CadCore* core) {
     if (!core) return;
+    mark_all_changed(core);
     CadFile_Clear(&core->data);
     CadCore_ClearSelection(core);
+    CadCore_RebuildFreeLists(core);
+    CadCore_RebuildAdjacency(core);
     core->isDirty = 0;
     core->newPoint = INVALID_INDEX;
     core->newPolygon = INVALID_INDEX;
@@ -53,688 +212,4796 @@ void CadCore_Clear(CadCore* core) {
 }
 
 /* ----------------------------------------------------------------------------
-   File operations
+   Capacity management
    ---------------------------------------------------------------------------- */
 
-int CadCore_LoadFile(CadCore* core, const char* filename) {
-    if (!core || !filename) return 0;
-    
-    CadCore_Clear(core);
-    
-    if (!CadFile_Load(filename, &core->data)) {
-        return 0;
-    }
-    
-    core->isDirty = 0;
+static int grow_index_array(CadIndex** array, int capacity) {
+    CadIndex* grown = (CadIndex*)realloc(*array, (size_t)capacity * sizeof(CadIndex));
+    if (!grown) return 0;
+    *array = grown;
     return 1;
 }
 
-int CadCore_SaveFile(CadCore* core, const char* filename) {
-    if (!core || !filename) return 0;
-    
-    if (!CadFile_Save(filename, &core->data)) {
-        return 0;
-    }
-    
-    core->isDirty = 0;
+/* Grow an index array and set the new entries [old_capacity, capacity) to -1 */
+static int grow_link_array(CadIndex** array, int old_capacity, int capacity) {
+    if (!grow_index_array(array, capacity)) return 0;
+    for (int i = old_capacity; i < capacity; i++) (*array)[i] = INVALID_INDEX;
     return 1;
 }
 
-/* ----------------------------------------------------------------------------
-   Point operations
-   ---------------------------------------------------------------------------- */
-
-int16_t CadCore_AddPoint(CadCore* core, double x, double y, double z) {
-    if (!core) return INVALID_INDEX;
-    
-    /* Find first free slot */
-    for (int16_t i = 0; i < CAD_MAX_POINTS; i++) {
-        if (core->data.points[i].flags == 0) {
-            CadPoint* pt = &core->data.points[i];
-            pt->flags = 1;
-            pt->selectFlag = 0;
-            pt->nextPoint = INVALID_INDEX;
-            pt->pointx = x;
-            pt->pointy = y;
-            pt->pointz = z;
-            
-            if (i >= core->data.pointCount) {
-                core->data.pointCount = i + 1;
-            }
-            
-            core->newPoint = i;
-            core->isDirty = 1;
-            return i;
-        }
-    }
-    
-    return INVALID_INDEX; /* No free slots */
+/* Grow a double array to capacity entries; new entries are uninitialized */
+static int grow_double_array(double** array, int capacity) {
+    double* grown = (double*)realloc(*array, (size_t)capacity * sizeof(double));
+    if (!grown) return 0;
+    *array = grown;
+    return 1;
 }
 
-int CadCore_DeletePoint(CadCore* core, int16_t pointIndex) {
-    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
-    
-    /* Mark as deleted (set flags to 0) */
-    core->data.points[pointIndex].flags = 0;
-    core->data.points[pointIndex].selectFlag = 0;
-    
-    /* Remove from selection if selected */
-    CadCore_DeselectPoint(core, pointIndex);
-    
-    core->isDirty = 1;
+/* Grow a byte array from old_capacity to capacity; new bytes are zero */
+static int grow_byte_array(uint8_t** array, int old_capacity, int capacity) {
+    uint8_t* grown = (uint8_t*)realloc(*array, (size_t)capacity);
+    if (!grown) return 0;
+    memset(grown + old_capacity, 0, (size_t)(capacity - old_capacity));
+    *array = grown;
     return 1;
 }
 
-CadPoint* CadCore_GetPoint(CadCore* core, int16_t index) {
-    if (!core || !CadCore_IsPointValid(core, index)) return NULL;
-    return &core->data.points[index];
+/* Grow a bitset from old_capacity to capacity bits; new bits are clear */
+static int grow_bit_array(uint64_t** words, int old_capacity, int capacity) {
+    int old_words = BIT_WORDS(old_capacity);
+    int new_words = BIT_WORDS(capacity);
+    if (new_words <= old_words && *words) return 1;
+    uint64_t* grown = (uint64_t*)realloc(*words, (size_t)new_words * sizeof(uint64_t));
+    if (!grown) return 0;
+    memset(grown + old_words, 0, (size_t)(new_words - old_words) * sizeof(uint64_t));
+    *words = grown;
+    return 1;
 }
 
-int CadCore_IsPointValid(CadCore* core, int16_t index) {
-    if (!core || index < 0 || index >= CAD_MAX_POINTS) return 0;
-    return core->data.points[index].flags != 0;
+/* Grow a pool's snapshot page bits; pages beyond the old capacity start dirty */
+static int grow_page_bits(CadPoolChanges* pool, int old_capacity, int capacity) {
+    int old_words = pool->snapshotPages ? BIT_WORDS(PAGE_COUNT(old_capacity)) : 0;
+    int new_words = BIT_WORDS(PAGE_COUNT(capacity));
+    if (new_words > old_words) {
+        uint64_t* grown = (uint64_t*)realloc(pool->snapshotPages, (size_t)new_words * sizeof(uint64_t));
+        if (!grown) return 0;
+        pool->snapshotPages = grown;
+    }
+    for (int page = PAGE_COUNT(old_capacity); page < PAGE_COUNT(capacity); page++) {
+        pool->snapshotPages[page >> 6] |= (uint64_t)1 << (page & 63);
+    }
+    return 1;
 }
 
-/* ----------------------------------------------------------------------------
-   Polygon operations
-   ---------------------------------------------------------------------------- */
-
-int16_t CadCore_AddPolygon(CadCore* core, int16_t firstPoint, uint8_t color, uint8_t npoints) {
-    if (!core || !CadCore_IsPointValid(core, firstPoint) || npoints < 2) {
-        return INVALID_INDEX;
-    }
+/* Size the selection, free-list, live-slot and adjacency arrays to match the data pools */
+static int sync_capacity(CadCore* core) {
+    CadFileData* data = &core->data;
     
-    /* Find first free slot */
-    for (int16_t i = 0; i < CAD_MAX_POLYGONS; i++) {
-        if (core->data.polygons[i].flags == 0) {
-            CadPolygon* poly = &core->data.polygons[i];
-            poly->flags = 1;
-            poly->selectFlag = 0;
-            poly->nextPolygon = INVALID_INDEX;
-            poly->firstPoint = firstPoint;
-            poly->animation = 0;
-            poly->both = INVALID_INDEX;
-            poly->side = 0;
-            poly->color = color;
-            poly->npoints = npoints;
-            
-            if (i >= core->data.polygonCount) {
-                core->data.polygonCount = i + 1;
-            }
-            
-            core->newPolygon = i;
-            core->isDirty = 1;
-            return i;
+    if (data->pointCapacity > core->pointCapacity) {
+        if (!grow_index_array(&core->selection.selectedPoints, data->pointCapacity) ||
+            !grow_link_array(&core->selection.pointSlot, core->pointCapacity, data->pointCapacity) ||
+            !grow_index_array(&core->freeList.freePoints, data->pointCapacity) ||
+            !grow_link_array(&core->adjacency.pointFirstUse, core->pointCapacity, data->pointCapacity) ||
+            !grow_bit_array(&core->live.points, core->pointCapacity, data->pointCapacity) ||
+            !grow_bit_array(&core->journal.pointRecorded, core->pointCapacity, data->pointCapacity) ||
+            !grow_page_bits(&core->changes.points, core->pointCapacity, data->pointCapacity) ||
+            !grow_index_array(&core->spatial.next, data->pointCapacity) ||
+            !grow_index_array(&core->spatial.prev, data->pointCapacity) ||
+            !grow_link_array(&core->spatial.bucket, core->pointCapacity, data->pointCapacity) ||
+            !grow_bit_array(&core->mergeStatus.pointOffGrid, core->pointCapacity, data->pointCapacity)) {
+            return 0;
         }
+        core->pointCapacity = data->pointCapacity;
     }
-    
-    return INVALID_INDEX; /* No free slots */
+    if (data->polygonCapacity > core->polygonCapacity) {
+        if (!grow_index_array(&core->selection.selectedPolygons, data->polygonCapacity) ||
+            !grow_link_array(&core->selection.polygonSlot, core->polygonCapacity, data->polygonCapacity) ||
+            !grow_index_array(&core->freeList.freePolygons, data->polygonCapacity) ||
+            !grow_link_array(&core->adjacency.polygonFirstUse, core->polygonCapacity, data->polygonCapacity) ||
+            !grow_bit_array(&core->live.polygons, core->polygonCapacity, data->polygonCapacity) ||
+            !grow_bit_array(&core->journal.polygonRecorded, core->polygonCapacity, data->polygonCapacity) ||
+            !grow_page_bits(&core->changes.polygons, core->polygonCapacity, data->polygonCapacity) ||
+            !grow_byte_array(&core->mergeStatus.polygonDuplicates, core->polygonCapacity, data->polygonCapacity) ||
+            !grow_double_array(&core->flatCache.deviation, data->polygonCapacity) ||
+            !grow_double_array(&core->flatCache.normal, 3 * data->polygonCapacity) ||
+            !grow_bit_array(&core->flatCache.current, core->polygonCapacity, data->polygonCapacity)) {
+            return 0;
+        }
+        core->polygonCapacity = data->polygonCapacity;
+    }
+    if (data->objectCapacity > core->objectCapacity) {
+        if (!grow_index_array(&core->freeList.freeObjects, data->objectCapacity) ||
+            !grow_bit_array(&core->live.objects, core->objectCapacity, data->objectCapacity) ||
+            !grow_bit_array(&core->journal.objectRecorded, core->objectCapacity, data->objectCapacity) ||
+            !grow_page_bits(&core->changes.objects, core->objectCapacity, data->objectCapacity)) {
+            return 0;
+        }
+        core->objectCapacity = data->objectCapacity;
+    }
+    return 1;
 }
 
-int CadCore_DeletePolygon(CadCore* core, int16_t polygonIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
-    
-    /* Mark as deleted */
-    core->data.polygons[polygonIndex].flags = 0;
-    core->data.polygons[polygonIndex].selectFlag = 0;
-    
-    /* Remove from selection if selected */
-    CadCore_DeselectPolygon(core, polygonIndex);
-    
-    core->isDirty = 1;
-    return 1;
+int CadCore_Reserve(CadCore* core, int objects, int polygons, int points) {
+    if (!core) return 0;
+    if (!CadFile_Reserve(&core->data, objects, polygons, points)) return 0;
+    return sync_capacity(core);
 }
 
-CadPolygon* CadCore_GetPolygon(CadCore* core, int16_t index) {
-    if (!core || !CadCore_IsPolygonValid(core, index)) return NULL;
-    return &core->data.polygons[index];
+/* ----------------------------------------------------------------------------
+   Live-slot bitsets
+   ---------------------------------------------------------------------------- */
+
+static void set_bit(uint64_t* words, CadIndex i) {
+    words[i >> 6] |= (uint64_t)1 << (i & 63);
 }
 
-int CadCore_IsPolygonValid(CadCore* core, int16_t index) {
-    if (!core || index < 0 || index >= CAD_MAX_POLYGONS) return 0;
-    return core->data.polygons[index].flags != 0;
+static void clear_bit(uint64_t* words, CadIndex i) {
+    words[i >> 6] &= ~((uint64_t)1 << (i & 63));
 }
 
-int CadCore_AddPointToPolygon(CadCore* core, int16_t polygonIndex, int16_t pointIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex) || !CadCore_IsPointValid(core, pointIndex)) {
-        return 0;
-    }
-    
-    CadPolygon* poly = &core->data.polygons[polygonIndex];
+static int lowest_bit(uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    if (_BitScanForward(&bit, (unsigned long)word)) return (int)bit;
+    _BitScanForward(&bit, (unsigned long)(word >> 32));
+    return (int)bit + 32;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+/* First set bit >= from below limit, or INVALID_INDEX */
+static CadIndex next_set_bit(const uint64_t* words, int limit, CadIndex from) {
+    if (from < 0) from = 0;
+    if (from >= limit) return INVALID_INDEX;
     
-    /* Find the last point in the polygon's chain */
-    int16_t current = poly->firstPoint;
-    if (current == INVALID_INDEX) {
-        /* First point */
-        poly->firstPoint = pointIndex;
-        poly->npoints = 1;
-    } else {
-        /* Traverse to end of chain */
-        while (core->data.points[current].nextPoint != INVALID_INDEX) {
-            current = core->data.points[current].nextPoint;
+    int w = from >> 6;
+    int last = (limit - 1) >> 6;
+    uint64_t word = words[w] & (~(uint64_t)0 << (from & 63));
+    for (;;) {
+        if (word) {
+            CadIndex i = (CadIndex)((w << 6) + lowest_bit(word));
+            return i < limit ? i : INVALID_INDEX;
         }
-        /* Link new point */
-        core->data.points[current].nextPoint = pointIndex;
-        poly->npoints++;
+        if (++w > last) return INVALID_INDEX;
+        word = words[w];
     }
-    
-    core->isDirty = 1;
-    return 1;
+}
+
+CadIndex CadCore_NextLivePoint(const CadCore* core, CadIndex from) {
+    if (!core) return INVALID_INDEX;
+    return next_set_bit(core->live.points, core->data.pointCount, from);
+}
+
+CadIndex CadCore_NextLivePolygon(const CadCore* core, CadIndex from) {
+    if (!core) return INVALID_INDEX;
+    return next_set_bit(core->live.polygons, core->data.polygonCount, from);
+}
+
+CadIndex CadCore_NextLiveObject(const CadCore* core, CadIndex from) {
+    if (!core) return INVALID_INDEX;
+    return next_set_bit(core->live.objects, core->data.objectCount, from);
 }
 
 /* ----------------------------------------------------------------------------
-   Object operations
+   Point spatial hash
    ---------------------------------------------------------------------------- */
 
-int16_t CadCore_AddObject(CadCore* core, int16_t parentObject, double ox, double oy, double oz) {
-    if (!core) return INVALID_INDEX;
-    
-    /* Find first free slot */
-    for (int16_t i = 0; i < CAD_MAX_OBJECTS; i++) {
-        if (core->data.objects[i].flags == 0) {
-            CadObject* obj = &core->data.objects[i];
-            obj->flags = 1;
-            obj->selectFlag = 0;
-            obj->parentObject = parentObject;
-            obj->nextBrother = INVALID_INDEX;
-            obj->childObject = INVALID_INDEX;
-            obj->firstPolygon = INVALID_INDEX;
-            obj->offsetx = ox;
-            obj->offsety = oy;
-            obj->offsetz = oz;
-            
-            if (i >= core->data.objectCount) {
-                core->data.objectCount = i + 1;
-            }
-            
-            core->isDirty = 1;
-            return i;
-        }
-    }
-    
-    return INVALID_INDEX;
+#define SPATIAL_MIN_BUCKETS 64
+#define SPATIAL_CELL_LIMIT  1e15   /* Clamp for far-out or NaN coordinates */
+
+static int64_t spatial_cell(double v) {
+    double c = floor(v / CAD_SPATIAL_CELL_SIZE);
+    if (!(c > -SPATIAL_CELL_LIMIT)) c = -SPATIAL_CELL_LIMIT;
+    if (c > SPATIAL_CELL_LIMIT) c = SPATIAL_CELL_LIMIT;
+    return (int64_t)c;
 }
 
-int CadCore_DeleteObject(CadCore* core, int16_t objectIndex) {
-    if (!core || !CadCore_IsObjectValid(core, objectIndex)) return 0;
-    
-    /* Mark as deleted */
-    core->data.objects[objectIndex].flags = 0;
-    core->data.objects[objectIndex].selectFlag = 0;
-    
-    core->isDirty = 1;
-    return 1;
+/* Hash of integer cell coordinates, mixed so the low bits use every input bit */
+static uint32_t hash_cell(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t h = x * 73856093u ^ y * 19349663u ^ z * 83492791u;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    return h;
 }
 
-CadObject* CadCore_GetObject(CadCore* core, int16_t index) {
-    if (!core || !CadCore_IsObjectValid(core, index)) return NULL;
-    return &core->data.objects[index];
+static CadIndex spatial_bucket(const CadSpatialHash* hash, int64_t cx, int64_t cy, int64_t cz) {
+    uint32_t h = hash_cell((uint32_t)cx, (uint32_t)cy, (uint32_t)cz);
+    return (CadIndex)(h & (uint32_t)(hash->bucketCount - 1));
 }
 
-int CadCore_IsObjectValid(CadCore* core, int16_t index) {
-    if (!core || index < 0 || index >= CAD_MAX_OBJECTS) return 0;
-    return core->data.objects[index].flags != 0;
+static CadIndex spatial_point_bucket(const CadCore* core, CadIndex i) {
+    const CadFileData* data = &core->data;
+    return spatial_bucket(&core->spatial, spatial_cell(data->pointX[i]),
+                          spatial_cell(data->pointY[i]), spatial_cell(data->pointZ[i]));
 }
 
-/* ----------------------------------------------------------------------------
-   Selection operations
-   ---------------------------------------------------------------------------- */
+static void spatial_link(CadSpatialHash* hash, CadIndex i, CadIndex b) {
+    CadIndex head = hash->buckets[b];
+    hash->next[i] = head;
+    hash->prev[i] = INVALID_INDEX;
+    if (head != INVALID_INDEX) hash->prev[head] = i;
+    hash->buckets[b] = i;
+    hash->bucket[i] = b;
+    hash->pointCount++;
+}
 
-void CadCore_ClearSelection(CadCore* core) {
-    if (!core) return;
-    
-    /* Clear all selection flags */
-    for (int i = 0; i < core->data.pointCount; i++) {
-        if (CadCore_IsPointValid(core, i)) {
-            core->data.points[i].selectFlag = 0;
-        }
-    }
-    for (int i = 0; i < core->data.polygonCount; i++) {
-        if (CadCore_IsPolygonValid(core, i)) {
-            core->data.polygons[i].selectFlag = 0;
-        }
-    }
+static void spatial_unlink(CadSpatialHash* hash, CadIndex i) {
+    CadIndex b = hash->bucket[i];
+    if (b == INVALID_INDEX) return;
+    CadIndex prev = hash->prev[i];
+    CadIndex next = hash->next[i];
+    if (prev != INVALID_INDEX) hash->next[prev] = next;
+    else hash->buckets[b] = next;
+    if (next != INVALID_INDEX) hash->prev[next] = prev;
+    hash->bucket[i] = INVALID_INDEX;
+    hash->pointCount--;
+}
+
+/* Re-bucket point i after its coordinates or liveness changed */
+static void spatial_update_point(CadCore* core, CadIndex i) {
+    CadSpatialHash* hash = &core->spatial;
+    if (!hash->valid) return;
     
-    /* Clear selection arrays */
-    for (int i = 0; i < CAD_MAX_POINTS; i++) {
-        core->selection.selectedPoints[i] = INVALID_INDEX;
+    if (core->data.points[i].flags == 0) {
+        spatial_unlink(hash, i);
+        return;
     }
-    for (int i = 0; i < CAD_MAX_POLYGONS; i++) {
-        core->selection.selectedPolygons[i] = INVALID_INDEX;
+    CadIndex b = spatial_point_bucket(core, i);
+    if (hash->bucket[i] == b) return; /* Moved within its cell */
+    spatial_unlink(hash, i);
+    if (hash->pointCount >= hash->bucketCount) {
+        hash->valid = 0; /* Load factor 1: rebuild larger on the next query */
+        return;
     }
-    
-    core->selection.pointCount = 0;
-    core->selection.polygonCount = 0;
+    spatial_link(hash, i, b);
 }
 
-void CadCore_SelectPoint(CadCore* core, int16_t pointIndex) {
-    if (!core || !CadCore_IsPointValid(core, pointIndex)) return;
-    if (CadCore_IsPointSelected(core, pointIndex)) return; /* Already selected */
+static int spatial_rebuild(CadCore* core) {
+    CadSpatialHash* hash = &core->spatial;
+    int buckets = SPATIAL_MIN_BUCKETS;
+    while (buckets < (1 << 30) && buckets / 2 < core->live.pointCount) buckets *= 2;
     
-    core->data.points[pointIndex].selectFlag = 1;
+    if (buckets != hash->bucketCount) {
+        CadIndex* grown = (CadIndex*)realloc(hash->buckets, (size_t)buckets * sizeof(CadIndex));
+        if (!grown) return 0;
+        hash->buckets = grown;
+        hash->bucketCount = buckets;
+    }
+    for (int b = 0; b < buckets; b++) hash->buckets[b] = INVALID_INDEX;
+    for (int i = 0; i < core->pointCapacity; i++) hash->bucket[i] = INVALID_INDEX;
+    hash->pointCount = 0;
     
-    /* Add to selection array */
-    if (core->selection.pointCount < CAD_MAX_POINTS) {
-        core->selection.selectedPoints[core->selection.pointCount++] = pointIndex;
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        spatial_link(hash, i, spatial_point_bucket(core, i));
     }
+    hash->valid = 1;
+    return 1;
 }
 
-void CadCore_SelectPolygon(CadCore* core, int16_t polygonIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return;
-    if (CadCore_IsPolygonSelected(core, polygonIndex)) return; /* Already selected */
+static int point_within(const CadFileData* data, CadIndex i, double x, double y, double z, double radius_sq) {
+    double dx = data->pointX[i] - x;
+    double dy = data->pointY[i] - y;
+    double dz = data->pointZ[i] - z;
+    return dx * dx + dy * dy + dz * dz <= radius_sq;
+}
+
+int CadCore_FindPointsNear(const CadCore* core, double x, double y, double z, double radius,
+                           CadIndex* out, int maxCount) {
+    if (!core || !(radius >= 0.0)) return 0;
     
-    core->data.polygons[polygonIndex].selectFlag = 1;
+    const CadFileData* data = &core->data;
+    const CadSpatialHash* hash = &core->spatial;
+    double radius_sq = radius * radius;
+    int found = 0;
     
-    /* Add to selection array */
-    if (core->selection.polygonCount < CAD_MAX_POLYGONS) {
-        core->selection.selectedPolygons[core->selection.polygonCount++] = polygonIndex;
+    if (!hash->valid && !spatial_rebuild((CadCore*)core)) {
+        fprintf(stderr, "Error: Out of memory building spatial hash\n");
     }
-}
-
-void CadCore_DeselectPoint(CadCore* core, int16_t pointIndex) {
-    if (!core || !CadCore_IsPointValid(core, pointIndex)) return;
     
-    core->data.points[pointIndex].selectFlag = 0;
+    int64_t x0 = spatial_cell(x - radius), x1 = spatial_cell(x + radius);
+    int64_t y0 = spatial_cell(y - radius), y1 = spatial_cell(y + radius);
+    int64_t z0 = spatial_cell(z - radius), z1 = spatial_cell(z + radius);
+    double cells = (double)(x1 - x0 + 1) * (double)(y1 - y0 + 1) * (double)(z1 - z0 + 1);
     
-    /* Remove from selection array */
-    for (int i = 0; i < core->selection.pointCount; i++) {
-        if (core->selection.selectedPoints[i] == pointIndex) {
-            /* Shift remaining elements */
-            for (int j = i; j < core->selection.pointCount - 1; j++) {
-                core->selection.selectedPoints[j] = core->selection.selectedPoints[j + 1];
-            }
-            core->selection.selectedPoints[core->selection.pointCount - 1] = INVALID_INDEX;
-            core->selection.pointCount--;
-            break;
+    if (!hash->valid || cells > (double)hash->bucketCount) {
+        /* Wider than the table (or no table): one pass over the live points */
+        for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+            if (!point_within(data, i, x, y, z, radius_sq)) continue;
+            if (out && found < maxCount) out[found] = i;
+            found++;
         }
+        return found;
     }
-}
-
-void CadCore_DeselectPolygon(CadCore* core, int16_t polygonIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return;
-    
-    core->data.polygons[polygonIndex].selectFlag = 0;
     
-    /* Remove from selection array */
-    for (int i = 0; i < core->selection.polygonCount; i++) {
-        if (core->selection.selectedPolygons[i] == polygonIndex) {
-            /* Shift remaining elements */
-            for (int j = i; j < core->selection.polygonCount - 1; j++) {
-                core->selection.selectedPolygons[j] = core->selection.selectedPolygons[j + 1];
+    for (int64_t cx = x0; cx <= x1; cx++) {
+        for (int64_t cy = y0; cy <= y1; cy++) {
+            for (int64_t cz = z0; cz <= z1; cz++) {
+                CadIndex b = spatial_bucket(hash, cx, cy, cz);
+                for (CadIndex i = hash->buckets[b]; i != INVALID_INDEX; i = hash->next[i]) {
+                    /* Buckets are shared by distant cells; take each point
+                       only from its own cell so none is reported twice */
+                    if (spatial_cell(data->pointX[i]) != cx || spatial_cell(data->pointY[i]) != cy ||
+                        spatial_cell(data->pointZ[i]) != cz) continue;
+                    if (!point_within(data, i, x, y, z, radius_sq)) continue;
+                    if (out && found < maxCount) out[found] = i;
+                    found++;
+                }
             }
-            core->selection.selectedPolygons[core->selection.polygonCount - 1] = INVALID_INDEX;
-            core->selection.polygonCount--;
-            break;
         }
     }
+    return found;
 }
 
-int CadCore_IsPointSelected(CadCore* core, int16_t pointIndex) {
-    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
-    return core->data.points[pointIndex].selectFlag != 0;
+/* ----------------------------------------------------------------------------
+   Undo journal recording
+   Mutators call journal_point/polygon/object before their first write to a
+   record and journal_slot after taking or releasing a slot. Nothing is
+   recorded outside a group or while undo/redo replays deltas.
+   ---------------------------------------------------------------------------- */
+
+static int journal_recording(const CadCore* core) {
+    return core->journal.depth > 0 && !core->journal.replaying && !core->journal.failed;
 }
 
-int CadCore_IsPolygonSelected(CadCore* core, int16_t polygonIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
-    return core->data.polygons[polygonIndex].selectFlag != 0;
+static int test_bit(const uint64_t* words, CadIndex i) {
+    return (int)((words[i >> 6] >> (i & 63)) & 1);
 }
 
-void CadCore_SelectAll(CadCore* core) {
-    if (!core) return;
+/* Clear the once-per-group bits set by deltas [first, last) */
+static void journal_clear_recorded(CadCore* core, int first, int last) {
+    CadJournal* j = &core->journal;
+    for (int k = first; k < last; k++) {
+        const CadDelta* d = &j->deltas[k];
+        switch (d->kind) {
+        case CAD_DELTA_POINT: clear_bit(j->pointRecorded, d->index); break;
+        case CAD_DELTA_POLYGON: clear_bit(j->polygonRecorded, d->index); break;
+        case CAD_DELTA_OBJECT: clear_bit(j->objectRecorded, d->index); break;
+        default: break;
+        }
+    }
+}
+
+static void journal_reset(CadCore* core) {
+    CadJournal* j = &core->journal;
+    if (j->openFirst != INVALID_INDEX) journal_clear_recorded(core, j->openFirst, j->deltaCount);
+    j->deltaCount = 0;
+    j->groupCount = 0;
+    j->groupBase = 0;
+    j->cursor = 0;
+    j->openFirst = INVALID_INDEX;
+}
+
+static CadDelta* journal_push(CadCore* core) {
+    CadJournal* j = &core->journal;
     
-    if (core->selectModeFlag == 1) {
-        /* Select all points */
-        for (int i = 0; i < core->data.pointCount; i++) {
-            if (CadCore_IsPointValid(core, i)) {
-                CadCore_SelectPoint(core, i);
-            }
+    /* The first delta of a new step discards everything that could be redone */
+    if (j->openFirst == INVALID_INDEX) {
+        if (j->cursor < j->groupCount) {
+            j->deltaCount = j->groups[j->cursor].firstDelta;
+            j->groupCount = j->cursor;
         }
-    } else {
-        /* Select all polygons */
-        for (int i = 0; i < core->data.polygonCount; i++) {
-            if (CadCore_IsPolygonValid(core, i)) {
-                CadCore_SelectPolygon(core, i);
-            }
+        j->openFirst = j->deltaCount;
+    }
+    if (j->deltaCount >= j->deltaCapacity) {
+        int capacity = j->deltaCapacity > 0 ? j->deltaCapacity * 2 : 256;
+        CadDelta* grown = (CadDelta*)realloc(j->deltas, (size_t)capacity * sizeof(CadDelta));
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory recording undo step; history cleared\n");
+            journal_reset(core);
+            j->failed = 1;
+            return NULL;
         }
+        j->deltas = grown;
+        j->deltaCapacity = capacity;
     }
+    CadDelta* d = &j->deltas[j->deltaCount++];
+    memset(d, 0, sizeof(CadDelta));
+    return d;
+}
+
+static void journal_point(CadCore* core, CadIndex i) {
+    if (!journal_recording(core) || test_bit(core->journal.pointRecorded, i)) return;
+    CadDelta* d = journal_push(core);
+    if (!d) return;
+    set_bit(core->journal.pointRecorded, i);
+    d->kind = CAD_DELTA_POINT;
+    d->index = i;
+    d->u.point.record = core->data.points[i];
+    d->u.point.x = core->data.pointX[i];
+    d->u.point.y = core->data.pointY[i];
+    d->u.point.z = core->data.pointZ[i];
+}
+
+static void journal_polygon(CadCore* core, CadIndex i) {
+    if (!journal_recording(core) || test_bit(core->journal.polygonRecorded, i)) return;
+    CadDelta* d = journal_push(core);
+    if (!d) return;
+    set_bit(core->journal.polygonRecorded, i);
+    d->kind = CAD_DELTA_POLYGON;
+    d->index = i;
+    d->u.polygon = core->data.polygons[i];
+}
+
+static void journal_object(CadCore* core, CadIndex i) {
+    if (!journal_recording(core) || test_bit(core->journal.objectRecorded, i)) return;
+    CadDelta* d = journal_push(core);
+    if (!d) return;
+    set_bit(core->journal.objectRecorded, i);
+    d->kind = CAD_DELTA_OBJECT;
+    d->index = i;
+    d->u.object = core->data.objects[i];
+}
+
+static void journal_slot(CadCore* core, CadDeltaKind kind, CadPoolKind pool, CadIndex i, int fromFreeList) {
+    if (!journal_recording(core)) return;
+    CadDelta* d = journal_push(core);
+    if (!d) return;
+    d->kind = (uint8_t)kind;
+    d->pool = (uint8_t)pool;
+    d->fromFreeList = (uint8_t)fromFreeList;
+    d->index = i;
 }
 
 /* ----------------------------------------------------------------------------
-   Edit mode
+   Free slot lists
    ---------------------------------------------------------------------------- */
 
-void CadCore_SetEditMode(CadCore* core, CadEditMode mode) {
+void CadCore_RebuildFreeLists(CadCore* core) {
     if (!core) return;
-    core->editMode = mode;
+    if (!sync_capacity(core)) {
+        fprintf(stderr, "Error: Out of memory sizing selection/free lists\n");
+        return;
+    }
     
-    /* Update selectModeFlag based on mode */
-    if (mode == CAD_MODE_SELECT_POINT || mode == CAD_MODE_EDIT_POINT) {
-        core->selectModeFlag = 1;
-    } else if (mode == CAD_MODE_SELECT_POLYGON || mode == CAD_MODE_EDIT_POLYGON) {
-        core->selectModeFlag = 0;
+    /* Journaled slot pops and pushes assume the old stack order */
+    journal_reset(core);
+    
+    CadFreeList* fl = &core->freeList;
+    CadLiveSlots* live = &core->live;
+    fl->pointCount = 0;
+    fl->polygonCount = 0;
+    fl->objectCount = 0;
+    if (core->pointCapacity > 0) memset(live->points, 0, BIT_WORDS(core->pointCapacity) * sizeof(uint64_t));
+    if (core->polygonCapacity > 0) memset(live->polygons, 0, BIT_WORDS(core->polygonCapacity) * sizeof(uint64_t));
+    if (core->objectCapacity > 0) memset(live->objects, 0, BIT_WORDS(core->objectCapacity) * sizeof(uint64_t));
+    
+    /* Push holes highest first so the lowest free slot is popped first */
+    for (int i = core->data.pointCount - 1; i >= 0; i--) {
+        if (core->data.points[i].flags == 0) fl->freePoints[fl->pointCount++] = (CadIndex)i;
+        else set_bit(live->points, i);
     }
+    for (int i = core->data.polygonCount - 1; i >= 0; i--) {
+        if (core->data.polygons[i].flags == 0) fl->freePolygons[fl->polygonCount++] = (CadIndex)i;
+        else set_bit(live->polygons, i);
+    }
+    for (int i = core->data.objectCount - 1; i >= 0; i--) {
+        if (core->data.objects[i].flags == 0) fl->freeObjects[fl->objectCount++] = (CadIndex)i;
+        else set_bit(live->objects, i);
+    }
+    live->pointCount = core->data.pointCount - fl->pointCount;
+    live->polygonCount = core->data.polygonCount - fl->polygonCount;
+    live->objectCount = core->data.objectCount - fl->objectCount;
 }
 
-CadEditMode CadCore_GetEditMode(CadCore* core) {
-    if (!core) return CAD_MODE_SELECT_POINT;
-    return core->editMode;
+/* Pop a free slot, or return INVALID_INDEX if the pool has no holes */
+static CadIndex pop_free_slot(CadIndex* freeSlots, int* freeCount) {
+    if (*freeCount > 0) {
+        return freeSlots[--(*freeCount)];
+    }
+    return INVALID_INDEX;
 }
 
 /* ----------------------------------------------------------------------------
-   Linked list helpers
+   Merge status
+   Counts are only maintained while valid; an invalid status is recounted
+   from scratch by merge_status_refresh.
    ---------------------------------------------------------------------------- */
 
-int16_t CadCore_GetFirstPointOfPolygon(CadCore* core, int16_t polygonIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return INVALID_INDEX;
-    return core->data.polygons[polygonIndex].firstPoint;
+/* Defined with the merge operations below */
+static int off_grid(double v, double step);
+static int same_grid_location(const CadFileData* data, CadIndex a, CadIndex b);
+
+static int point_off_grid(const CadCore* core, CadIndex i) {
+    const CadFileData* data = &core->data;
+    return data->points[i].flags != 0 &&
+           (off_grid(data->pointX[i], 1.0) || off_grid(data->pointY[i], 1.0) || off_grid(data->pointZ[i], 1.0));
 }
 
-int16_t CadCore_GetNextPoint(CadCore* core, int16_t pointIndex) {
-    if (!core || !CadCore_IsPointValid(core, pointIndex)) return INVALID_INDEX;
-    return core->data.points[pointIndex].nextPoint;
+/* Duplicate edges of a polygon's walk. Its use nodes list the walk in
+   reverse, which pairs the same neighbours. */
+static int polygon_duplicate_edges(const CadCore* core, CadIndex p) {
+    const CadAdjacency* adj = &core->adjacency;
+    CadIndex first = adj->polygonFirstUse[p];
+    if (first == INVALID_INDEX) return 0;
+    
+    int duplicates = 0;
+    CadIndex last = first;
+    for (CadIndex n = adj->nodes[first].nextInPolygon; n != INVALID_INDEX; n = adj->nodes[n].nextInPolygon) {
+        if (same_grid_location(&core->data, adj->nodes[last].point, adj->nodes[n].point)) duplicates++;
+        last = n;
+    }
+    if (same_grid_location(&core->data, adj->nodes[first].point, adj->nodes[last].point)) duplicates++;
+    return duplicates;
 }
 
-int16_t CadCore_GetNextPolygon(CadCore* core, int16_t polygonIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return INVALID_INDEX;
-    return core->data.polygons[polygonIndex].nextPolygon;
+static void merge_status_unlink_polygon(CadCore* core, CadIndex p) {
+    CadMergeStatus* status = &core->mergeStatus;
+    if (!status->valid) return;
+    status->duplicateEdges -= status->polygonDuplicates[p];
+    status->polygonDuplicates[p] = 0;
 }
 
-int16_t CadCore_GetFirstPolygonOfObject(CadCore* core, int16_t objectIndex) {
-    if (!core || !CadCore_IsObjectValid(core, objectIndex)) return INVALID_INDEX;
-    return core->data.objects[objectIndex].firstPolygon;
+static void merge_status_link_polygon(CadCore* core, CadIndex p) {
+    CadMergeStatus* status = &core->mergeStatus;
+    if (!status->valid) return;
+    int duplicates = polygon_duplicate_edges(core, p);
+    status->duplicateEdges += duplicates - status->polygonDuplicates[p];
+    status->polygonDuplicates[p] = (uint8_t)duplicates;
 }
 
-/* ----------------------------------------------------------------------------
+/* After a point is added, moved or deleted */
+static void merge_status_update_point(CadCore* core, CadIndex i) {
+    CadMergeStatus* status = &core->mergeStatus;
+    if (!status->valid) return;
+    
+    int was = (status->pointOffGrid[i >> 6] >> (i & 63)) & 1;
+    int is = point_off_grid(core, i);
+    if (was != is) {
+        status->pointOffGrid[i >> 6] ^= (uint64_t)1 << (i & 63);
+        status->offGridPoints += is - was;
+    }
+    const CadAdjacency* adj = &core->adjacency;
+    for (CadIndex n = adj->pointFirstUse[i]; n != INVALID_INDEX; n = adj->nodes[n].nextInPoint) {
+        merge_status_link_polygon(core, adj->nodes[n].polygon);
+    }
+}
+
+static void merge_status_refresh(CadCore* core) {
+    CadMergeStatus* status = &core->mergeStatus;
+    if (!status->valid) {
+        if (status->pointOffGrid) {
+            memset(status->pointOffGrid, 0, (size_t)BIT_WORDS(core->pointCapacity) * sizeof(uint64_t));
+        }
+        if (status->polygonDuplicates) memset(status->polygonDuplicates, 0, (size_t)core->polygonCapacity);
+        status->offGridPoints = 0;
+        status->duplicateEdges = 0;
+        status->valid = 1;
+        for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+            merge_status_update_point(core, i);
+        }
+        for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+            merge_status_link_polygon(core, p);
+        }
+    }
+    if (status->objectGeometry != core->changes.objects.geometry) {
+        const CadFileData* data = &core->data;
+        status->offGridObjects = 0;
+        for (CadIndex o = CadCore_NextLiveObject(core, 0); o >= 0; o = CadCore_NextLiveObject(core, o + 1)) {
+            const CadObject* obj = &data->objects[o];
+            if (off_grid(obj->offsetx, 1.0) || off_grid(obj->offsety, 1.0) || off_grid(obj->offsetz, 1.0)) {
+                status->offGridObjects++;
+            }
+        }
+        status->objectGeometry = core->changes.objects.geometry;
+    }
+}
+
+void CadCore_GetMergeStatus(CadCore* core, int* offGridPoints, int* offGridObjects, int* duplicateEdges) {
+    if (!core) return;
+    merge_status_refresh(core);
+    if (offGridPoints) *offGridPoints = core->mergeStatus.offGridPoints;
+    if (offGridObjects) *offGridObjects = core->mergeStatus.offGridObjects;
+    if (duplicateEdges) *duplicateEdges = core->mergeStatus.duplicateEdges;
+}
+
+/* ----------------------------------------------------------------------------
+   Point change hook
+   ---------------------------------------------------------------------------- */
+
+/* After a point is added, moved or deleted: re-index it, recount its merge
+   status and drop the cached planarity of its users */
+static void point_changed(CadCore* core, CadIndex i) {
+    spatial_update_point(core, i);
+    merge_status_update_point(core, i);
+    const CadAdjacency* adj = &core->adjacency;
+    for (CadIndex n = adj->pointFirstUse[i]; n != INVALID_INDEX; n = adj->nodes[n].nextInPoint) {
+        flat_cache_invalidate(core, adj->nodes[n].polygon);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   Point-to-polygon adjacency
+   ---------------------------------------------------------------------------- */
+
+static CadIndex alloc_use_node(CadAdjacency* adj) {
+    if (adj->freeNode != INVALID_INDEX) {
+        CadIndex n = adj->freeNode;
+        adj->freeNode = adj->nodes[n].nextInPolygon;
+        return n;
+    }
+    if (adj->nodeCount >= adj->nodeCapacity) {
+        int capacity = adj->nodeCapacity > 0 ? adj->nodeCapacity * 2 : CAD_POOL_MIN_CAPACITY * 4;
+        if (capacity > CAD_MAX_INDEX + 1) capacity = CAD_MAX_INDEX + 1;
+        if (adj->nodeCount >= capacity) return INVALID_INDEX;
+        CadUseNode* grown = (CadUseNode*)realloc(adj->nodes, (size_t)capacity * sizeof(CadUseNode));
+        if (!grown) return INVALID_INDEX;
+        adj->nodes = grown;
+        adj->nodeCapacity = capacity;
+    }
+    return (CadIndex)adj->nodeCount++;
+}
+
+/* Drop every node of a polygon from its points' use lists */
+static void adjacency_unlink_polygon(CadCore* core, CadIndex polygonIndex) {
+    CadAdjacency* adj = &core->adjacency;
+    mark_topology(&core->changes.polygons, polygonIndex);
+    merge_status_unlink_polygon(core, polygonIndex);
+    flat_cache_invalidate(core, polygonIndex);
+    CadIndex n = adj->polygonFirstUse[polygonIndex];
+    while (n != INVALID_INDEX) {
+        CadUseNode* node = &adj->nodes[n];
+        CadIndex next = node->nextInPolygon;
+        
+        if (node->prevInPoint != INVALID_INDEX) {
+            adj->nodes[node->prevInPoint].nextInPoint = node->nextInPoint;
+        } else {
+            adj->pointFirstUse[node->point] = node->nextInPoint;
+        }
+        if (node->nextInPoint != INVALID_INDEX) {
+            adj->nodes[node->nextInPoint].prevInPoint = node->prevInPoint;
+        }
+        
+        node->nextInPolygon = adj->freeNode;
+        adj->freeNode = n;
+        n = next;
+    }
+    adj->polygonFirstUse[polygonIndex] = INVALID_INDEX;
+}
+
+/* Walk a polygon's chain (npoints vertices, stopping at an invalid or
+   repeated point like the renderer) and add one node per vertex */
+static void adjacency_link_polygon(CadCore* core, CadIndex polygonIndex) {
+    CadAdjacency* adj = &core->adjacency;
+    const CadPolygon* poly = &core->data.polygons[polygonIndex];
+    if (poly->flags == 0 || poly->npoints < 2) return;
+    
+    CadIndex previous = INVALID_INDEX;
+    CadIndex current = poly->firstPoint;
+    int count = 0;
+    while (count < poly->npoints && CadCore_IsPointValid(core, current)) {
+        /* Nodes are pushed at the head of the use list, so a repeated
+           vertex of this polygon is always found there */
+        CadIndex head = adj->pointFirstUse[current];
+        if (head != INVALID_INDEX && adj->nodes[head].polygon == polygonIndex) break;
+        
+        CadIndex n = alloc_use_node(adj);
+        if (n == INVALID_INDEX) {
+            fprintf(stderr, "Error: Out of memory updating point adjacency\n");
+            return;
+        }
+        CadUseNode* node = &adj->nodes[n];
+        node->polygon = polygonIndex;
+        node->point = current;
+        node->prevInPoint = INVALID_INDEX;
+        node->nextInPoint = head;
+        if (head != INVALID_INDEX) adj->nodes[head].prevInPoint = n;
+        adj->pointFirstUse[current] = n;
+        node->nextInPolygon = adj->polygonFirstUse[polygonIndex];
+        adj->polygonFirstUse[polygonIndex] = n;
+        
+        previous = current;
+        current = core->data.points[current].nextPoint;
+        count++;
+    }
+    
+    /* A link into a dead or unallocated slot ends every walk just like -1,
+       but would silently extend this one once the slot is (re)allocated */
+    if (count < poly->npoints && current != INVALID_INDEX && !CadCore_IsPointValid(core, current)) {
+        if (previous != INVALID_INDEX) {
+            journal_point(core, previous);
+            core->data.points[previous].nextPoint = INVALID_INDEX;
+            mark_topology(&core->changes.points, previous);
+        } else {
+            journal_polygon(core, polygonIndex);
+            core->data.polygons[polygonIndex].firstPoint = INVALID_INDEX;
+        }
+    }
+}
+
+static void adjacency_refresh_polygon(CadCore* core, CadIndex polygonIndex) {
+    adjacency_unlink_polygon(core, polygonIndex);
+    adjacency_link_polygon(core, polygonIndex);
+    merge_status_link_polygon(core, polygonIndex);
+}
+
+/* Re-walk every polygon whose chain passes through a point whose link or
+   validity just changed; other polygons cannot be affected */
+static void adjacency_refresh_point_users(CadCore* core, CadIndex pointIndex) {
+    CadIndex stack_users[64];
+    CadIndex* users = stack_users;
+    int count = CadCore_GetPointPolygons(core, pointIndex, NULL, 0);
+    if (count == 0) return;
+    if (count > 64) {
+        users = (CadIndex*)malloc((size_t)count * sizeof(CadIndex));
+        if (!users) {
+            CadCore_RebuildAdjacency(core);
+            return;
+        }
+    }
+    CadCore_GetPointPolygons(core, pointIndex, users, count);
+    for (int i = 0; i < count; i++) {
+        adjacency_refresh_polygon(core, users[i]);
+    }
+    if (users != stack_users) free(users);
+}
+
+/* Clear the links that reach a point from the chains of its users */
+static void detach_point_from_chains(CadCore* core, CadIndex pointIndex) {
+    const CadAdjacency* adj = &core->adjacency;
+    for (CadIndex n = adj->pointFirstUse[pointIndex]; n != INVALID_INDEX; n = adj->nodes[n].nextInPoint) {
+        CadPolygon* poly = &core->data.polygons[adj->nodes[n].polygon];
+        if (poly->firstPoint == pointIndex) {
+            journal_polygon(core, adj->nodes[n].polygon);
+            poly->firstPoint = INVALID_INDEX;
+            continue;
+        }
+        for (CadIndex m = adj->polygonFirstUse[adj->nodes[n].polygon]; m != INVALID_INDEX; m = adj->nodes[m].nextInPolygon) {
+            CadPoint* pt = &core->data.points[adj->nodes[m].point];
+            if (pt->nextPoint == pointIndex) {
+                journal_point(core, adj->nodes[m].point);
+                pt->nextPoint = INVALID_INDEX;
+                mark_topology(&core->changes.points, adj->nodes[m].point);
+            }
+        }
+    }
+}
+
+void CadCore_RebuildAdjacency(CadCore* core) {
+    if (!core) return;
+    if (!sync_capacity(core)) {
+        fprintf(stderr, "Error: Out of memory sizing point adjacency\n");
+        return;
+    }
+    
+    CadAdjacency* adj = &core->adjacency;
+    for (int i = 0; i < core->pointCapacity; i++) adj->pointFirstUse[i] = INVALID_INDEX;
+    for (int i = 0; i < core->polygonCapacity; i++) adj->polygonFirstUse[i] = INVALID_INDEX;
+    adj->nodeCount = 0;
+    adj->freeNode = INVALID_INDEX;
+    core->changes.polygons.topology++;
+    core->mergeStatus.valid = 0;
+    flat_cache_invalidate_all(core);
+    
+    for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
+        adjacency_link_polygon(core, i);
+    }
+}
+
+int CadCore_GetPointPolygons(CadCore* core, CadIndex pointIndex, CadIndex* out, int maxCount) {
+    if (!core || pointIndex < 0 || pointIndex >= core->data.pointCount) return 0;
+    
+    const CadAdjacency* adj = &core->adjacency;
+    int count = 0;
+    for (CadIndex n = adj->pointFirstUse[pointIndex]; n != INVALID_INDEX; n = adj->nodes[n].nextInPoint) {
+        if (out && count < maxCount) out[count] = adj->nodes[n].polygon;
+        count++;
+    }
+    return count;
+}
+
+/* ----------------------------------------------------------------------------
+   Undo / redo playback
+   ---------------------------------------------------------------------------- */
+
+void CadCore_BeginUndoGroup(CadCore* core) {
+    if (!core) return;
+    if (core->journal.depth++ == 0) {
+        core->journal.openFirst = INVALID_INDEX;
+        core->journal.failed = 0;
+    }
+}
+
+/* Drop the oldest steps while the retained deltas exceed the cap (the
+   newest step is always kept), then slide the arrays down once the dead
+   prefix outgrows the live part */
+static void journal_enforce_limit(CadJournal* j) {
+    while (j->groupBase < j->groupCount - 1) {
+        size_t retained = (size_t)(j->deltaCount - j->groups[j->groupBase].firstDelta) * sizeof(CadDelta);
+        if (retained <= j->limitBytes) break;
+        j->groupBase++;
+        if (j->cursor < j->groupBase) j->cursor = j->groupBase;
+    }
+    if (j->groupBase == 0) return;
+    
+    int shift = j->groups[j->groupBase].firstDelta;
+    if (shift * 2 < j->deltaCount) return;
+    memmove(j->deltas, j->deltas + shift, (size_t)(j->deltaCount - shift) * sizeof(CadDelta));
+    j->deltaCount -= shift;
+    memmove(j->groups, j->groups + j->groupBase, (size_t)(j->groupCount - j->groupBase) * sizeof(CadUndoGroup));
+    j->groupCount -= j->groupBase;
+    j->cursor -= j->groupBase;
+    j->groupBase = 0;
+    for (int g = 0; g < j->groupCount; g++) j->groups[g].firstDelta -= shift;
+}
+
+void CadCore_EndUndoGroup(CadCore* core) {
+    if (!core || core->journal.depth == 0) return;
+    CadJournal* j = &core->journal;
+    if (--j->depth > 0) return;
+    
+    j->failed = 0;
+    if (j->openFirst == INVALID_INDEX) return; /* Nothing changed */
+    journal_clear_recorded(core, j->openFirst, j->deltaCount);
+    
+    if (j->groupCount >= j->groupCapacity) {
+        int capacity = j->groupCapacity > 0 ? j->groupCapacity * 2 : 64;
+        CadUndoGroup* grown = (CadUndoGroup*)realloc(j->groups, (size_t)capacity * sizeof(CadUndoGroup));
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory recording undo step; history cleared\n");
+            journal_reset(core);
+            return;
+        }
+        j->groups = grown;
+        j->groupCapacity = capacity;
+    }
+    j->groups[j->groupCount].firstDelta = j->openFirst;
+    j->groups[j->groupCount].deltaCount = j->deltaCount - j->openFirst;
+    j->groupCount++;
+    j->cursor = j->groupCount;
+    j->openFirst = INVALID_INDEX;
+    journal_enforce_limit(j);
+}
+
+static void swap_point_delta(CadCore* core, CadDelta* d) {
+    CadFileData* data = &core->data;
+    CadIndex i = d->index;
+    CadPoint current = data->points[i];
+    double x = data->pointX[i], y = data->pointY[i], z = data->pointZ[i];
+    int wasLive = current.flags != 0;
+    int isLive = d->u.point.record.flags != 0;
+    
+    /* Selection is not journaled: a record keeps its selection while it
+       stays live and is dropped from the selection when it dies */
+    int selected = CadCore_IsPointSelected(core, i);
+    if (selected && !isLive) CadCore_DeselectPoint(core, i);
+    
+    data->points[i] = d->u.point.record;
+    data->points[i].selectFlag = (uint8_t)(selected && isLive);
+    data->pointX[i] = d->u.point.x;
+    data->pointY[i] = d->u.point.y;
+    data->pointZ[i] = d->u.point.z;
+    d->u.point.record = current;
+    d->u.point.x = x;
+    d->u.point.y = y;
+    d->u.point.z = z;
+    
+    if (wasLive != isLive) {
+        if (isLive) {
+            set_bit(core->live.points, i);
+            core->live.pointCount++;
+        } else {
+            clear_bit(core->live.points, i);
+            core->live.pointCount--;
+        }
+    }
+    mark_geometry(&core->changes.points, i);
+    if (wasLive != isLive || current.nextPoint != data->points[i].nextPoint) {
+        mark_topology(&core->changes.points, i);
+    }
+    point_changed(core, i);
+}
+
+static void swap_polygon_delta(CadCore* core, CadDelta* d) {
+    CadIndex i = d->index;
+    CadPolygon current = core->data.polygons[i];
+    int wasLive = current.flags != 0;
+    int isLive = d->u.polygon.flags != 0;
+    
+    int selected = CadCore_IsPolygonSelected(core, i);
+    if (selected && !isLive) CadCore_DeselectPolygon(core, i);
+    
+    core->data.polygons[i] = d->u.polygon;
+    core->data.polygons[i].selectFlag = (uint8_t)(selected && isLive);
+    d->u.polygon = current;
+    
+    if (wasLive != isLive) {
+        if (isLive) {
+            set_bit(core->live.polygons, i);
+            core->live.polygonCount++;
+        } else {
+            clear_bit(core->live.polygons, i);
+            core->live.polygonCount--;
+        }
+    }
+    mark_geometry(&core->changes.polygons, i);
+}
+
+static void swap_object_delta(CadCore* core, CadDelta* d) {
+    CadIndex i = d->index;
+    CadObject current = core->data.objects[i];
+    int wasLive = current.flags != 0;
+    int isLive = d->u.object.flags != 0;
+    
+    core->data.objects[i] = d->u.object;
+    core->data.objects[i].selectFlag = isLive ? current.selectFlag : 0;
+    d->u.object = current;
+    
+    if (wasLive != isLive) {
+        if (isLive) {
+            set_bit(core->live.objects, i);
+            core->live.objectCount++;
+        } else {
+            clear_bit(core->live.objects, i);
+            core->live.objectCount--;
+        }
+    }
+    mark_geometry(&core->changes.objects, i);
+    mark_topology(&core->changes.objects, i);
+}
+
+/* Take a specific slot off a free stack. Replay mirrors the recorded
+   pushes and pops, so it is on top; the scan is only a fallback. */
+static void remove_free_slot(CadIndex* freeSlots, int* freeCount, CadIndex slot) {
+    for (int k = *freeCount - 1; k >= 0; k--) {
+        if (freeSlots[k] == slot) {
+            freeSlots[k] = freeSlots[--(*freeCount)];
+            return;
+        }
+    }
+}
+
+/* Redo (forward) repeats a slot operation, undo reverts it */
+static void replay_slot_delta(CadCore* core, const CadDelta* d, int forward) {
+    CadIndex* freeSlots;
+    int* freeCount;
+    int* highWater;
+    switch (d->pool) {
+    case CAD_POOL_POINTS:
+        freeSlots = core->freeList.freePoints;
+        freeCount = &core->freeList.pointCount;
+        highWater = &core->data.pointCount;
+        break;
+    case CAD_POOL_POLYGONS:
+        freeSlots = core->freeList.freePolygons;
+        freeCount = &core->freeList.polygonCount;
+        highWater = &core->data.polygonCount;
+        break;
+    default:
+        freeSlots = core->freeList.freeObjects;
+        freeCount = &core->freeList.objectCount;
+        highWater = &core->data.objectCount;
+        break;
+    }
+    
+    int take = (d->kind == CAD_DELTA_ALLOC) == forward;
+    if (d->kind == CAD_DELTA_ALLOC && !d->fromFreeList) {
+        *highWater = take ? d->index + 1 : d->index;
+    } else if (take) {
+        remove_free_slot(freeSlots, freeCount, d->index);
+    } else {
+        freeSlots[(*freeCount)++] = d->index;
+    }
+}
+
+typedef struct {
+    CadIndex* polygons;
+    int count;
+    int capacity;
+    int overflow;                /* Allocation failed: rebuild adjacency instead */
+} RefreshList;
+
+/* Queue a polygon once; the recorded bits are idle between groups */
+static void queue_refresh(CadCore* core, RefreshList* list, CadIndex polygon) {
+    if (list->overflow || test_bit(core->journal.polygonRecorded, polygon)) return;
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity > 0 ? list->capacity * 2 : 64;
+        CadIndex* grown = (CadIndex*)realloc(list->polygons, (size_t)capacity * sizeof(CadIndex));
+        if (!grown) {
+            list->overflow = 1;
+            return;
+        }
+        list->polygons = grown;
+        list->capacity = capacity;
+    }
+    set_bit(core->journal.polygonRecorded, polygon);
+    list->polygons[list->count++] = polygon;
+}
+
+static void journal_apply(CadCore* core, const CadUndoGroup* group, int forward) {
+    CadJournal* j = &core->journal;
+    CadDelta* deltas = &j->deltas[group->firstDelta];
+    int count = group->deltaCount;
+    
+    /* Polygons whose walk can change: current users of every relinked,
+       revived or killed point, plus every touched polygon */
+    RefreshList refresh = { NULL, 0, 0, 0 };
+    for (int k = 0; k < count; k++) {
+        const CadDelta* d = &deltas[k];
+        if (d->kind == CAD_DELTA_POLYGON) {
+            queue_refresh(core, &refresh, d->index);
+        } else if (d->kind == CAD_DELTA_POINT) {
+            const CadPoint* current = &core->data.points[d->index];
+            if (current->nextPoint == d->u.point.record.nextPoint &&
+                (current->flags != 0) == (d->u.point.record.flags != 0)) continue;
+            for (CadIndex n = core->adjacency.pointFirstUse[d->index]; n != INVALID_INDEX;
+                 n = core->adjacency.nodes[n].nextInPoint) {
+                queue_refresh(core, &refresh, core->adjacency.nodes[n].polygon);
+            }
+        }
+    }
+    
+    j->replaying = 1;
+    for (int step = 0; step < count; step++) {
+        CadDelta* d = &deltas[forward ? step : count - 1 - step];
+        switch (d->kind) {
+        case CAD_DELTA_POINT: swap_point_delta(core, d); break;
+        case CAD_DELTA_POLYGON: swap_polygon_delta(core, d); break;
+        case CAD_DELTA_OBJECT: swap_object_delta(core, d); break;
+        default: replay_slot_delta(core, d, forward); break;
+        }
+    }
+    
+    for (int k = 0; k < refresh.count; k++) {
+        clear_bit(j->polygonRecorded, refresh.polygons[k]);
+        if (!refresh.overflow) adjacency_refresh_polygon(core, refresh.polygons[k]);
+    }
+    if (refresh.overflow) CadCore_RebuildAdjacency(core);
+    j->replaying = 0;
+    free(refresh.polygons);
+    core->isDirty = 1;
+}
+
+int CadCore_Undo(CadCore* core) {
+    if (!CadCore_CanUndo(core)) return 0;
+    CadJournal* j = &core->journal;
+    j->cursor--;
+    journal_apply(core, &j->groups[j->cursor], 0);
+    return 1;
+}
+
+int CadCore_Redo(CadCore* core) {
+    if (!CadCore_CanRedo(core)) return 0;
+    CadJournal* j = &core->journal;
+    journal_apply(core, &j->groups[j->cursor], 1);
+    j->cursor++;
+    return 1;
+}
+
+int CadCore_CanUndo(const CadCore* core) {
+    return core && core->journal.depth == 0 && core->journal.cursor > core->journal.groupBase;
+}
+
+int CadCore_CanRedo(const CadCore* core) {
+    return core && core->journal.depth == 0 && core->journal.cursor < core->journal.groupCount;
+}
+
+void CadCore_SetUndoLimit(CadCore* core, size_t bytes) {
+    if (!core) return;
+    core->journal.limitBytes = bytes;
+    journal_enforce_limit(&core->journal);
+}
+
+void CadCore_ClearUndo(CadCore* core) {
+    if (!core) return;
+    journal_reset(core);
+}
+
+/* ----------------------------------------------------------------------------
+   Flattened polygon index
+   Every topology edit goes through adjacency_unlink_polygon or
+   CadCore_RebuildAdjacency, which bump the polygon topology generation.
+   ---------------------------------------------------------------------------- */
+
+static int reserve_polygon_index(CadPolygonIndex* index, int offsets, int vertices) {
+    if (offsets > index->offsetCapacity) {
+        int capacity = index->offsetCapacity > 0 ? index->offsetCapacity : CAD_POOL_MIN_CAPACITY;
+        while (capacity < offsets) capacity *= 2;
+        CadIndex* grown = (CadIndex*)realloc(index->offsets, (size_t)capacity * sizeof(CadIndex));
+        if (!grown) return 0;
+        index->offsets = grown;
+        index->offsetCapacity = capacity;
+    }
+    if (vertices > index->vertexCapacity) {
+        int capacity = index->vertexCapacity > 0 ? index->vertexCapacity : CAD_POOL_MIN_CAPACITY * 4;
+        while (capacity < vertices) capacity *= 2;
+        CadIndex* grown = (CadIndex*)realloc(index->vertices, (size_t)capacity * sizeof(CadIndex));
+        if (!grown) return 0;
+        index->vertices = grown;
+        index->vertexCapacity = capacity;
+    }
+    return 1;
+}
+
+/* The adjacency already holds one node per walked vertex, so its node count
+   sizes the vertex array and bounds each chain walk (no repeat scan needed) */
+static int build_polygon_index(CadCore* core) {
+    CadPolygonIndex* index = &core->polygonIndex;
+    const CadAdjacency* adj = &core->adjacency;
+    int polygonCount = core->data.polygonCount;
+    
+    if (!reserve_polygon_index(index, polygonCount + 1, adj->nodeCount)) return 0;
+    
+    int vertexCount = 0;
+    for (CadIndex i = 0; i < polygonCount; i++) {
+        index->offsets[i] = vertexCount;
+        if (core->data.polygons[i].flags == 0) continue;
+        
+        int count = 0;
+        for (CadIndex n = adj->polygonFirstUse[i]; n != INVALID_INDEX; n = adj->nodes[n].nextInPolygon) {
+            count++;
+        }
+        CadIndex current = core->data.polygons[i].firstPoint;
+        for (int j = 0; j < count; j++) {
+            index->vertices[vertexCount++] = current;
+            current = core->data.points[current].nextPoint;
+        }
+    }
+    index->offsets[polygonCount] = vertexCount;
+    index->polygonCount = polygonCount;
+    index->vertexCount = vertexCount;
+    index->generation = core->changes.polygons.topology;
+    return 1;
+}
+
+const CadPolygonIndex* CadCore_GetPolygonIndex(const CadCore* core) {
+    if (!core) return NULL;
+    if (core->polygonIndex.generation != core->changes.polygons.topology &&
+        !build_polygon_index((CadCore*)core)) {
+        fprintf(stderr, "Error: Out of memory building polygon index\n");
+        return NULL;
+    }
+    return &core->polygonIndex;
+}
+
+/* ----------------------------------------------------------------------------
+   File operations
+   ---------------------------------------------------------------------------- */
+
+int CadCore_LoadFile(CadCore* core, const char* filename) {
+    if (!core || !filename) return 0;
+    
+    CadCore_Clear(core);
+    
+    if (!CadFile_Load(filename, &core->data)) {
+        mark_all_changed(core);
+        CadCore_RebuildFreeLists(core);
+        CadCore_RebuildAdjacency(core);
+        CadCore_RebuildSelection(core);
+        return 0;
+    }
+    
+    mark_all_changed(core);
+    CadCore_RebuildFreeLists(core);
+    CadCore_RebuildAdjacency(core);
+    CadCore_RebuildSelection(core);
+    core->isDirty = 0;
+    return 1;
+}
+
+int CadCore_SaveFile(CadCore* core, const char* filename) {
+    if (!core || !filename) return 0;
+    
+    if (!CadFile_Save(filename, &core->data)) {
+        return 0;
+    }
+    
+    core->isDirty = 0;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Point operations
+   ---------------------------------------------------------------------------- */
+
+/* Bring slot i (popped from the free list or just past the old high-water
+   mark) to life as an unlinked point. Caller holds an undo group. */
+static void init_point_slot(CadCore* core, CadIndex i, int fromFreeList, double x, double y, double z) {
+    journal_slot(core, CAD_DELTA_ALLOC, CAD_POOL_POINTS, i, fromFreeList);
+    journal_point(core, i);
+    
+    CadPoint* pt = &core->data.points[i];
+    pt->flags = 1;
+    pt->selectFlag = 0;
+    pt->nextPoint = INVALID_INDEX;
+    core->data.pointX[i] = x;
+    core->data.pointY[i] = y;
+    core->data.pointZ[i] = z;
+    point_changed(core, i);
+    set_bit(core->live.points, i);
+    core->live.pointCount++;
+    mark_topology(&core->changes.points, i);
+    mark_geometry(&core->changes.points, i);
+}
+
+CadIndex CadCore_AddPoint(CadCore* core, double x, double y, double z) {
+    if (!core) return INVALID_INDEX;
+    
+    CadIndex i = pop_free_slot(core->freeList.freePoints, &core->freeList.pointCount);
+    int fromFreeList = i != INVALID_INDEX;
+    if (i == INVALID_INDEX) {
+        /* No holes - extend the high-water mark, growing the pool if needed */
+        if (!CadCore_Reserve(core, 0, 0, core->data.pointCount + 1)) return INVALID_INDEX;
+        i = (CadIndex)core->data.pointCount++;
+    }
+    
+    CadCore_BeginUndoGroup(core);
+    init_point_slot(core, i, fromFreeList, x, y, z);
+    CadCore_EndUndoGroup(core);
+    
+    core->newPoint = i;
+    core->isDirty = 1;
+    return i;
+}
+
+int CadCore_DeletePoint(CadCore* core, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
+    
+    /* Remove from selection if selected */
+    CadCore_DeselectPoint(core, pointIndex);
+    
+    CadCore_BeginUndoGroup(core);
+    journal_point(core, pointIndex);
+    
+    /* Mark as deleted (set flags to 0) */
+    core->data.points[pointIndex].flags = 0;
+    core->data.points[pointIndex].selectFlag = 0;
+    core->data.pointX[pointIndex] = 0.0;
+    core->data.pointY[pointIndex] = 0.0;
+    core->data.pointZ[pointIndex] = 0.0;
+    point_changed(core, pointIndex);
+    
+    /* Chains through this point now end before it. Cut the links into the
+       dead slot as well, so reusing the slot cannot silently re-attach it. */
+    detach_point_from_chains(core, pointIndex);
+    adjacency_refresh_point_users(core, pointIndex);
+    
+    /* Return slot to the free list */
+    core->freeList.freePoints[core->freeList.pointCount++] = pointIndex;
+    journal_slot(core, CAD_DELTA_FREE, CAD_POOL_POINTS, pointIndex, 0);
+    clear_bit(core->live.points, pointIndex);
+    core->live.pointCount--;
+    mark_topology(&core->changes.points, pointIndex);
+    mark_geometry(&core->changes.points, pointIndex);
+    CadCore_EndUndoGroup(core);
+    
+    core->isDirty = 1;
+    return 1;
+}
+
+CadPoint* CadCore_GetPoint(CadCore* core, CadIndex index) {
+    if (!core || !CadCore_IsPointValid(core, index)) return NULL;
+    return &core->data.points[index];
+}
+
+int CadCore_IsPointValid(CadCore* core, CadIndex index) {
+    if (!core || index < 0 || index >= core->data.pointCount) return 0;
+    return core->data.points[index].flags != 0;
+}
+
+int CadCore_GetPointPosition(const CadCore* core, CadIndex index, double* x, double* y, double* z) {
+    if (!core || !CadCore_IsPointValid((CadCore*)core, index)) return 0;
+    return CadFile_GetPointPosition(&core->data, index, x, y, z);
+}
+
+int CadCore_SetPointPosition(CadCore* core, CadIndex index, double x, double y, double z) {
+    if (!core || !CadCore_IsPointValid(core, index)) return 0;
+    CadCore_BeginUndoGroup(core);
+    journal_point(core, index);
+    CadFile_SetPointPosition(&core->data, index, x, y, z);
+    CadCore_EndUndoGroup(core);
+    point_changed(core, index);
+    mark_geometry(&core->changes.points, index);
+    core->isDirty = 1;
+    return 1;
+}
+
+int CadCore_MovePoint(CadCore* core, CadIndex index, double dx, double dy, double dz) {
+    if (!core || !CadCore_IsPointValid(core, index)) return 0;
+    CadCore_BeginUndoGroup(core);
+    journal_point(core, index);
+    core->data.pointX[index] += dx;
+    core->data.pointY[index] += dy;
+    core->data.pointZ[index] += dz;
+    CadCore_EndUndoGroup(core);
+    point_changed(core, index);
+    mark_geometry(&core->changes.points, index);
+    core->isDirty = 1;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Polygon operations
+   ---------------------------------------------------------------------------- */
+
+/* Bring slot i to life as an ungrouped face walking npoints from
+   firstPoint. Caller holds an undo group. */
+static void init_polygon_slot(CadCore* core, CadIndex i, int fromFreeList, CadIndex firstPoint, uint8_t color,
+                              uint8_t npoints) {
+    journal_slot(core, CAD_DELTA_ALLOC, CAD_POOL_POLYGONS, i, fromFreeList);
+    journal_polygon(core, i);
+    
+    CadPolygon* poly = &core->data.polygons[i];
+    poly->flags = 1;
+    poly->selectFlag = 0;
+    poly->nextPolygon = INVALID_INDEX;
+    poly->firstPoint = firstPoint;
+    poly->animation = 0;
+    poly->both = INVALID_INDEX;
+    poly->side = 0;
+    poly->color = color;
+    poly->npoints = npoints;
+    set_bit(core->live.polygons, i);
+    core->live.polygonCount++;
+    mark_geometry(&core->changes.polygons, i);
+    adjacency_refresh_polygon(core, i);
+}
+
+CadIndex CadCore_AddPolygon(CadCore* core, CadIndex firstPoint, uint8_t color, uint8_t npoints) {
+    if (!core || !CadCore_IsPointValid(core, firstPoint) || npoints < 2) {
+        return INVALID_INDEX;
+    }
+    
+    CadIndex i = pop_free_slot(core->freeList.freePolygons, &core->freeList.polygonCount);
+    int fromFreeList = i != INVALID_INDEX;
+    if (i == INVALID_INDEX) {
+        if (!CadCore_Reserve(core, 0, core->data.polygonCount + 1, 0)) return INVALID_INDEX;
+        i = (CadIndex)core->data.polygonCount++;
+    }
+    
+    CadCore_BeginUndoGroup(core);
+    init_polygon_slot(core, i, fromFreeList, firstPoint, color, npoints);
+    CadCore_EndUndoGroup(core);
+    
+    core->newPolygon = i;
+    core->isDirty = 1;
+    return i;
+}
+
+int CadCore_DeletePolygon(CadCore* core, CadIndex polygonIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
+    
+    /* Remove from selection if selected */
+    CadCore_DeselectPolygon(core, polygonIndex);
+    
+    CadCore_BeginUndoGroup(core);
+    journal_polygon(core, polygonIndex);
+    
+    /* Mark as deleted */
+    core->data.polygons[polygonIndex].flags = 0;
+    core->data.polygons[polygonIndex].selectFlag = 0;
+    adjacency_unlink_polygon(core, polygonIndex);
+    
+    /* Return slot to the free list */
+    core->freeList.freePolygons[core->freeList.polygonCount++] = polygonIndex;
+    journal_slot(core, CAD_DELTA_FREE, CAD_POOL_POLYGONS, polygonIndex, 0);
+    clear_bit(core->live.polygons, polygonIndex);
+    core->live.polygonCount--;
+    mark_geometry(&core->changes.polygons, polygonIndex);
+    CadCore_EndUndoGroup(core);
+    
+    core->isDirty = 1;
+    return 1;
+}
+
+CadPolygon* CadCore_GetPolygon(CadCore* core, CadIndex index) {
+    if (!core || !CadCore_IsPolygonValid(core, index)) return NULL;
+    return &core->data.polygons[index];
+}
+
+int CadCore_IsPolygonValid(CadCore* core, CadIndex index) {
+    if (!core || index < 0 || index >= core->data.polygonCount) return 0;
+    return core->data.polygons[index].flags != 0;
+}
+
+int CadCore_AddPointToPolygon(CadCore* core, CadIndex polygonIndex, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex) || !CadCore_IsPointValid(core, pointIndex)) {
+        return 0;
+    }
+    
+    CadPolygon* poly = &core->data.polygons[polygonIndex];
+    CadCore_BeginUndoGroup(core);
+    journal_polygon(core, polygonIndex);
+    
+    /* Find the last point in the polygon's chain */
+    CadIndex current = poly->firstPoint;
+    if (current == INVALID_INDEX) {
+        /* First point */
+        poly->firstPoint = pointIndex;
+        poly->npoints = 1;
+    } else {
+        /* Traverse to the polygon's last vertex (bounded, so a cyclic
+           or shared chain cannot loop forever) */
+        for (int step = 1; step < poly->npoints; step++) {
+            CadIndex next = core->data.points[current].nextPoint;
+            if (!CadCore_IsPointValid(core, next)) break;
+            current = next;
+        }
+        /* Link new point (other polygons sharing this tail see it too) */
+        journal_point(core, current);
+        core->data.points[current].nextPoint = pointIndex;
+        mark_topology(&core->changes.points, current);
+        poly->npoints++;
+        adjacency_refresh_point_users(core, current);
+    }
+    adjacency_refresh_polygon(core, polygonIndex);
+    CadCore_EndUndoGroup(core);
+    
+    core->isDirty = 1;
+    return 1;
+}
+
+int CadCore_SetNextPoint(CadCore* core, CadIndex pointIndex, CadIndex nextPoint) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
+    if (nextPoint != INVALID_INDEX && !CadCore_IsPointValid(core, nextPoint)) return 0;
+    
+    CadPoint* pt = &core->data.points[pointIndex];
+    if (pt->nextPoint == nextPoint) return 1;
+    CadCore_BeginUndoGroup(core);
+    journal_point(core, pointIndex);
+    pt->nextPoint = nextPoint;
+    mark_topology(&core->changes.points, pointIndex);
+    adjacency_refresh_point_users(core, pointIndex);
+    CadCore_EndUndoGroup(core);
+    
+    core->isDirty = 1;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Object operations
+   ---------------------------------------------------------------------------- */
+
+/* Last object of the sibling chain starting at first (-1 if empty) */
+static CadIndex last_brother(const CadCore* core, CadIndex first) {
+    const CadFileData* data = &core->data;
+    CadIndex last = INVALID_INDEX;
+    for (int steps = 0; first >= 0 && first < data->objectCount && steps < data->objectCount; steps++) {
+        last = first;
+        first = data->objects[first].nextBrother;
+    }
+    return last;
+}
+
+CadIndex CadCore_AddObject(CadCore* core, CadIndex parentObject, double ox, double oy, double oz) {
+    if (!core) return INVALID_INDEX;
+    if (!CadCore_IsObjectValid(core, parentObject)) parentObject = INVALID_INDEX;
+    
+    CadIndex i = pop_free_slot(core->freeList.freeObjects, &core->freeList.objectCount);
+    int fromFreeList = i != INVALID_INDEX;
+    if (i == INVALID_INDEX) {
+        if (!CadCore_Reserve(core, core->data.objectCount + 1, 0, 0)) return INVALID_INDEX;
+        i = (CadIndex)core->data.objectCount++;
+    }
+    
+    CadCore_BeginUndoGroup(core);
+    journal_slot(core, CAD_DELTA_ALLOC, CAD_POOL_OBJECTS, i, fromFreeList);
+    journal_object(core, i);
+    
+    CadObject* obj = &core->data.objects[i];
+    obj->flags = 1;
+    obj->selectFlag = 0;
+    obj->parentObject = parentObject;
+    obj->nextBrother = INVALID_INDEX;
+    obj->childObject = INVALID_INDEX;
+    obj->firstPolygon = INVALID_INDEX;
+    obj->offsetx = ox;
+    obj->offsety = oy;
+    obj->offsetz = oz;
+    set_bit(core->live.objects, i);
+    core->live.objectCount++;
+    mark_topology(&core->changes.objects, i);
+    mark_geometry(&core->changes.objects, i);
+    
+    /* Append to the parent's children, or to the roots after the first */
+    CadIndex first = INVALID_INDEX;
+    if (parentObject != INVALID_INDEX) {
+        first = core->data.objects[parentObject].childObject;
+        if (first == INVALID_INDEX) {
+            journal_object(core, parentObject);
+            core->data.objects[parentObject].childObject = i;
+            mark_topology(&core->changes.objects, parentObject);
+        }
+    } else {
+        for (CadIndex o = 0; o < core->data.objectCount; o++) {
+            if (o != i && core->data.objects[o].flags &&
+                !CadCore_IsObjectValid(core, core->data.objects[o].parentObject)) {
+                first = o;
+                break;
+            }
+        }
+    }
+    CadIndex last = last_brother(core, first);
+    if (last != INVALID_INDEX && last != i) {
+        journal_object(core, last);
+        core->data.objects[last].nextBrother = i;
+        mark_topology(&core->changes.objects, last);
+    }
+    CadCore_EndUndoGroup(core);
+    
+    core->isDirty = 1;
+    return i;
+}
+
+int CadCore_DeleteObject(CadCore* core, CadIndex objectIndex) {
+    if (!core || !CadCore_IsObjectValid(core, objectIndex)) return 0;
+    
+    CadCore_BeginUndoGroup(core);
+    journal_object(core, objectIndex);
+    
+    /* Unlink from whichever list holds it */
+    CadIndex next = core->data.objects[objectIndex].nextBrother;
+    for (CadIndex o = 0; o < core->data.objectCount; o++) {
+        CadObject* obj = &core->data.objects[o];
+        if (o == objectIndex || !obj->flags) continue;
+        if (obj->childObject == objectIndex || obj->nextBrother == objectIndex) {
+            journal_object(core, o);
+            if (obj->childObject == objectIndex) obj->childObject = next;
+            if (obj->nextBrother == objectIndex) obj->nextBrother = next;
+            mark_topology(&core->changes.objects, o);
+        }
+    }
+    
+    /* Children become roots, their chain appended to the root siblings */
+    CadIndex firstRoot = INVALID_INDEX;
+    for (CadIndex o = 0; o < core->data.objectCount; o++) {
+        if (o != objectIndex && core->data.objects[o].flags &&
+            !CadCore_IsObjectValid(core, core->data.objects[o].parentObject)) {
+            firstRoot = o;
+            break;
+        }
+    }
+    CadIndex children = core->data.objects[objectIndex].childObject;
+    for (CadIndex o = 0; o < core->data.objectCount; o++) {
+        CadObject* obj = &core->data.objects[o];
+        if (o == objectIndex || !obj->flags || obj->parentObject != objectIndex) continue;
+        journal_object(core, o);
+        obj->parentObject = INVALID_INDEX;
+        mark_topology(&core->changes.objects, o);
+    }
+    CadIndex lastRoot = last_brother(core, firstRoot);
+    if (lastRoot != INVALID_INDEX && CadCore_IsObjectValid(core, children)) {
+        journal_object(core, lastRoot);
+        core->data.objects[lastRoot].nextBrother = children;
+        mark_topology(&core->changes.objects, lastRoot);
+    }
+    
+    /* Mark as deleted */
+    core->data.objects[objectIndex].childObject = INVALID_INDEX;
+    core->data.objects[objectIndex].nextBrother = INVALID_INDEX;
+    core->data.objects[objectIndex].flags = 0;
+    core->data.objects[objectIndex].selectFlag = 0;
+    
+    /* Return slot to the free list */
+    core->freeList.freeObjects[core->freeList.objectCount++] = objectIndex;
+    journal_slot(core, CAD_DELTA_FREE, CAD_POOL_OBJECTS, objectIndex, 0);
+    clear_bit(core->live.objects, objectIndex);
+    core->live.objectCount--;
+    mark_topology(&core->changes.objects, objectIndex);
+    mark_geometry(&core->changes.objects, objectIndex);
+    CadCore_EndUndoGroup(core);
+    
+    core->isDirty = 1;
+    return 1;
+}
+
+CadObject* CadCore_GetObject(CadCore* core, CadIndex index) {
+    if (!core || !CadCore_IsObjectValid(core, index)) return NULL;
+    return &core->data.objects[index];
+}
+
+int CadCore_IsObjectValid(CadCore* core, CadIndex index) {
+    if (!core || index < 0 || index >= core->data.objectCount) return 0;
+    return core->data.objects[index].flags != 0;
+}
+
+/* ----------------------------------------------------------------------------
+   Object hierarchy
+   ---------------------------------------------------------------------------- */
+
+/* Accumulate the world offsets of order[from .. to); parents come first */
+static void hierarchy_offsets(CadHierarchy* h, const CadFileData* data, int from, int to) {
+    static const double zero[3] = { 0.0, 0.0, 0.0 };
+    for (int k = from; k < to; k++) {
+        CadIndex o = h->order[k];
+        const CadObject* obj = &data->objects[o];
+        const double* base = h->parent[o] >= 0 ? &h->world[3 * h->parent[o]] : zero;
+        h->world[3 * o]     = base[0] + obj->offsetx;
+        h->world[3 * o + 1] = base[1] + obj->offsety;
+        h->world[3 * o + 2] = base[2] + obj->offsetz;
+    }
+}
+
+/* Whether every world offset of order[from .. to) is zero */
+static int hierarchy_zero(const CadHierarchy* h, int from, int to) {
+    for (int k = from; k < to; k++) {
+        const double* w = &h->world[3 * h->order[k]];
+        if (w[0] != 0.0 || w[1] != 0.0 || w[2] != 0.0) return 0;
+    }
+    return 1;
+}
+
+/* World positions of the points owned by order[from .. to) */
+static void hierarchy_world_points(CadHierarchy* h, const CadFileData* data, int from, int to) {
+    for (int k = from; k < to; k++) {
+        const double* w = &h->world[3 * h->order[k]];
+        for (int j = h->pointStart[k]; j < h->pointStart[k + 1]; j++) {
+            CadIndex i = h->points[j];
+            h->worldX[i] = data->pointX[i] + w[0];
+            h->worldY[i] = data->pointY[i] + w[1];
+            h->worldZ[i] = data->pointZ[i] + w[2];
+        }
+    }
+}
+
+/* Depth-first order of the objects and the points each one owns */
+static int hierarchy_build(CadCore* core) {
+    CadHierarchy* h = &core->hierarchy;
+    const CadFileData* data = &core->data;
+    int objectCount = data->objectCount;
+    int polygonCount = data->polygonCount;
+    int pointCount = data->pointCount;
+    
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    if (!index) return 0;
+    
+    if (objectCount > h->objectCapacity) {
+        if (!grow_index_array(&h->order, objectCount) ||
+            !grow_index_array(&h->position, objectCount) ||
+            !grow_index_array(&h->subtreeEnd, objectCount) ||
+            !grow_index_array(&h->parent, objectCount) ||
+            !grow_double_array(&h->world, 3 * objectCount)) return 0;
+        int* starts = (int*)realloc(h->pointStart, (size_t)(objectCount + 1) * sizeof(int));
+        if (!starts) return 0;
+        h->pointStart = starts;
+        h->objectCapacity = objectCount;
+    }
+    if (polygonCount > h->polygonCapacity) {
+        if (!grow_index_array(&h->polygonObject, polygonCount)) return 0;
+        h->polygonCapacity = polygonCount;
+    }
+    if (pointCount > h->pointCapacity) {
+        if (!grow_index_array(&h->pointObject, pointCount) ||
+            !grow_index_array(&h->points, pointCount)) return 0;
+        h->pointCapacity = pointCount;
+    }
+    if (!h->pointStart) {
+        h->pointStart = (int*)malloc(sizeof(int));
+        if (!h->pointStart) return 0;
+    }
+    
+    /* Children of each live parent in index order, as CSR */
+    int* childStart = (int*)calloc((size_t)objectCount + 1, sizeof(int));
+    CadIndex* children = (CadIndex*)malloc((size_t)(objectCount > 0 ? objectCount : 1) * sizeof(CadIndex));
+    CadIndex* stack = (CadIndex*)malloc((size_t)(objectCount > 0 ? objectCount : 1) * sizeof(CadIndex));
+    if (!childStart || !children || !stack) {
+        free(childStart);
+        free(children);
+        free(stack);
+        return 0;
+    }
+    for (CadIndex o = 0; o < objectCount; o++) {
+        h->position[o] = INVALID_INDEX;
+        h->parent[o] = INVALID_INDEX;
+        CadIndex p = data->objects[o].parentObject;
+        if (data->objects[o].flags && p != o && CadCore_IsObjectValid(core, p)) {
+            h->parent[o] = p;
+            childStart[p + 1]++;
+        }
+    }
+    for (CadIndex o = 0; o < objectCount; o++) childStart[o + 1] += childStart[o];
+    for (CadIndex o = 0; o < objectCount; o++) {
+        if (h->parent[o] >= 0) children[childStart[h->parent[o]]++] = o;
+    }
+    for (CadIndex o = objectCount; o > 0; o--) childStart[o] = childStart[o - 1];
+    childStart[0] = 0;
+    
+    /* Pre-order walk from the roots, then from cycle members never reached */
+    int count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (CadIndex r = 0; r < objectCount; r++) {
+            if (!data->objects[r].flags || h->position[r] != INVALID_INDEX) continue;
+            if (pass == 0 && h->parent[r] != INVALID_INDEX) continue;
+            CadIndex root = r;
+            if (pass == 1) {
+                /* Unreached objects hang off a cycle; start at its lowest member */
+                CadIndex c = r;
+                for (int steps = 0; steps < objectCount; steps++) c = h->parent[c];
+                root = c;
+                for (CadIndex x = h->parent[c]; x != c; x = h->parent[x]) {
+                    if (x < root) root = x;
+                }
+            }
+            h->parent[root] = INVALID_INDEX;
+            int top = 0;
+            stack[top++] = root;
+            h->position[root] = count;
+            while (top > 0) {
+                CadIndex o = stack[--top];
+                h->position[o] = count;
+                h->order[count++] = o;
+                for (int c = childStart[o + 1] - 1; c >= childStart[o]; c--) {
+                    CadIndex child = children[c];
+                    if (h->position[child] != INVALID_INDEX) continue;
+                    h->position[child] = count;   /* Claimed; set for real when popped */
+                    stack[top++] = child;
+                }
+            }
+        }
+    }
+    h->count = count;
+    
+    /* Descendants come after their parent, so a reverse pass carries ends up */
+    for (int k = 0; k < count; k++) h->subtreeEnd[h->order[k]] = k + 1;
+    for (int k = count - 1; k >= 0; k--) {
+        CadIndex o = h->order[k];
+        CadIndex p = h->parent[o];
+        if (p >= 0 && h->subtreeEnd[p] < h->subtreeEnd[o]) h->subtreeEnd[p] = h->subtreeEnd[o];
+    }
+    free(childStart);
+    free(children);
+    free(stack);
+    
+    /* Faces by group walk, points by first owner in order */
+    for (CadIndex g = 0; g < polygonCount; g++) h->polygonObject[g] = INVALID_INDEX;
+    for (CadIndex i = 0; i < pointCount; i++) h->pointObject[i] = INVALID_INDEX;
+    int owned = 0;
+    for (int k = 0; k < count; k++) {
+        CadIndex o = h->order[k];
+        h->pointStart[k] = owned;
+        CadIndex g = data->objects[o].firstPolygon;
+        while (g >= 0 && g < polygonCount && data->polygons[g].flags &&
+               h->polygonObject[g] == INVALID_INDEX) {
+            h->polygonObject[g] = o;
+            for (CadIndex v = index->offsets[g]; v < index->offsets[g + 1]; v++) {
+                CadIndex p = index->vertices[v];
+                if (h->pointObject[p] != INVALID_INDEX) continue;
+                h->pointObject[p] = o;
+                h->points[owned++] = p;
+            }
+            g = data->polygons[g].nextPolygon;
+        }
+    }
+    h->pointStart[count] = owned;
+    
+    h->objectTopology = core->changes.objects.topology;
+    h->polygonTopology = core->changes.polygons.topology;
+    h->pointTopology = core->changes.points.topology;
+    h->objectGeometry = 0;
+    h->pointGeometry = 0;
+    return 1;
+}
+
+static int hierarchy_refresh(CadCore* core) {
+    CadHierarchy* h = &core->hierarchy;
+    const CadChangeTracker* changes = &core->changes;
+    
+    if ((h->objectTopology != changes->objects.topology ||
+         h->polygonTopology != changes->polygons.topology ||
+         h->pointTopology != changes->points.topology) && !hierarchy_build(core)) {
+        return 0;
+    }
+    if (h->objectGeometry != changes->objects.geometry) {
+        hierarchy_offsets(h, &core->data, 0, h->count);
+        h->identity = hierarchy_zero(h, 0, h->count);
+        h->objectGeometry = changes->objects.geometry;
+        h->pointGeometry = 0;
+    }
+    if (!h->identity && h->pointGeometry != changes->points.geometry) {
+        int pointCount = core->data.pointCount;
+        int capacity = pointCount > 0 ? pointCount : 1;
+        if (!grow_double_array(&h->worldX, capacity) ||
+            !grow_double_array(&h->worldY, capacity) ||
+            !grow_double_array(&h->worldZ, capacity)) return 0;
+        
+        /* Unowned points stay where they are */
+        memcpy(h->worldX, core->data.pointX, (size_t)pointCount * sizeof(double));
+        memcpy(h->worldY, core->data.pointY, (size_t)pointCount * sizeof(double));
+        memcpy(h->worldZ, core->data.pointZ, (size_t)pointCount * sizeof(double));
+        hierarchy_world_points(h, &core->data, 0, h->count);
+        h->pointGeometry = changes->points.geometry;
+    }
+    return 1;
+}
+
+const CadHierarchy* CadCore_GetHierarchy(const CadCore* core) {
+    if (!core) return NULL;
+    if (!hierarchy_refresh((CadCore*)core)) {
+        fprintf(stderr, "Error: Out of memory building object hierarchy\n");
+        return NULL;
+    }
+    return &core->hierarchy;
+}
+
+int CadCore_GetObjectWorldOffset(const CadCore* core, CadIndex objectIndex, double out[3]) {
+    out[0] = out[1] = out[2] = 0.0;
+    if (!core || !CadCore_IsObjectValid((CadCore*)core, objectIndex)) return 0;
+    const CadHierarchy* h = CadCore_GetHierarchy(core);
+    if (!h) return 0;
+    out[0] = h->world[3 * objectIndex];
+    out[1] = h->world[3 * objectIndex + 1];
+    out[2] = h->world[3 * objectIndex + 2];
+    return 1;
+}
+
+int CadCore_GetWorldPoints(const CadCore* core, const double** x, const double** y, const double** z) {
+    if (!core) return 0;
+    const CadHierarchy* h = CadCore_GetHierarchy(core);
+    if (!h) return 0;
+    *x = h->identity ? core->data.pointX : h->worldX;
+    *y = h->identity ? core->data.pointY : h->worldY;
+    *z = h->identity ? core->data.pointZ : h->worldZ;
+    return 1;
+}
+
+int CadCore_SetObjectOffset(CadCore* core, CadIndex objectIndex, double ox, double oy, double oz) {
+    if (!core || !CadCore_IsObjectValid(core, objectIndex)) return 0;
+    
+    CadHierarchy* h = &core->hierarchy;
+    const CadChangeTracker* changes = &core->changes;
+    int orderCurrent = h->objectTopology == changes->objects.topology &&
+                       h->polygonTopology == changes->polygons.topology &&
+                       h->pointTopology == changes->points.topology &&
+                       h->objectGeometry == changes->objects.geometry;
+    int pointsCurrent = orderCurrent && h->pointGeometry == changes->points.geometry;
+    
+    CadCore_BeginUndoGroup(core);
+    journal_object(core, objectIndex);
+    CadObject* obj = &core->data.objects[objectIndex];
+    obj->offsetx = ox;
+    obj->offsety = oy;
+    obj->offsetz = oz;
+    mark_geometry(&core->changes.objects, objectIndex);
+    CadCore_EndUndoGroup(core);
+    
+    /* Refresh only the subtree while the rest of the cache is current */
+    if (orderCurrent) {
+        int from = h->position[objectIndex];
+        int to = h->subtreeEnd[objectIndex];
+        hierarchy_offsets(h, &core->data, from, to);
+        if (!h->identity) {
+            if (pointsCurrent) hierarchy_world_points(h, &core->data, from, to);
+        } else if (!hierarchy_zero(h, from, to)) {
+            h->identity = 0;
+            h->pointGeometry = 0;
+        }
+        h->objectGeometry = changes->objects.geometry;
+        if (pointsCurrent && !h->identity) h->pointGeometry = changes->points.geometry;
+    }
+    
+    core->isDirty = 1;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------
+   Selection operations
+   ---------------------------------------------------------------------------- */
+
+void CadCore_ClearSelection(CadCore* core) {
+    if (!core) return;
+    CadSelection* sel = &core->selection;
+    
+    /* Only the selected entries are touched. Records may already be gone
+       (CadCore_Clear releases the pools first), so flags are cleared only
+       for slots that still exist. */
+    for (int i = 0; i < sel->pointCount; i++) {
+        CadIndex p = sel->selectedPoints[i];
+        sel->pointSlot[p] = INVALID_INDEX;
+        if (p < core->data.pointCount) {
+            core->data.points[p].selectFlag = 0;
+            mark_page(&core->changes.points, p);
+        }
+    }
+    for (int i = 0; i < sel->polygonCount; i++) {
+        CadIndex p = sel->selectedPolygons[i];
+        sel->polygonSlot[p] = INVALID_INDEX;
+        if (p < core->data.polygonCount) {
+            core->data.polygons[p].selectFlag = 0;
+            mark_page(&core->changes.polygons, p);
+        }
+    }
+    
+    sel->pointCount = 0;
+    sel->polygonCount = 0;
+}
+
+void CadCore_SelectPoint(CadCore* core, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return;
+    CadSelection* sel = &core->selection;
+    if (sel->pointSlot[pointIndex] != INVALID_INDEX) return; /* Already selected */
+    
+    core->data.points[pointIndex].selectFlag = 1;
+    mark_page(&core->changes.points, pointIndex);
+    sel->pointSlot[pointIndex] = (CadIndex)sel->pointCount;
+    sel->selectedPoints[sel->pointCount++] = pointIndex;
+}
+
+void CadCore_SelectPolygon(CadCore* core, CadIndex polygonIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return;
+    CadSelection* sel = &core->selection;
+    if (sel->polygonSlot[polygonIndex] != INVALID_INDEX) return; /* Already selected */
+    
+    core->data.polygons[polygonIndex].selectFlag = 1;
+    mark_page(&core->changes.polygons, polygonIndex);
+    sel->polygonSlot[polygonIndex] = (CadIndex)sel->polygonCount;
+    sel->selectedPolygons[sel->polygonCount++] = polygonIndex;
+}
+
+/* Remove entry 'slot' from a dense list by moving the last entry into it */
+static void remove_from_dense(CadIndex* list, CadIndex* slots, int* count, CadIndex slot) {
+    CadIndex last = list[--(*count)];
+    list[slot] = last;
+    slots[last] = slot;
+}
+
+void CadCore_DeselectPoint(CadCore* core, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return;
+    CadSelection* sel = &core->selection;
+    CadIndex slot = sel->pointSlot[pointIndex];
+    if (slot == INVALID_INDEX) return;
+    
+    core->data.points[pointIndex].selectFlag = 0;
+    mark_page(&core->changes.points, pointIndex);
+    remove_from_dense(sel->selectedPoints, sel->pointSlot, &sel->pointCount, slot);
+    sel->pointSlot[pointIndex] = INVALID_INDEX;
+}
+
+void CadCore_DeselectPolygon(CadCore* core, CadIndex polygonIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return;
+    CadSelection* sel = &core->selection;
+    CadIndex slot = sel->polygonSlot[polygonIndex];
+    if (slot == INVALID_INDEX) return;
+    
+    core->data.polygons[polygonIndex].selectFlag = 0;
+    mark_page(&core->changes.polygons, polygonIndex);
+    remove_from_dense(sel->selectedPolygons, sel->polygonSlot, &sel->polygonCount, slot);
+    sel->polygonSlot[polygonIndex] = INVALID_INDEX;
+}
+
+int CadCore_IsPointSelected(CadCore* core, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
+    return core->selection.pointSlot[pointIndex] != INVALID_INDEX;
+}
+
+int CadCore_IsPolygonSelected(CadCore* core, CadIndex polygonIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
+    return core->selection.polygonSlot[polygonIndex] != INVALID_INDEX;
+}
+
+void CadCore_RebuildSelection(CadCore* core) {
+    if (!core || !sync_capacity(core)) return;
+    CadSelection* sel = &core->selection;
+    sel->pointCount = 0;
+    sel->polygonCount = 0;
+    for (int i = 0; i < core->pointCapacity; i++) sel->pointSlot[i] = INVALID_INDEX;
+    for (int i = 0; i < core->polygonCapacity; i++) sel->polygonSlot[i] = INVALID_INDEX;
+    
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        if (core->data.points[i].selectFlag) {
+            core->data.points[i].selectFlag = 0;
+            mark_page(&core->changes.points, i);
+            CadCore_SelectPoint(core, i);
+        }
+    }
+    for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
+        if (core->data.polygons[i].selectFlag) {
+            core->data.polygons[i].selectFlag = 0;
+            mark_page(&core->changes.polygons, i);
+            CadCore_SelectPolygon(core, i);
+        }
+    }
+}
+
+void CadCore_SelectAll(CadCore* core) {
+    if (!core) return;
+    
+    if (core->selectModeFlag == 1) {
+        /* Select all points */
+        for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+            CadCore_SelectPoint(core, i);
+        }
+    } else {
+        /* Select all polygons */
+        for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
+            CadCore_SelectPolygon(core, i);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   Edit mode
+   ---------------------------------------------------------------------------- */
+
+void CadCore_SetEditMode(CadCore* core, CadEditMode mode) {
+    if (!core) return;
+    core->editMode = mode;
+    
+    /* Update selectModeFlag based on mode */
+    if (mode == CAD_MODE_SELECT_POINT || mode == CAD_MODE_EDIT_POINT) {
+        core->selectModeFlag = 1;
+    } else if (mode == CAD_MODE_SELECT_POLYGON || mode == CAD_MODE_EDIT_POLYGON) {
+        core->selectModeFlag = 0;
+    }
+}
+
+CadEditMode CadCore_GetEditMode(CadCore* core) {
+    if (!core) return CAD_MODE_SELECT_POINT;
+    return core->editMode;
+}
+
+/* ----------------------------------------------------------------------------
+   Linked list helpers
+   ---------------------------------------------------------------------------- */
+
+CadIndex CadCore_GetFirstPointOfPolygon(CadCore* core, CadIndex polygonIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return INVALID_INDEX;
+    return core->data.polygons[polygonIndex].firstPoint;
+}
+
+CadIndex CadCore_GetNextPoint(CadCore* core, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return INVALID_INDEX;
+    return core->data.points[pointIndex].nextPoint;
+}
+
+CadIndex CadCore_GetNextPolygon(CadCore* core, CadIndex polygonIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return INVALID_INDEX;
+    return core->data.polygons[polygonIndex].nextPolygon;
+}
+
+CadIndex CadCore_GetFirstPolygonOfObject(CadCore* core, CadIndex objectIndex) {
+    if (!core || !CadCore_IsObjectValid(core, objectIndex)) return INVALID_INDEX;
+    return core->data.objects[objectIndex].firstPolygon;
+}
+
+/* ----------------------------------------------------------------------------
    Validation
    ---------------------------------------------------------------------------- */
 
-int CadCore_ValidatePolygon(CadCore* core, int16_t polygonIndex) {
-    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
+int CadCore_ValidatePolygon(CadCore* core, CadIndex polygonIndex) {
+    if (!core || !CadCore_IsPolygonValid(core, polygonIndex)) return 0;
+    
+    CadPolygon* poly = &core->data.polygons[polygonIndex];
+    
+    /* Check minimum vertex count */
+    if (poly->npoints < 2) return 0;
+    
+    /* The flattened walk stops at the first invalid or repeated point, so
+       it covers npoints entries only if the whole chain is sound */
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    if (!index) return 0;
+    return index->offsets[polygonIndex + 1] - index->offsets[polygonIndex] == poly->npoints;
+}
+
+int CadCore_ValidatePoint(CadCore* core, CadIndex pointIndex) {
+    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
+    return 1; /* Point is valid if it exists */
+}
+
+/* ----------------------------------------------------------------------------
+   Statistics
+   ---------------------------------------------------------------------------- */
+
+int CadCore_GetActivePointCount(CadCore* core) {
+    if (!core) return 0;
+    return core->live.pointCount;
+}
+
+int CadCore_GetActivePolygonCount(CadCore* core) {
+    if (!core) return 0;
+    return core->live.polygonCount;
+}
+
+int CadCore_GetActiveObjectCount(CadCore* core) {
+    if (!core) return 0;
+    return core->live.objectCount;
+}
+
+/* ----------------------------------------------------------------------------
+   Compaction
+   ---------------------------------------------------------------------------- */
+
+/* Number live slots densely in index order; returns the live count */
+static int build_remap(CadIndex* map, const uint64_t* live, int count) {
+    int next = 0;
+    for (int i = 0; i < count; i++) {
+        map[i] = (live[i >> 6] >> (i & 63)) & 1 ? (CadIndex)next++ : INVALID_INDEX;
+    }
+    return next;
+}
+
+static CadIndex remap_link(const CadIndex* map, int count, CadIndex i) {
+    return (i >= 0 && i < count) ? map[i] : INVALID_INDEX;
+}
+
+static void remap_dense_list(CadIndex* list, CadIndex* slots, int count, const CadIndex* map) {
+    for (int k = 0; k < count; k++) {
+        list[k] = map[list[k]];
+        slots[list[k]] = (CadIndex)k;
+    }
+}
+
+int CadCore_Compact(CadCore* core, CadRemap* remap) {
+    if (!core) return 0;
+    
+    CadFileData* data = &core->data;
+    int np = data->pointCount;
+    int ng = data->polygonCount;
+    int no = data->objectCount;
+    CadIndex* pointMap = (CadIndex*)malloc((size_t)(np > 0 ? np : 1) * sizeof(CadIndex));
+    CadIndex* polygonMap = (CadIndex*)malloc((size_t)(ng > 0 ? ng : 1) * sizeof(CadIndex));
+    CadIndex* objectMap = (CadIndex*)malloc((size_t)(no > 0 ? no : 1) * sizeof(CadIndex));
+    if (!pointMap || !polygonMap || !objectMap) {
+        fprintf(stderr, "Error: Out of memory compacting model\n");
+        free(pointMap);
+        free(polygonMap);
+        free(objectMap);
+        return 0;
+    }
+    
+    int livePoints = build_remap(pointMap, core->live.points, np);
+    int livePolygons = build_remap(polygonMap, core->live.polygons, ng);
+    int liveObjects = build_remap(objectMap, core->live.objects, no);
+    
+    if (livePoints < np || livePolygons < ng || liveObjects < no) {
+        mark_all_changed(core);
+        
+        /* New index <= old index, so one forward pass never overwrites a
+           record it has yet to read */
+        for (int i = 0; i < np; i++) {
+            CadIndex n = pointMap[i];
+            if (n == INVALID_INDEX) continue;
+            CadPoint pt = data->points[i];
+            pt.nextPoint = remap_link(pointMap, np, pt.nextPoint);
+            data->points[n] = pt;
+            data->pointX[n] = data->pointX[i];
+            data->pointY[n] = data->pointY[i];
+            data->pointZ[n] = data->pointZ[i];
+        }
+        for (int i = 0; i < ng; i++) {
+            CadIndex n = polygonMap[i];
+            if (n == INVALID_INDEX) continue;
+            CadPolygon poly = data->polygons[i];
+            poly.nextPolygon = remap_link(polygonMap, ng, poly.nextPolygon);
+            poly.firstPoint = remap_link(pointMap, np, poly.firstPoint);
+            poly.both = remap_link(polygonMap, ng, poly.both);
+            data->polygons[n] = poly;
+        }
+        for (int i = 0; i < no; i++) {
+            CadIndex n = objectMap[i];
+            if (n == INVALID_INDEX) continue;
+            CadObject obj = data->objects[i];
+            obj.parentObject = remap_link(objectMap, no, obj.parentObject);
+            obj.nextBrother = remap_link(objectMap, no, obj.nextBrother);
+            obj.childObject = remap_link(objectMap, no, obj.childObject);
+            obj.firstPolygon = remap_link(polygonMap, ng, obj.firstPolygon);
+            data->objects[n] = obj;
+        }
+        
+        /* Vacated tail slots read back as deleted, with zeroed coordinates */
+        if (np > livePoints) {
+            memset(&data->points[livePoints], 0, (size_t)(np - livePoints) * sizeof(CadPoint));
+            memset(&data->pointX[livePoints], 0, (size_t)(np - livePoints) * sizeof(double));
+            memset(&data->pointY[livePoints], 0, (size_t)(np - livePoints) * sizeof(double));
+            memset(&data->pointZ[livePoints], 0, (size_t)(np - livePoints) * sizeof(double));
+        }
+        if (ng > livePolygons) {
+            memset(&data->polygons[livePolygons], 0, (size_t)(ng - livePolygons) * sizeof(CadPolygon));
+        }
+        if (no > liveObjects) {
+            memset(&data->objects[liveObjects], 0, (size_t)(no - liveObjects) * sizeof(CadObject));
+        }
+        data->pointCount = livePoints;
+        data->polygonCount = livePolygons;
+        data->objectCount = liveObjects;
+        
+        /* Selection keeps its order; only the indices change */
+        CadSelection* sel = &core->selection;
+        for (int i = 0; i < np; i++) sel->pointSlot[i] = INVALID_INDEX;
+        for (int i = 0; i < ng; i++) sel->polygonSlot[i] = INVALID_INDEX;
+        remap_dense_list(sel->selectedPoints, sel->pointSlot, sel->pointCount, pointMap);
+        remap_dense_list(sel->selectedPolygons, sel->polygonSlot, sel->polygonCount, polygonMap);
+        
+        core->newPoint = remap_link(pointMap, np, core->newPoint);
+        core->creatingPoint = remap_link(pointMap, np, core->creatingPoint);
+        core->firstPoint = remap_link(pointMap, np, core->firstPoint);
+        core->newPolygon = remap_link(polygonMap, ng, core->newPolygon);
+        core->rootPolygon = remap_link(polygonMap, ng, core->rootPolygon);
+        
+        CadCore_RebuildFreeLists(core);
+        CadCore_RebuildAdjacency(core);
+        core->isDirty = 1;
+    }
+    
+    if (remap) {
+        remap->points = pointMap;
+        remap->polygons = polygonMap;
+        remap->objects = objectMap;
+        remap->pointCount = np;
+        remap->polygonCount = ng;
+        remap->objectCount = no;
+    } else {
+        free(pointMap);
+        free(polygonMap);
+        free(objectMap);
+    }
+    return 1;
+}
+
+void CadCore_FreeRemap(CadRemap* remap) {
+    if (!remap) return;
+    free(remap->points);
+    free(remap->polygons);
+    free(remap->objects);
+    memset(remap, 0, sizeof(CadRemap));
+}
+
+/* ----------------------------------------------------------------------------
+   Snapshots
+   ---------------------------------------------------------------------------- */
+
+struct CadSnapshotPage {
+    int refs;
+    int slots;                   /* Records held (a pool's last page may be short) */
+    double payload[];            /* Point pages: x, y, z arrays, then records */
+};
+
+static size_t page_slot_size(int pool) {
+    switch (pool) {
+    case CAD_POOL_POINTS:   return sizeof(CadPoint) + 3 * sizeof(double);
+    case CAD_POOL_POLYGONS: return sizeof(CadPolygon);
+    default:                return sizeof(CadObject);
+    }
+}
+
+static int pool_count(const CadFileData* data, int pool) {
+    switch (pool) {
+    case CAD_POOL_POINTS:   return data->pointCount;
+    case CAD_POOL_POLYGONS: return data->polygonCount;
+    default:                return data->objectCount;
+    }
+}
+
+static CadPoolChanges* pool_changes(CadCore* core, int pool) {
+    switch (pool) {
+    case CAD_POOL_POINTS:   return &core->changes.points;
+    case CAD_POOL_POLYGONS: return &core->changes.polygons;
+    default:                return &core->changes.objects;
+    }
+}
+
+static int page_is_dirty(const CadPoolChanges* changes, int page) {
+    return (int)((changes->snapshotPages[page >> 6] >> (page & 63)) & 1);
+}
+
+/* Copy slots [first, first + n) between the pools and a page buffer
+   (to_page selects the direction) */
+static void page_transfer(CadFileData* data, int pool, CadSnapshotPage* page, int first, int to_page) {
+    int n = page->slots;
+    void* records;
+    void* slot;
+    size_t size;
+    
+    if (pool == CAD_POOL_POINTS) {
+        double* x = page->payload;
+        double* y = x + n;
+        double* z = y + n;
+        if (to_page) {
+            memcpy(x, &data->pointX[first], (size_t)n * sizeof(double));
+            memcpy(y, &data->pointY[first], (size_t)n * sizeof(double));
+            memcpy(z, &data->pointZ[first], (size_t)n * sizeof(double));
+        } else {
+            memcpy(&data->pointX[first], x, (size_t)n * sizeof(double));
+            memcpy(&data->pointY[first], y, (size_t)n * sizeof(double));
+            memcpy(&data->pointZ[first], z, (size_t)n * sizeof(double));
+        }
+        records = z + n;
+        slot = &data->points[first];
+        size = sizeof(CadPoint);
+    } else if (pool == CAD_POOL_POLYGONS) {
+        records = page->payload;
+        slot = &data->polygons[first];
+        size = sizeof(CadPolygon);
+    } else {
+        records = page->payload;
+        slot = &data->objects[first];
+        size = sizeof(CadObject);
+    }
+    
+    if (to_page) memcpy(records, slot, (size_t)n * size);
+    else memcpy(slot, records, (size_t)n * size);
+}
+
+static void release_table(CadPageTable* table) {
+    for (int pool = 0; pool < 3; pool++) {
+        for (int p = 0; p < table->pageCount[pool]; p++) {
+            CadSnapshotPage* page = table->pages[pool][p];
+            if (page && --page->refs == 0) free(page);
+        }
+        free(table->pages[pool]);
+    }
+    memset(table, 0, sizeof(CadPageTable));
+}
+
+/* Make dst share src's pages */
+static int copy_table(CadPageTable* dst, const CadPageTable* src) {
+    CadPageTable copy;
+    memset(&copy, 0, sizeof(copy));
+    for (int pool = 0; pool < 3; pool++) {
+        int n = src->pageCount[pool];
+        copy.pages[pool] = (CadSnapshotPage**)malloc((size_t)(n > 0 ? n : 1) * sizeof(CadSnapshotPage*));
+        if (!copy.pages[pool]) {
+            release_table(&copy);
+            return 0;
+        }
+        for (int p = 0; p < n; p++) {
+            copy.pages[pool][p] = src->pages[pool][p];
+            copy.pages[pool][p]->refs++;
+        }
+        copy.pageCount[pool] = n;
+        copy.count[pool] = src->count[pool];
+    }
+    release_table(dst);
+    *dst = copy;
+    return 1;
+}
+
+/* Build a table of the current pools, sharing base pages the model has not
+   written since it last matched them */
+static int capture_table(CadCore* core, const CadPageTable* base, CadPageTable* table) {
+    memset(table, 0, sizeof(CadPageTable));
+    for (int pool = 0; pool < 3; pool++) {
+        const CadPoolChanges* changes = pool_changes(core, pool);
+        int count = pool_count(&core->data, pool);
+        int pages = PAGE_COUNT(count);
+        
+        table->pages[pool] = (CadSnapshotPage**)calloc((size_t)(pages > 0 ? pages : 1), sizeof(CadSnapshotPage*));
+        if (!table->pages[pool]) goto fail;
+        table->pageCount[pool] = pages;
+        table->count[pool] = count;
+        
+        for (int p = 0; p < pages; p++) {
+            int first = p << CAD_SNAPSHOT_PAGE_SHIFT;
+            int slots = count - first < CAD_SNAPSHOT_PAGE_SLOTS ? count - first : CAD_SNAPSHOT_PAGE_SLOTS;
+            CadSnapshotPage* page;
+            
+            if (p < base->pageCount[pool] && !page_is_dirty(changes, p) &&
+                base->pages[pool][p]->slots == slots) {
+                page = base->pages[pool][p];
+                page->refs++;
+            } else {
+                page = (CadSnapshotPage*)malloc(sizeof(CadSnapshotPage) + (size_t)slots * page_slot_size(pool));
+                if (!page) goto fail;
+                page->refs = 1;
+                page->slots = slots;
+                page_transfer(&core->data, pool, page, first, 1);
+            }
+            table->pages[pool][p] = page;
+        }
+    }
+    return 1;
+    
+fail:
+    release_table(table);
+    return 0;
+}
+
+static void clear_snapshot_pages(CadCore* core) {
+    fill_pages(&core->changes.points, core->pointCapacity, 0);
+    fill_pages(&core->changes.polygons, core->polygonCapacity, 0);
+    fill_pages(&core->changes.objects, core->objectCapacity, 0);
+}
+
+void CadCore_InitSnapshots(CadSnapshotStore* store) {
+    if (!store) return;
+    memset(store, 0, sizeof(CadSnapshotStore));
+}
+
+void CadCore_FreeSnapshots(CadSnapshotStore* store) {
+    if (!store) return;
+    for (int s = 0; s < CAD_SNAPSHOT_SLOTS; s++) release_table(&store->slots[s].table);
+    release_table(&store->base);
+    memset(store, 0, sizeof(CadSnapshotStore));
+}
+
+int CadCore_TakeSnapshot(CadCore* core, CadSnapshotStore* store, const char* name) {
+    if (!core || !store || !sync_capacity(core)) return -1;
+    
+    /* First free slot, else the oldest */
+    int slot = 0;
+    for (int s = 0; s < CAD_SNAPSHOT_SLOTS; s++) {
+        if (!store->slots[s].used) {
+            slot = s;
+            break;
+        }
+        if ((int32_t)(store->slots[s].serial - store->slots[slot].serial) < 0) slot = s;
+    }
+    
+    CadPageTable table;
+    if (!capture_table(core, &store->base, &table)) {
+        fprintf(stderr, "Error: Out of memory taking snapshot\n");
+        return -1;
+    }
+    if (!copy_table(&store->base, &table)) {
+        release_table(&table);
+        fprintf(stderr, "Error: Out of memory taking snapshot\n");
+        return -1;
+    }
+    clear_snapshot_pages(core);
+    
+    CadSnapshot* snap = &store->slots[slot];
+    release_table(&snap->table);
+    snap->table = table;
+    snap->used = 1;
+    snap->serial = store->nextSerial++;
+    snprintf(snap->name, sizeof(snap->name), "%s", name ? name : "");
+    return slot;
+}
+
+int CadCore_RestoreSnapshot(CadCore* core, CadSnapshotStore* store, int slot) {
+    if (!core || !store || slot < 0 || slot >= CAD_SNAPSHOT_SLOTS || !store->slots[slot].used) return 0;
+    
+    const CadPageTable* target = &store->slots[slot].table;
+    CadPageTable* base = &store->base;
+    CadFileData* data = &core->data;
+    if (!CadCore_Reserve(core, target->count[CAD_POOL_OBJECTS], target->count[CAD_POOL_POLYGONS],
+                         target->count[CAD_POOL_POINTS])) {
+        fprintf(stderr, "Error: Out of memory restoring snapshot\n");
+        return 0;
+    }
+    
+    for (int pool = 0; pool < 3; pool++) {
+        const CadPoolChanges* changes = pool_changes(core, pool);
+        int count = target->count[pool];
+        int old_count = pool_count(data, pool);
+        
+        /* Pages the model still shares with the target are already in place */
+        for (int p = 0; p < target->pageCount[pool]; p++) {
+            CadSnapshotPage* page = target->pages[pool][p];
+            if (p < base->pageCount[pool] && base->pages[pool][p] == page && !page_is_dirty(changes, p)) continue;
+            page_transfer(data, pool, page, p << CAD_SNAPSHOT_PAGE_SHIFT, 0);
+        }
+        
+        /* Slots past the target's high-water mark read back as unused */
+        if (old_count > count) {
+            size_t n = (size_t)(old_count - count);
+            if (pool == CAD_POOL_POINTS) {
+                memset(&data->points[count], 0, n * sizeof(CadPoint));
+                memset(&data->pointX[count], 0, n * sizeof(double));
+                memset(&data->pointY[count], 0, n * sizeof(double));
+                memset(&data->pointZ[count], 0, n * sizeof(double));
+            } else if (pool == CAD_POOL_POLYGONS) {
+                memset(&data->polygons[count], 0, n * sizeof(CadPolygon));
+            } else {
+                memset(&data->objects[count], 0, n * sizeof(CadObject));
+            }
+        }
+    }
+    data->pointCount = target->count[CAD_POOL_POINTS];
+    data->polygonCount = target->count[CAD_POOL_POLYGONS];
+    data->objectCount = target->count[CAD_POOL_OBJECTS];
+    
+    mark_all_changed(core);
+    CadCore_RebuildFreeLists(core);
+    CadCore_RebuildAdjacency(core);
+    CadCore_RebuildSelection(core);
+    core->newPoint = INVALID_INDEX;
+    core->newPolygon = INVALID_INDEX;
+    core->rootPolygon = INVALID_INDEX;
+    core->creatingPoint = INVALID_INDEX;
+    core->firstPoint = INVALID_INDEX;
+    core->isDirty = 1;
+    
+    /* The model now equals the target; if the base cannot follow, leave
+       every page dirty so the next capture copies instead of sharing */
+    if (copy_table(base, target)) clear_snapshot_pages(core);
+    return 1;
+}
+
+void CadCore_DeleteSnapshot(CadSnapshotStore* store, int slot) {
+    if (!store || slot < 0 || slot >= CAD_SNAPSHOT_SLOTS) return;
+    release_table(&store->slots[slot].table);
+    memset(&store->slots[slot], 0, sizeof(CadSnapshot));
+}
+
+/* ----------------------------------------------------------------------------
+   Merge detection
+   ---------------------------------------------------------------------------- */
+
+/* Convert coordinate to integer (round half up) - matches original Convert() function */
+int CadCore_ConvertCoordinate(double coord) {
+    double fractional;
+    double integer;
+    fractional = coord - (integer = (double)(int)coord);
+    
+    if (coord >= 0.0) {
+        if (fractional >= 0.5) integer += 1.0;
+    } else {
+        if (fractional <= -0.5) integer -= 1.0;
+    }
+    
+    return (int)integer;
+}
+
+static int convert_coordinate(double coord) {
+    return CadCore_ConvertCoordinate(coord);
+}
+
+/* Check if two points snap to the same integer grid location */
+static int same_grid_location(const CadFileData* data, CadIndex a, CadIndex b) {
+    return convert_coordinate(data->pointX[a]) == convert_coordinate(data->pointX[b]) &&
+           convert_coordinate(data->pointY[a]) == convert_coordinate(data->pointY[b]) &&
+           convert_coordinate(data->pointZ[a]) == convert_coordinate(data->pointZ[b]);
+}
+
+/* Check if coordinates are merged (all coordinates are integers) */
+int CadCore_AreCoordinatesMerged(CadCore* core) {
+    if (!core) return 0;
+    int points, objects;
+    CadCore_GetMergeStatus(core, &points, &objects, NULL);
+    return points == 0 && objects == 0;
+}
+
+/* Check if points are merged (no consecutive walk vertices, first and last
+   included, at the same grid location) */
+int CadCore_ArePointsMerged(CadCore* core) {
+    if (!core) return 0;
+    int duplicates;
+    CadCore_GetMergeStatus(core, NULL, NULL, &duplicates);
+    return duplicates == 0;
+}
+
+/* Check if all merge operations have been applied */
+int CadCore_IsFullyMerged(CadCore* core) {
+    if (!core) return 0;
+    
+    return CadCore_AreCoordinatesMerged(core) && CadCore_ArePointsMerged(core);
+}
+
+/* ----------------------------------------------------------------------------
+   Check if a point is connected to any polygon
+   ---------------------------------------------------------------------------- */
+int CadCore_IsPointConnected(CadCore* core, CadIndex pointIndex) {
+    if (!core || pointIndex < 0 || pointIndex >= core->data.pointCount) return 0;
+    if (!CadCore_IsPointValid(core, pointIndex)) return 0;
+    
+    /* Any node in the point's use list means some polygon references it */
+    return core->adjacency.pointFirstUse[pointIndex] != INVALID_INDEX;
+}
+
+/* ----------------------------------------------------------------------------
+   Merge operations
+   ---------------------------------------------------------------------------- */
+
+/* Coordinate snapping. Values are rounded like CadCore_ConvertCoordinate:
+   truncate, then step away from zero on a fraction of at least one half.
+   Quotients outside the int range (and NaN) are left unchanged. The SSE2
+   kernel mirrors snap_value exactly, two doubles at a time. */
+#define SNAP_LIMIT 2147483647.0
+
+static double snap_value(double v, double step) {
+    double q = v / step;
+    if (!(fabs(q) < SNAP_LIMIT)) return v;
+    return (double)convert_coordinate(q) * step;
+}
+
+static int off_grid(double v, double step) {
+    return fabs(v - snap_value(v, step)) > CAD_SNAP_EPSILON * step;
+}
+
+#ifdef CAD_HAVE_SSE2
+static __m128d snap_pd(__m128d v, __m128d step) {
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d q = _mm_div_pd(v, step);
+    __m128d t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(q));
+    __m128d f = _mm_sub_pd(q, t);
+    t = _mm_add_pd(t, _mm_and_pd(_mm_cmpge_pd(f, half), one));
+    t = _mm_sub_pd(t, _mm_and_pd(_mm_cmple_pd(f, _mm_xor_pd(half, sign)), one));
+    __m128d in_range = _mm_cmplt_pd(_mm_andnot_pd(sign, q), _mm_set1_pd(SNAP_LIMIT));
+    return _mm_or_pd(_mm_and_pd(in_range, _mm_mul_pd(t, step)), _mm_andnot_pd(in_range, v));
+}
+
+/* Lane mask (bit per double) of values further than tolerance from the grid */
+static int off_grid_pd(__m128d v, __m128d step, __m128d tolerance) {
+    __m128d diff = _mm_andnot_pd(_mm_set1_pd(-0.0), _mm_sub_pd(v, snap_pd(v, step)));
+    return _mm_movemask_pd(_mm_cmpgt_pd(diff, tolerance));
+}
+#endif
+
+/* Bookkeeping for a point whose coordinates were just snapped */
+static void snapped_point(CadCore* core, CadIndex i) {
+    mark_geometry(&core->changes.points, i);
+    point_changed(core, i);
+}
+
+int CadCore_SnapCoordinates(CadCore* core, double step) {
+    if (!core || !(step > 0.0)) return 0;
+    
+    CadFileData* data = &core->data;
+    int n = data->pointCount;
+    int changed = 0;
+    int i = 0;
+    CadCore_BeginUndoGroup(core);
+    
+    /* Unused slots hold 0.0, already on every grid, so the columns are
+       streamed without consulting flags */
+#ifdef CAD_HAVE_SSE2
+    const __m128d vstep = _mm_set1_pd(step);
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_load_pd(&data->pointX[i]);
+        __m128d y = _mm_load_pd(&data->pointY[i]);
+        __m128d z = _mm_load_pd(&data->pointZ[i]);
+        __m128d sx = snap_pd(x, vstep);
+        __m128d sy = snap_pd(y, vstep);
+        __m128d sz = snap_pd(z, vstep);
+        __m128d moved = _mm_or_pd(_mm_or_pd(_mm_cmpneq_pd(x, sx), _mm_cmpneq_pd(y, sy)),
+                                  _mm_cmpneq_pd(z, sz));
+        int mask = _mm_movemask_pd(moved);
+        if (!mask) continue;
+        
+        /* Record the moved lanes before writing; lanes that did not move
+           keep their exact bits (a -0.0 stays -0.0) */
+        if (mask & 1) journal_point(core, i);
+        if (mask & 2) journal_point(core, i + 1);
+        _mm_store_pd(&data->pointX[i], _mm_or_pd(_mm_and_pd(moved, sx), _mm_andnot_pd(moved, x)));
+        _mm_store_pd(&data->pointY[i], _mm_or_pd(_mm_and_pd(moved, sy), _mm_andnot_pd(moved, y)));
+        _mm_store_pd(&data->pointZ[i], _mm_or_pd(_mm_and_pd(moved, sz), _mm_andnot_pd(moved, z)));
+        if (mask & 1) snapped_point(core, i);
+        if (mask & 2) snapped_point(core, i + 1);
+        changed += (mask & 1) + (mask >> 1);
+    }
+#endif
+    for (; i < n; i++) {
+        double x = snap_value(data->pointX[i], step);
+        double y = snap_value(data->pointY[i], step);
+        double z = snap_value(data->pointZ[i], step);
+        if (x == data->pointX[i] && y == data->pointY[i] && z == data->pointZ[i]) continue;
+        journal_point(core, i);
+        data->pointX[i] = x;
+        data->pointY[i] = y;
+        data->pointZ[i] = z;
+        snapped_point(core, i);
+        changed++;
+    }
+    
+    for (CadIndex o = CadCore_NextLiveObject(core, 0); o >= 0; o = CadCore_NextLiveObject(core, o + 1)) {
+        CadObject* obj = &data->objects[o];
+        double ox = snap_value(obj->offsetx, step);
+        double oy = snap_value(obj->offsety, step);
+        double oz = snap_value(obj->offsetz, step);
+        if (ox == obj->offsetx && oy == obj->offsety && oz == obj->offsetz) continue;
+        journal_object(core, o);
+        obj->offsetx = ox;
+        obj->offsety = oy;
+        obj->offsetz = oz;
+        mark_geometry(&core->changes.objects, o);
+        changed++;
+    }
+    
+    CadCore_EndUndoGroup(core);
+    if (changed) core->isDirty = 1;
+    return changed;
+}
+
+int CadCore_FindOffGridPoints(const CadCore* core, double step, CadIndex* out, int maxCount) {
+    if (!core || !(step > 0.0)) return 0;
+    
+    const CadFileData* data = &core->data;
+    int n = data->pointCount;
+    int found = 0;
+    int i = 0;
+#ifdef CAD_HAVE_SSE2
+    const __m128d vstep = _mm_set1_pd(step);
+    const __m128d tolerance = _mm_set1_pd(CAD_SNAP_EPSILON * step);
+    for (; i + 2 <= n; i += 2) {
+        int mask = off_grid_pd(_mm_load_pd(&data->pointX[i]), vstep, tolerance) |
+                   off_grid_pd(_mm_load_pd(&data->pointY[i]), vstep, tolerance) |
+                   off_grid_pd(_mm_load_pd(&data->pointZ[i]), vstep, tolerance);
+        for (int lane = 0; mask; lane++, mask >>= 1) {
+            if (!(mask & 1)) continue;
+            if (out && found < maxCount) out[found] = (CadIndex)(i + lane);
+            found++;
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (!off_grid(data->pointX[i], step) && !off_grid(data->pointY[i], step) &&
+            !off_grid(data->pointZ[i], step)) continue;
+        if (out && found < maxCount) out[found] = (CadIndex)i;
+        found++;
+    }
+    return found;
+}
+
+int CadCore_FindOffGridObjects(const CadCore* core, double step, CadIndex* out, int maxCount) {
+    if (!core || !(step > 0.0)) return 0;
+    
+    int found = 0;
+    for (CadIndex o = CadCore_NextLiveObject(core, 0); o >= 0; o = CadCore_NextLiveObject(core, o + 1)) {
+        const CadObject* obj = &core->data.objects[o];
+        if (!off_grid(obj->offsetx, step) && !off_grid(obj->offsety, step) &&
+            !off_grid(obj->offsetz, step)) continue;
+        if (out && found < maxCount) out[found] = o;
+        found++;
+    }
+    return found;
+}
+
+/* Representative of each live point's integer grid cell: the first live
+   point hashed into it (-1 for dead slots). Expected O(N). */
+static int build_grid_representatives(const CadCore* core, CadIndex* rep) {
+    const CadFileData* data = &core->data;
+    int size = 64;
+    while (size < (1 << 30) && size / 2 < core->live.pointCount) size *= 2;
+    
+    CadIndex* table = (CadIndex*)malloc((size_t)size * sizeof(CadIndex));
+    int* keys = (int*)malloc((size_t)size * 3 * sizeof(int));
+    if (!table || !keys) {
+        free(table);
+        free(keys);
+        return 0;
+    }
+    for (int s = 0; s < size; s++) table[s] = INVALID_INDEX;
+    for (int i = 0; i < data->pointCount; i++) rep[i] = INVALID_INDEX;
+    
+    uint32_t mask = (uint32_t)size - 1;
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        int kx = convert_coordinate(data->pointX[i]);
+        int ky = convert_coordinate(data->pointY[i]);
+        int kz = convert_coordinate(data->pointZ[i]);
+        uint32_t s = hash_cell((uint32_t)kx, (uint32_t)ky, (uint32_t)kz) & mask;
+        while (table[s] != INVALID_INDEX &&
+               (keys[3 * s] != kx || keys[3 * s + 1] != ky || keys[3 * s + 2] != kz)) {
+            s = (s + 1) & mask;
+        }
+        if (table[s] == INVALID_INDEX) {
+            table[s] = i;
+            keys[3 * s] = kx;
+            keys[3 * s + 1] = ky;
+            keys[3 * s + 2] = kz;
+        }
+        rep[i] = table[s];
+    }
+    
+    free(table);
+    free(keys);
+    return 1;
+}
+
+/* For every live point, the first chain successor in a different cell, so
+   a run of co-located vertices collapses onto its first point. Each point
+   is resolved once: a walk stops at an already resolved successor. */
+static void build_cell_skips(const CadCore* core, const CadIndex* rep, CadIndex* skip,
+                             CadIndex* path, uint8_t* state) {
+    const CadFileData* data = &core->data;
+    memset(state, 0, (size_t)data->pointCount);
+    
+    for (CadIndex u = CadCore_NextLivePoint(core, 0); u >= 0; u = CadCore_NextLivePoint(core, u + 1)) {
+        if (state[u]) continue;
+        
+        int depth = 0;
+        CadIndex v = u;
+        CadIndex target;
+        for (;;) {
+            state[v] = 1; /* On the current path */
+            path[depth++] = v;
+            CadIndex n = data->points[v].nextPoint;
+            if (!CadCore_IsPointValid((CadCore*)core, n)) {
+                target = INVALID_INDEX;
+                break;
+            }
+            if (rep[n] != rep[v] || state[n] == 1) {
+                target = n; /* Next cell, or a cycle inside one cell */
+                break;
+            }
+            if (state[n] == 2) {
+                target = skip[n];
+                break;
+            }
+            v = n;
+        }
+        while (depth > 0) {
+            CadIndex p = path[--depth];
+            skip[p] = target;
+            state[p] = 2;
+        }
+    }
+}
+
+int CadCore_MergePoints(CadCore* core) {
+    if (!core) return -1;
+    
+    CadFileData* data = &core->data;
+    int np = data->pointCount;
+    int ng = data->polygonCount;
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    CadIndex* rep = (CadIndex*)malloc((size_t)(np > 0 ? np : 1) * sizeof(CadIndex));
+    CadIndex* skip = (CadIndex*)malloc((size_t)(np > 0 ? np : 1) * sizeof(CadIndex));
+    CadIndex* path = (CadIndex*)malloc((size_t)(np > 0 ? np : 1) * sizeof(CadIndex));
+    uint8_t* state = (uint8_t*)malloc((size_t)(np > 0 ? np : 1));
+    int* npoints = (int*)malloc((size_t)(ng > 0 ? ng : 1) * sizeof(int));
+    if (!index || !rep || !skip || !path || !state || !npoints || !build_grid_representatives(core, rep)) {
+        fprintf(stderr, "Error: Out of memory merging points\n");
+        free(rep);
+        free(skip);
+        free(path);
+        free(state);
+        free(npoints);
+        return -1;
+    }
+    build_cell_skips(core, rep, skip, path, state);
+    
+    /* Plan each polygon from its current walk: drop a vertex in the same
+       cell as the one before it, then a last vertex back in the first
+       vertex's cell. Faces left with too few vertices are deleted (-1).
+       state becomes 1 for every vertex some surviving walk keeps. */
+    enum { NOT_WALKED = 0, WALKED = 1, MERGED = 2 };
+    memset(state, NOT_WALKED, (size_t)np);
+    int changed = 0;
+    for (int p = 0; p < ng; p++) npoints[p] = data->polygons[p].npoints;
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        const CadIndex* v = &index->vertices[index->offsets[p]];
+        int count = index->offsets[p + 1] - index->offsets[p];
+        if (count == 0) continue;
+        
+        int kept = 1;
+        for (int j = 1; j < count; j++) {
+            if (rep[v[j]] != rep[v[j - 1]]) kept++;
+        }
+        if (kept > 1 && rep[v[count - 1]] == rep[v[0]]) kept--;
+        if (kept < CAD_MIN_FACE_POINTS) {
+            npoints[p] = -1;
+            changed = 1;
+            continue;
+        }
+        if (kept == count) {
+            for (int j = 0; j < count; j++) state[v[j]] = WALKED;
+            continue;
+        }
+        
+        changed = 1;
+        npoints[p] = kept;
+        state[v[0]] = WALKED;
+        for (int j = 1, k = 1; j < count && k < kept; j++) {
+            if (rep[v[j]] != rep[v[j - 1]]) {
+                state[v[j]] = WALKED;
+                k++;
+            }
+        }
+    }
+    if (!changed) {
+        free(rep);
+        free(skip);
+        free(path);
+        free(state);
+        free(npoints);
+        return 0;
+    }
+    
+    /* Vertices that were walked before and are not now have been merged
+       into a neighbour */
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        if (state[i] == NOT_WALKED && core->adjacency.pointFirstUse[i] != INVALID_INDEX) state[i] = MERGED;
+    }
+    
+    CadCore_BeginUndoGroup(core);
+    for (int p = 0; p < ng; p++) {
+        if (npoints[p] < 0) CadCore_DeletePolygon(core, p);
+    }
+    
+    /* Kept vertices link past their cell's run; no link may reach a merged
+       point, which only walks that no longer pass through it could use */
+    for (CadIndex u = CadCore_NextLivePoint(core, 0); u >= 0; u = CadCore_NextLivePoint(core, u + 1)) {
+        if (state[u] == MERGED) continue;
+        CadIndex next = state[u] == WALKED ? skip[u] : data->points[u].nextPoint;
+        if (next >= 0 && next < np && state[next] == MERGED) next = INVALID_INDEX;
+        if (next == data->points[u].nextPoint) continue;
+        journal_point(core, u);
+        data->points[u].nextPoint = next;
+        mark_topology(&core->changes.points, u);
+    }
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        if (npoints[p] == data->polygons[p].npoints) continue;
+        journal_polygon(core, p);
+        data->polygons[p].npoints = (uint8_t)npoints[p];
+        mark_topology(&core->changes.polygons, p);
+    }
+    CadCore_RebuildAdjacency(core);
+    
+    int merged = 0;
+    for (int i = 0; i < np; i++) {
+        if (state[i] == MERGED && CadCore_DeletePoint(core, i)) merged++;
+    }
+    CadCore_EndUndoGroup(core);
+    core->isDirty = 1;
+    
+    free(rep);
+    free(skip);
+    free(path);
+    free(state);
+    free(npoints);
+    return merged;
+}
+
+
+/* Polygon Merge works on private vertex rings (one CAD_MAX_FACE_POINTS row
+   per polygon) and writes the survivors back at the end. Vertices are
+   identified by grid cell representative, since neighbouring faces
+   normally own separate point slots at the same location. */
+#define MERGE_EDGE_SHARED (-2)   /* Directed edge used by more than one face */
+
+typedef struct {
+    CadIndex from;               /* Cell representatives (-1 = empty slot) */
+    CadIndex to;
+    CadIndex polygon;            /* Face walking from -> to, or MERGE_EDGE_SHARED */
+} MergeEdge;
+
+static CadIndex merge_root(CadIndex* alias, CadIndex p) {
+    while (alias[p] != p) {
+        alias[p] = alias[alias[p]];
+        p = alias[p];
+    }
+    return p;
+}
+
+static MergeEdge* merge_edge_slot(MergeEdge* edges, uint32_t mask, CadIndex from, CadIndex to) {
+    uint32_t s = hash_cell((uint32_t)from, (uint32_t)to, 0) & mask;
+    while (edges[s].from != INVALID_INDEX && (edges[s].from != from || edges[s].to != to)) {
+        s = (s + 1) & mask;
+    }
+    return &edges[s];
+}
+
+static void merge_vertex(const CadFileData* data, CadIndex i, double v[3]) {
+    v[0] = data->pointX[i];
+    v[1] = data->pointY[i];
+    v[2] = data->pointZ[i];
+}
+
+/* Unit Newell normal and plane offset of count interleaved xyz vertices;
+   0 if degenerate */
+static int newell_plane(const double* xyz, int count, double plane[4]) {
+    double n[3] = { 0.0, 0.0, 0.0 };
+    double c[3] = { 0.0, 0.0, 0.0 };
+    for (int k = 0; k < count; k++) {
+        const double* a = &xyz[3 * k];
+        const double* b = &xyz[3 * ((k + 1) % count)];
+        n[0] += (a[1] - b[1]) * (a[2] + b[2]);
+        n[1] += (a[2] - b[2]) * (a[0] + b[0]);
+        n[2] += (a[0] - b[0]) * (a[1] + b[1]);
+        c[0] += a[0];
+        c[1] += a[1];
+        c[2] += a[2];
+    }
+    double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (!(len > CAD_COPLANAR_EPSILON)) return 0;
+    plane[0] = n[0] / len;
+    plane[1] = n[1] / len;
+    plane[2] = n[2] / len;
+    plane[3] = (plane[0] * c[0] + plane[1] * c[1] + plane[2] * c[2]) / count;
+    return 1;
+}
+
+static int merge_plane(const CadFileData* data, const CadIndex* ring, int count, double plane[4]) {
+    double xyz[3 * CAD_MAX_FACE_POINTS];
+    for (int k = 0; k < count; k++) merge_vertex(data, ring[k], &xyz[3 * k]);
+    return newell_plane(xyz, count, plane);
+}
+
+/* Splice ring b into ring a across a's edge i (a[i] -> a[i + 1]), which b
+   walks backwards as its edge j. Returns the merged count in out, or 0 if
+   the result would be too long, repeat a location or not be convex. */
+static int merge_splice(const CadFileData* data, const CadIndex* rep, const double plane[4],
+                        const CadIndex* a, int na, int i, const CadIndex* b, int nb, int j,
+                        CadIndex* out) {
+    int count = na + nb - 2;
+    if (count > CAD_MAX_FACE_POINTS) return 0;
+    
+    int k = 0;
+    for (int t = 0; t <= i; t++) out[k++] = a[t];
+    for (int t = 2; t < nb; t++) out[k++] = b[(j + t) % nb];
+    for (int t = i + 1; t < na; t++) out[k++] = a[t];
+    
+    for (int s = 0; s < count; s++) {
+        for (int t = s + 1; t < count; t++) {
+            if (rep[out[s]] == rep[out[t]]) return 0;
+        }
+    }
+    for (int s = 0; s < count; s++) {
+        double p[3], q[3], r[3];
+        merge_vertex(data, out[(s + count - 1) % count], p);
+        merge_vertex(data, out[s], q);
+        merge_vertex(data, out[(s + 1) % count], r);
+        double e1[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+        double e2[3] = { r[0] - q[0], r[1] - q[1], r[2] - q[2] };
+        double turn = plane[0] * (e1[1] * e2[2] - e1[2] * e2[1]) +
+                      plane[1] * (e1[2] * e2[0] - e1[0] * e2[2]) +
+                      plane[2] * (e1[0] * e2[1] - e1[1] * e2[0]);
+        double scale = sqrt((e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]) *
+                            (e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2]));
+        if (turn < -CAD_COPLANAR_EPSILON * scale) return 0;
+    }
+    return count;
+}
+
+static int merge_compatible(const CadFileData* data, const CadIndex* owner, const double* plane,
+                            CadIndex a, CadIndex b, const CadIndex* ring, int nb) {
+    const CadPolygon* pa = &data->polygons[a];
+    const CadPolygon* pb = &data->polygons[b];
+    if (owner[a] != owner[b] || pa->color != pb->color || pa->side != pb->side ||
+        pa->animation != pb->animation || pa->flags != pb->flags) {
+        return 0;
+    }
+    const double* na = &plane[4 * a];
+    const double* nbv = &plane[4 * b];
+    if (na[0] * nbv[0] + na[1] * nbv[1] + na[2] * nbv[2] <= 0.0) return 0;
+    for (int k = 0; k < nb; k++) {
+        double v[3];
+        merge_vertex(data, ring[k], v);
+        if (fabs(na[0] * v[0] + na[1] * v[1] + na[2] * v[2] - na[3]) > CAD_COPLANAR_EPSILON) return 0;
+    }
+    return 1;
+}
+
+int CadCore_MergePolygons(CadCore* core, int* before, int* after) {
+    if (!core) return -1;
+    if (before) *before = core->live.polygonCount;
+    if (after) *after = core->live.polygonCount;
+    
+    CadFileData* data = &core->data;
+    int np = data->pointCount;
+    int ng = data->polygonCount;
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    int size = 64;
+    while (size < (1 << 28) && size / 2 < (index ? index->vertexCount : 0)) size *= 2;
+    
+    size_t rows = (size_t)(ng > 0 ? ng : 1);
+    CadIndex* rep = (CadIndex*)malloc((size_t)(np > 0 ? np : 1) * sizeof(CadIndex));
+    CadIndex* ring = (CadIndex*)malloc(rows * CAD_MAX_FACE_POINTS * sizeof(CadIndex));
+    uint8_t* count = (uint8_t*)calloc(rows, 1);
+    uint8_t* changed = (uint8_t*)calloc(rows, 1);
+    CadIndex* alias = (CadIndex*)malloc(rows * sizeof(CadIndex));
+    CadIndex* owner = (CadIndex*)malloc(rows * sizeof(CadIndex));
+    double* plane = (double*)malloc(rows * 4 * sizeof(double));
+    MergeEdge* edges = (MergeEdge*)malloc((size_t)size * sizeof(MergeEdge));
+    if (!index || !rep || !ring || !count || !changed || !alias || !owner || !plane || !edges ||
+        !build_grid_representatives(core, rep)) {
+        fprintf(stderr, "Error: Out of memory merging polygons\n");
+        free(rep);
+        free(ring);
+        free(count);
+        free(changed);
+        free(alias);
+        free(owner);
+        free(plane);
+        free(edges);
+        return -1;
+    }
+    
+    /* Group of each polygon, so faces only merge within one object */
+    for (int p = 0; p < ng; p++) {
+        alias[p] = p;
+        owner[p] = INVALID_INDEX;
+    }
+    for (CadIndex o = CadCore_NextLiveObject(core, 0); o >= 0; o = CadCore_NextLiveObject(core, o + 1)) {
+        CadIndex p = data->objects[o].firstPolygon;
+        while (p >= 0 && p < ng && owner[p] == INVALID_INDEX) {
+            owner[p] = o;
+            p = data->polygons[p].nextPolygon;
+        }
+    }
+    
+    /* Candidate rings and the directed edge map, in one pass. Double-sided
+       pairs keep their partner links and are left alone. */
+    uint32_t mask = (uint32_t)size - 1;
+    for (int s = 0; s < size; s++) edges[s].from = INVALID_INDEX;
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        if (data->polygons[p].both >= 0 && data->polygons[p].both < ng) count[data->polygons[p].both] = 0xFF;
+    }
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        const CadIndex* v = &index->vertices[index->offsets[p]];
+        int n = index->offsets[p + 1] - index->offsets[p];
+        if (count[p] == 0xFF || data->polygons[p].both != INVALID_INDEX || n < 3 || n > CAD_MAX_FACE_POINTS ||
+            !merge_plane(data, v, n, &plane[4 * p])) {
+            count[p] = 0;
+            continue;
+        }
+        memcpy(&ring[(size_t)p * CAD_MAX_FACE_POINTS], v, (size_t)n * sizeof(CadIndex));
+        count[p] = (uint8_t)n;
+        for (int k = 0; k < n; k++) {
+            CadIndex from = rep[v[k]];
+            CadIndex to = rep[v[(k + 1) % n]];
+            MergeEdge* e = merge_edge_slot(edges, mask, from, to);
+            if (e->from == INVALID_INDEX) {
+                e->from = from;
+                e->to = to;
+                e->polygon = p;
+            } else {
+                e->polygon = MERGE_EDGE_SHARED;
+            }
+        }
+    }
+    for (int p = 0; p < ng; p++) {
+        if (count[p] == 0xFF) count[p] = 0;
+    }
+    
+    /* Greedy: absorb the face across each edge that walks back the other
+       way, rescanning the grown ring after every merge. Edges of absorbed
+       faces resolve to the survivor through alias. */
+    int merged = 0;
+    for (CadIndex a = 0; a < ng; a++) {
+        CadIndex* ra = &ring[(size_t)a * CAD_MAX_FACE_POINTS];
+        for (int i = 0; count[a] && i < count[a]; i++) {
+            int na = count[a];
+            MergeEdge* e = merge_edge_slot(edges, mask, rep[ra[(i + 1) % na]], rep[ra[i]]);
+            if (e->from == INVALID_INDEX || e->polygon < 0) continue;
+            CadIndex b = merge_root(alias, e->polygon);
+            if (b == a || !count[b]) continue;
+            
+            CadIndex* rb = &ring[(size_t)b * CAD_MAX_FACE_POINTS];
+            int nb = count[b];
+            int j = 0;
+            while (j < nb && rep[rb[j]] != rep[ra[(i + 1) % na]]) j++;
+            if (j == nb || rep[rb[(j + 1) % nb]] != rep[ra[i]]) continue;
+            
+            CadIndex out[CAD_MAX_FACE_POINTS];
+            int n = merge_compatible(data, owner, plane, a, b, rb, nb)
+                  ? merge_splice(data, rep, &plane[4 * a], ra, na, i, rb, nb, j, out) : 0;
+            if (n == 0) continue;
+            memcpy(ra, out, (size_t)n * sizeof(CadIndex));
+            count[a] = (uint8_t)n;
+            count[b] = 0;
+            changed[a] = 1;
+            changed[b] = 2;
+            alias[b] = a;
+            merged++;
+            i = -1;
+        }
+    }
+    if (merged == 0) {
+        free(rep);
+        free(ring);
+        free(count);
+        free(changed);
+        free(alias);
+        free(owner);
+        free(plane);
+        free(edges);
+        return 0;
+    }
+    
+    /* Points of the rewritten faces, which become orphans unless another
+       walk still passes through them; collected before the index goes stale */
+    int staleCount = 0, added = 0;
+    for (int p = 0; p < ng; p++) {
+        if (changed[p]) staleCount += index->offsets[p + 1] - index->offsets[p];
+        if (changed[p] == 1) added += count[p];
+    }
+    CadIndex* stale = (CadIndex*)malloc((size_t)(staleCount > 0 ? staleCount : 1) * sizeof(CadIndex));
+    if (!stale || !CadCore_Reserve(core, 0, 0, data->pointCount + added)) {
+        fprintf(stderr, "Error: Out of memory merging polygons\n");
+        free(stale);
+        free(rep);
+        free(ring);
+        free(count);
+        free(changed);
+        free(alias);
+        free(owner);
+        free(plane);
+        free(edges);
+        return -1;
+    }
+    staleCount = 0;
+    for (int p = 0; p < ng; p++) {
+        if (!changed[p]) continue;
+        for (CadIndex k = index->offsets[p]; k < index->offsets[p + 1]; k++) stale[staleCount++] = index->vertices[k];
+    }
+    
+    /* Survivors get a fresh chain, since their old points may be shared
+       with other walks; the pool was reserved above so AddPoint cannot fail */
+    CadCore_BeginUndoGroup(core);
+    for (CadIndex p = 0; p < ng; p++) {
+        if (changed[p] != 1) continue;
+        const CadIndex* r = &ring[(size_t)p * CAD_MAX_FACE_POINTS];
+        CadIndex head = INVALID_INDEX, tail = INVALID_INDEX;
+        for (int k = 0; k < count[p]; k++) {
+            CadIndex pt = CadCore_AddPoint(core, data->pointX[r[k]], data->pointY[r[k]], data->pointZ[r[k]]);
+            if (tail == INVALID_INDEX) head = pt;
+            else CadCore_SetNextPoint(core, tail, pt);
+            tail = pt;
+        }
+        journal_polygon(core, p);
+        data->polygons[p].firstPoint = head;
+        data->polygons[p].npoints = count[p];
+        mark_topology(&core->changes.polygons, p);
+        adjacency_refresh_polygon(core, p);
+    }
+    for (CadIndex p = 0; p < ng; p++) {
+        if (changed[p] == 2) CadCore_DeletePolygon(core, p);
+    }
+    
+    /* Group chains and object heads skip the absorbed faces */
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        CadIndex next = data->polygons[p].nextPolygon;
+        for (int guard = 0; next >= 0 && next < ng && changed[next] == 2 && guard < ng; guard++) {
+            next = data->polygons[next].nextPolygon;
+        }
+        if (next == data->polygons[p].nextPolygon) continue;
+        journal_polygon(core, p);
+        data->polygons[p].nextPolygon = next;
+        mark_topology(&core->changes.polygons, p);
+    }
+    for (CadIndex o = CadCore_NextLiveObject(core, 0); o >= 0; o = CadCore_NextLiveObject(core, o + 1)) {
+        CadIndex first = data->objects[o].firstPolygon;
+        for (int guard = 0; first >= 0 && first < ng && changed[first] == 2 && guard < ng; guard++) {
+            first = data->polygons[first].nextPolygon;
+        }
+        if (first == data->objects[o].firstPolygon) continue;
+        journal_object(core, o);
+        data->objects[o].firstPolygon = first;
+        mark_topology(&core->changes.objects, o);
+    }
+    
+    for (int k = 0; k < staleCount; k++) {
+        CadIndex i = stale[k];
+        if (CadCore_IsPointValid(core, i) && core->adjacency.pointFirstUse[i] == INVALID_INDEX) {
+            CadCore_DeletePoint(core, i);
+        }
+    }
+    CadCore_EndUndoGroup(core);
+    core->isDirty = 1;
+    if (after) *after = core->live.polygonCount;
+    
+    free(stale);
+    free(rep);
+    free(ring);
+    free(count);
+    free(changed);
+    free(alias);
+    free(owner);
+    free(plane);
+    free(edges);
+    return merged;
+}
+
+/* Pieces of a cut face (Polygon Sort, Face Cut). Every piece gets a fresh
+   chain; the caller reserves the pools first, so these cannot fail. */
+static CadIndex add_piece_chain(CadCore* core, const double* xyz, int count) {
+    CadIndex head = INVALID_INDEX, tail = INVALID_INDEX;
+    for (int v = 0; v < count; v++) {
+        CadIndex pt = CadCore_AddPoint(core, xyz[3 * v], xyz[3 * v + 1], xyz[3 * v + 2]);
+        if (tail == INVALID_INDEX) head = pt;
+        else CadCore_SetNextPoint(core, tail, pt);
+        tail = pt;
+    }
+    return head;
+}
+
+/* The first piece keeps the face's slot; the double-sided pairing no
+   longer holds once the face is cut */
+static void set_first_piece(CadCore* core, CadIndex p, CadIndex head, int count) {
+    CadFileData* data = &core->data;
+    CadIndex both = data->polygons[p].both;
+    if (both >= 0 && both < data->polygonCount && data->polygons[both].both == p) {
+        journal_polygon(core, both);
+        data->polygons[both].both = INVALID_INDEX;
+        mark_geometry(&core->changes.polygons, both);
+    }
+    journal_polygon(core, p);
+    data->polygons[p].firstPoint = head;
+    data->polygons[p].npoints = (uint8_t)count;
+    data->polygons[p].both = INVALID_INDEX;
+    mark_topology(&core->changes.polygons, p);
+    adjacency_refresh_polygon(core, p);
+}
+
+/* Later pieces copy the face's attributes and follow prev (the face or
+   its previous piece) in the group */
+static CadIndex add_next_piece(CadCore* core, CadIndex p, CadIndex prev, CadIndex head, int count) {
+    CadFileData* data = &core->data;
+    CadIndex q = CadCore_AddPolygon(core, head, data->polygons[p].color, (uint8_t)count);
+    journal_polygon(core, prev);
+    data->polygons[q].flags = data->polygons[p].flags;
+    data->polygons[q].side = data->polygons[p].side;
+    data->polygons[q].animation = data->polygons[p].animation;
+    data->polygons[q].nextPolygon = data->polygons[prev].nextPolygon;
+    data->polygons[prev].nextPolygon = q;
+    mark_topology(&core->changes.polygons, prev);
+    return q;
+}
+
+/* Polygon Sort works on fragments: a source polygon and a run of
+   interleaved coordinates in the build's vertex buffer. Fragment lists of
+   pending subtrees live in one growing buffer, and nodes are numbered as
+   their tasks are popped (front subtree first), which yields the pre-order
+   layout directly. */
+#define BSP_CANDIDATES 5         /* Splitter candidates drawn per node */
+#define BSP_SPLIT_COST 8         /* Score of one split against one face of imbalance */
+#define BSP_SEED 0x3D6C1u
+
+enum { BSP_ON = 0, BSP_FRONT = 1, BSP_BACK = 2, BSP_SPANNING = 3 };
+
+typedef struct {
+    CadIndex polygon;            /* Source face */
+    int first;                   /* Run of xyz (vertex index) */
+    int count;
+    int split;                   /* Piece of a split face */
+    int flat;                    /* plane is valid */
+    double plane[4];
+} BspFragment;
+
+typedef struct {
+    int first;                   /* Run of lists */
+    int count;
+    CadIndex parent;             /* Node to link (-1 = root) */
+    int front;                   /* Link as the parent's front child */
+} BspTask;
+
+typedef struct {
+    BspFragment* frags;
+    int fragCount, fragCapacity;
+    double* xyz;
+    int vertexCount, vertexCapacity;
+    int* lists;
+    int listCount, listCapacity;
+    BspTask* tasks;
+    int taskCount, taskCapacity;
+    int* front;
+    int frontCount, frontCapacity;
+    int* back;
+    int backCount, backCapacity;
+    int* nodeFrags;              /* Fragment of each tree face */
+    int nodeFragCount, nodeFragCapacity;
+    CadBspNode* nodes;
+    int nodeCount, nodeCapacity;
+    uint32_t seed;
+    int splits;
+} BspBuild;
+
+static int bsp_reserve(void** array, int* capacity, int need, size_t size) {
+    if (need <= *capacity) return 1;
+    int grown_capacity = *capacity > 0 ? *capacity : 64;
+    while (grown_capacity < need) grown_capacity *= 2;
+    void* grown = realloc(*array, (size_t)grown_capacity * size);
+    if (!grown) return 0;
+    *array = grown;
+    *capacity = grown_capacity;
+    return 1;
+}
+
+static int bsp_push(int** list, int* count, int* capacity, int value) {
+    if (!bsp_reserve((void**)list, capacity, *count + 1, sizeof(int))) return 0;
+    (*list)[(*count)++] = value;
+    return 1;
+}
+
+static void bsp_free(BspBuild* b) {
+    free(b->frags);
+    free(b->xyz);
+    free(b->lists);
+    free(b->tasks);
+    free(b->front);
+    free(b->back);
+    free(b->nodeFrags);
+    free(b->nodes);
+}
+
+/* Append a fragment of count vertices; returns its index or -1 */
+static int bsp_add_fragment(BspBuild* b, CadIndex polygon, const double* xyz, int count, int split,
+                            const double* plane) {
+    if (!bsp_reserve((void**)&b->frags, &b->fragCapacity, b->fragCount + 1, sizeof(BspFragment)) ||
+        !bsp_reserve((void**)&b->xyz, &b->vertexCapacity, b->vertexCount + count, 3 * sizeof(double))) {
+        return -1;
+    }
+    BspFragment* f = &b->frags[b->fragCount];
+    f->polygon = polygon;
+    f->first = b->vertexCount;
+    f->count = count;
+    f->split = split;
+    memcpy(&b->xyz[3 * (size_t)b->vertexCount], xyz, (size_t)count * 3 * sizeof(double));
+    b->vertexCount += count;
+    if (plane) {
+        memcpy(f->plane, plane, sizeof(f->plane));
+        f->flat = 1;
+    } else {
+        f->flat = newell_plane(xyz, count, f->plane);
+    }
+    return b->fragCount++;
+}
+
+static int bsp_side(const double plane[4], const double* v) {
+    double d = plane[0] * v[0] + plane[1] * v[1] + plane[2] * v[2] - plane[3];
+    return d > CAD_COPLANAR_EPSILON ? BSP_FRONT : d < -CAD_COPLANAR_EPSILON ? BSP_BACK : BSP_ON;
+}
+
+static int bsp_classify(const BspBuild* b, int f, const double plane[4]) {
+    const BspFragment* frag = &b->frags[f];
+    int sides = BSP_ON;
+    for (int k = 0; k < frag->count && sides != BSP_SPANNING; k++) {
+        sides |= bsp_side(plane, &b->xyz[3 * (size_t)(frag->first + k)]);
+    }
+    return sides;
+}
+
+/* Queue a split piece, cut along diagonals into runs of at most
+   CAD_MAX_FACE_POINTS vertices (pieces of convex faces stay convex) */
+static int bsp_add_piece(BspBuild* b, int f, const double* xyz, int count, int** list, int* listCount,
+                         int* listCapacity) {
+    CadIndex polygon = b->frags[f].polygon;
+    double plane[4];
+    memcpy(plane, b->frags[f].plane, sizeof(plane));
+    
+    double chunk[3 * CAD_MAX_FACE_POINTS];
+    int start = 1;
+    while (count - start + 1 > CAD_MAX_FACE_POINTS) {
+        memcpy(chunk, xyz, 3 * sizeof(double));
+        memcpy(&chunk[3], &xyz[3 * start], (size_t)(CAD_MAX_FACE_POINTS - 1) * 3 * sizeof(double));
+        int piece = bsp_add_fragment(b, polygon, chunk, CAD_MAX_FACE_POINTS, 1, plane);
+        if (piece < 0 || !bsp_push(list, listCount, listCapacity, piece)) return 0;
+        start += CAD_MAX_FACE_POINTS - 2;
+    }
+    memcpy(chunk, xyz, 3 * sizeof(double));
+    memcpy(&chunk[3], &xyz[3 * start], (size_t)(count - start) * 3 * sizeof(double));
+    int piece = bsp_add_fragment(b, polygon, chunk, count - start + 1, 1, plane);
+    return piece >= 0 && bsp_push(list, listCount, listCapacity, piece);
+}
+
+/* Split a spanning fragment by plane into the front and back lists */
+static int bsp_split(BspBuild* b, int f, const double plane[4]) {
+    double fxyz[3 * (255 + 2)];
+    double bxyz[3 * (255 + 2)];
+    int nf = 0, nb = 0;
+    int count = b->frags[f].count;
+    const double* v = &b->xyz[3 * (size_t)b->frags[f].first];
+    for (int k = 0; k < count; k++) {
+        const double* p = &v[3 * k];
+        const double* q = &v[3 * ((k + 1) % count)];
+        int sp = bsp_side(plane, p);
+        int sq = bsp_side(plane, q);
+        if (sp != BSP_BACK) memcpy(&fxyz[3 * nf++], p, 3 * sizeof(double));
+        if (sp != BSP_FRONT) memcpy(&bxyz[3 * nb++], p, 3 * sizeof(double));
+        if ((sp | sq) == BSP_SPANNING) {
+            double dp = plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] - plane[3];
+            double dq = plane[0] * q[0] + plane[1] * q[1] + plane[2] * q[2] - plane[3];
+            double t = dp / (dp - dq);
+            double x[3] = { p[0] + t * (q[0] - p[0]), p[1] + t * (q[1] - p[1]), p[2] + t * (q[2] - p[2]) };
+            memcpy(&fxyz[3 * nf++], x, sizeof(x));
+            memcpy(&bxyz[3 * nb++], x, sizeof(x));
+        }
+    }
+    b->splits++;
+    return bsp_add_piece(b, f, fxyz, nf, &b->front, &b->frontCount, &b->frontCapacity) &&
+           bsp_add_piece(b, f, bxyz, nb, &b->back, &b->backCount, &b->backCapacity);
+}
+
+static uint32_t bsp_random(BspBuild* b) {
+    b->seed = b->seed * 1664525u + 1013904223u;
+    return b->seed >> 8;
+}
+
+/* Flat fragment of the task with the lowest split/imbalance score among a
+   few random draws, or -1 if it has none */
+static int bsp_choose_splitter(BspBuild* b, const BspTask* t) {
+    int best = -1;
+    long bestScore = 0;
+    for (int c = 0; c < BSP_CANDIDATES; c++) {
+        int pick = b->lists[t->first + (int)(bsp_random(b) % (uint32_t)t->count)];
+        if (!b->frags[pick].flat || pick == best) continue;
+        long fronts = 0, backs = 0, spans = 0;
+        for (int k = 0; k < t->count; k++) {
+            int cls = bsp_classify(b, b->lists[t->first + k], b->frags[pick].plane);
+            if (cls == BSP_FRONT) fronts++;
+            else if (cls == BSP_BACK) backs++;
+            else if (cls == BSP_SPANNING) spans++;
+        }
+        long score = spans * BSP_SPLIT_COST + labs(fronts - backs);
+        if (best < 0 || score < bestScore) {
+            best = pick;
+            bestScore = score;
+        }
+    }
+    for (int k = 0; best < 0 && k < t->count; k++) {
+        if (b->frags[b->lists[t->first + k]].flat) best = b->lists[t->first + k];
+    }
+    return best;
+}
+
+/* Queue a child task over the given fragments */
+static int bsp_push_task(BspBuild* b, const int* frags, int count, CadIndex parent, int front) {
+    if (count == 0) return 1;
+    if (!bsp_reserve((void**)&b->lists, &b->listCapacity, b->listCount + count, sizeof(int)) ||
+        !bsp_reserve((void**)&b->tasks, &b->taskCapacity, b->taskCount + 1, sizeof(BspTask))) {
+        return 0;
+    }
+    memcpy(&b->lists[b->listCount], frags, (size_t)count * sizeof(int));
+    BspTask* t = &b->tasks[b->taskCount++];
+    t->first = b->listCount;
+    t->count = count;
+    t->parent = parent;
+    t->front = front;
+    b->listCount += count;
+    return 1;
+}
+
+static int bsp_build(BspBuild* b) {
+    while (b->taskCount > 0) {
+        BspTask t = b->tasks[--b->taskCount];
+        int splitter = bsp_choose_splitter(b, &t);
+        if (!bsp_reserve((void**)&b->nodes, &b->nodeCapacity, b->nodeCount + 1, sizeof(CadBspNode))) return 0;
+        CadIndex n = (CadIndex)b->nodeCount++;
+        CadBspNode* node = &b->nodes[n];
+        memset(node->plane, 0, sizeof(node->plane));
+        if (splitter >= 0) memcpy(node->plane, b->frags[splitter].plane, sizeof(node->plane));
+        node->front = node->back = INVALID_INDEX;
+        node->firstFace = b->nodeFragCount;
+        if (t.parent >= 0) {
+            if (t.front) b->nodes[t.parent].front = n;
+            else b->nodes[t.parent].back = n;
+        }
+        
+        /* Faces in the plane stay here, and so do faces without a plane
+           that straddle it; the rest go to the children */
+        double plane[4];
+        memcpy(plane, node->plane, sizeof(plane));
+        b->frontCount = b->backCount = 0;
+        for (int k = 0; k < t.count; k++) {
+            int f = b->lists[t.first + k];
+            int cls = splitter < 0 || f == splitter ? BSP_ON : bsp_classify(b, f, plane);
+            int ok;
+            if (cls == BSP_FRONT) ok = bsp_push(&b->front, &b->frontCount, &b->frontCapacity, f);
+            else if (cls == BSP_BACK) ok = bsp_push(&b->back, &b->backCount, &b->backCapacity, f);
+            else if (cls == BSP_SPANNING && b->frags[f].flat) ok = bsp_split(b, f, plane);
+            else ok = bsp_push(&b->nodeFrags, &b->nodeFragCount, &b->nodeFragCapacity, f);
+            if (!ok) return 0;
+        }
+        b->nodes[n].faceCount = b->nodeFragCount - b->nodes[n].firstFace;
+        if (!bsp_push_task(b, b->back, b->backCount, n, 0) ||
+            !bsp_push_task(b, b->front, b->frontCount, n, 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int CadCore_SortPolygons(CadCore* core) {
+    if (!core) return -1;
+    
+    CadFileData* data = &core->data;
+    int ng = data->polygonCount;
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    BspBuild b;
+    memset(&b, 0, sizeof(b));
+    b.seed = BSP_SEED;
+    if (!index) return -1;
+    
+    /* One fragment per live face, all in the root task */
+    int ok = 1;
+    double xyz[3 * 255];
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); ok && p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        int count = index->offsets[p + 1] - index->offsets[p];
+        if (count == 0) continue;
+        for (int k = 0; k < count; k++) merge_vertex(data, index->vertices[index->offsets[p] + k], &xyz[3 * k]);
+        int f = bsp_add_fragment(&b, p, xyz, count, 0, NULL);
+        ok = f >= 0 && bsp_push(&b.front, &b.frontCount, &b.frontCapacity, f);
+    }
+    ok = ok && bsp_push_task(&b, b.front, b.frontCount, INVALID_INDEX, 0) && bsp_build(&b);
+    
+    /* Pieces beyond each split face's first need new polygon slots, and
+       every piece a fresh chain */
+    int addedPolygons = 0, addedPoints = 0, staleCount = 0;
+    uint8_t* claimed = (uint8_t*)calloc((size_t)(ng > 0 ? ng : 1), 1);
+    CadIndex* last = (CadIndex*)malloc((size_t)(ng > 0 ? ng : 1) * sizeof(CadIndex));
+    CadIndex* faces = (CadIndex*)malloc((size_t)(b.nodeFragCount > 0 ? b.nodeFragCount : 1) * sizeof(CadIndex));
+    CadIndex* stale = NULL;
+    ok = ok && claimed && last && faces;
+    for (int k = 0; ok && k < b.nodeFragCount; k++) {
+        const BspFragment* f = &b.frags[b.nodeFrags[k]];
+        if (!f->split) continue;
+        addedPoints += f->count;
+        if (claimed[f->polygon]) {
+            addedPolygons++;
+            continue;
+        }
+        claimed[f->polygon] = 1;
+        staleCount += index->offsets[f->polygon + 1] - index->offsets[f->polygon];
+    }
+    if (ok) {
+        stale = (CadIndex*)malloc((size_t)(staleCount > 0 ? staleCount : 1) * sizeof(CadIndex));
+        ok = stale && CadCore_Reserve(core, 0, data->polygonCount + addedPolygons, data->pointCount + addedPoints);
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Out of memory sorting polygons\n");
+        bsp_free(&b);
+        free(claimed);
+        free(last);
+        free(faces);
+        free(stale);
+        return -1;
+    }
+    staleCount = 0;
+    for (CadIndex p = 0; p < ng; p++) {
+        if (!claimed[p]) continue;
+        for (CadIndex k = index->offsets[p]; k < index->offsets[p + 1]; k++) stale[staleCount++] = index->vertices[k];
+        claimed[p] = 0;
+    }
     
-    CadPolygon* poly = &core->data.polygons[polygonIndex];
+    CadCore_BeginUndoGroup(core);
+    for (int k = 0; k < b.nodeFragCount; k++) {
+        const BspFragment* f = &b.frags[b.nodeFrags[k]];
+        if (!f->split) {
+            faces[k] = f->polygon;
+            continue;
+        }
+        CadIndex head = add_piece_chain(core, &b.xyz[3 * (size_t)f->first], f->count);
+        CadIndex p = f->polygon;
+        if (!claimed[p]) {
+            claimed[p] = 1;
+            last[p] = p;
+            set_first_piece(core, p, head, f->count);
+            faces[k] = p;
+            continue;
+        }
+        last[p] = add_next_piece(core, p, last[p], head, f->count);
+        faces[k] = last[p];
+    }
+    for (int k = 0; k < staleCount; k++) {
+        CadIndex i = stale[k];
+        if (CadCore_IsPointValid(core, i) && core->adjacency.pointFirstUse[i] == INVALID_INDEX) {
+            CadCore_DeletePoint(core, i);
+        }
+    }
+    CadCore_EndUndoGroup(core);
+    if (b.splits > 0) core->isDirty = 1;
     
-    /* Check minimum vertex count */
-    if (poly->npoints < 2) return 0;
+    /* Keep the arrays as the core's tree */
+    CadBspTree* tree = &core->bsp;
+    free(tree->nodes);
+    free(tree->faces);
+    tree->nodes = b.nodes;
+    tree->nodeCount = b.nodeCount;
+    tree->nodeCapacity = b.nodeCapacity;
+    tree->faces = faces;
+    tree->faceCount = b.nodeFragCount;
+    tree->faceCapacity = b.nodeFragCount > 0 ? b.nodeFragCount : 1;
+    tree->pointGeometry = core->changes.points.geometry;
+    tree->polygonGeometry = core->changes.polygons.geometry;
+    tree->polygonTopology = core->changes.polygons.topology;
+    b.nodes = NULL;
     
-    /* Verify all points in chain are valid */
-    int16_t current = poly->firstPoint;
-    int count = 0;
-    while (current != INVALID_INDEX && count < poly->npoints) {
-        if (!CadCore_IsPointValid(core, current)) return 0;
-        current = core->data.points[current].nextPoint;
-        count++;
+    int splits = b.splits;
+    bsp_free(&b);
+    free(claimed);
+    free(last);
+    free(stale);
+    return splits;
+}
+
+const CadBspTree* CadCore_GetBspTree(const CadCore* core) {
+    if (!core) return NULL;
+    const CadBspTree* tree = &core->bsp;
+    if (tree->pointGeometry == 0 || tree->pointGeometry != core->changes.points.geometry ||
+        tree->polygonGeometry != core->changes.polygons.geometry ||
+        tree->polygonTopology != core->changes.polygons.topology) {
+        return NULL;
     }
-    
-    /* Check if we got the expected number of points */
-    return count == poly->npoints;
+    return tree;
 }
 
-int CadCore_ValidatePoint(CadCore* core, int16_t pointIndex) {
-    if (!core || !CadCore_IsPointValid(core, pointIndex)) return 0;
-    return 1; /* Point is valid if it exists */
+int CadCore_GetBackToFrontOrder(const CadCore* core, double ex, double ey, double ez,
+                                CadIndex* out, int maxCount) {
+    const CadBspTree* tree = CadCore_GetBspTree(core);
+    if (!tree || !out) return -1;
+    if (tree->nodeCount == 0) return 0;
+    
+    /* Each node is pushed once to visit and once (as ~node) to emit */
+    CadIndex* stack = (CadIndex*)malloc((size_t)tree->nodeCount * 2 * sizeof(CadIndex));
+    if (!stack) {
+        fprintf(stderr, "Error: Out of memory ordering polygons\n");
+        return -1;
+    }
+    int depth = 0, written = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        CadIndex n = stack[--depth];
+        if (n < 0) {
+            const CadBspNode* node = &tree->nodes[~n];
+            for (int k = 0; k < node->faceCount && written < maxCount; k++) {
+                out[written++] = tree->faces[node->firstFace + k];
+            }
+            continue;
+        }
+        
+        /* Far side first, then the node's own faces, then the near side */
+        const CadBspNode* node = &tree->nodes[n];
+        double side = node->plane[0] * ex + node->plane[1] * ey + node->plane[2] * ez - node->plane[3];
+        CadIndex nearChild = side >= 0.0 ? node->front : node->back;
+        CadIndex farChild = side >= 0.0 ? node->back : node->front;
+        if (nearChild >= 0) stack[depth++] = nearChild;
+        stack[depth++] = ~n;
+        if (farChild >= 0) stack[depth++] = farChild;
+    }
+    free(stack);
+    return written;
 }
 
 /* ----------------------------------------------------------------------------
-   Statistics
+   Flat check
+   Stale cache entries are recomputed in parallel across polygons (OpenMP
+   where the build enables it); each walk is copied into structure-of-arrays
+   scratch with its first vertex repeated, so the Newell sums and plane
+   distances run two vertices per SSE2 step.
    ---------------------------------------------------------------------------- */
+#define FLAT_PARALLEL_MIN 512    /* Stale polygons worth starting threads for */
 
-int CadCore_GetActivePointCount(CadCore* core) {
-    if (!core) return 0;
+/* Unit Newell normal of a walk into n (0 if degenerate) and the largest
+   vertex distance from the plane through its centroid */
+static double flat_deviation(const double* x, const double* y, const double* z, int count, double n[3]) {
+    double nx = 0.0, ny = 0.0, nz = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+    int k = 0;
+#ifdef CAD_HAVE_SSE2
+    {
+        __m128d snx = _mm_setzero_pd(), sny = _mm_setzero_pd(), snz = _mm_setzero_pd();
+        __m128d scx = _mm_setzero_pd(), scy = _mm_setzero_pd(), scz = _mm_setzero_pd();
+        for (; k + 2 <= count; k += 2) {
+            __m128d x0 = _mm_loadu_pd(x + k), x1 = _mm_loadu_pd(x + k + 1);
+            __m128d y0 = _mm_loadu_pd(y + k), y1 = _mm_loadu_pd(y + k + 1);
+            __m128d z0 = _mm_loadu_pd(z + k), z1 = _mm_loadu_pd(z + k + 1);
+            snx = _mm_add_pd(snx, _mm_mul_pd(_mm_sub_pd(y0, y1), _mm_add_pd(z0, z1)));
+            sny = _mm_add_pd(sny, _mm_mul_pd(_mm_sub_pd(z0, z1), _mm_add_pd(x0, x1)));
+            snz = _mm_add_pd(snz, _mm_mul_pd(_mm_sub_pd(x0, x1), _mm_add_pd(y0, y1)));
+            scx = _mm_add_pd(scx, x0);
+            scy = _mm_add_pd(scy, y0);
+            scz = _mm_add_pd(scz, z0);
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, snx); nx = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, sny); ny = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, snz); nz = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, scx); cx = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, scy); cy = lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, scz); cz = lanes[0] + lanes[1];
+    }
+#endif
+    for (; k < count; k++) {
+        nx += (y[k] - y[k + 1]) * (z[k] + z[k + 1]);
+        ny += (z[k] - z[k + 1]) * (x[k] + x[k + 1]);
+        nz += (x[k] - x[k + 1]) * (y[k] + y[k + 1]);
+        cx += x[k];
+        cy += y[k];
+        cz += z[k];
+    }
     
-    int count = 0;
-    for (int i = 0; i < core->data.pointCount; i++) {
-        if (CadCore_IsPointValid(core, i)) count++;
+    double len = sqrt(nx * nx + ny * ny + nz * nz);
+    if (!(len > 0.0)) {
+        n[0] = n[1] = n[2] = 0.0;
+        return 0.0;
     }
-    return count;
+    n[0] = nx / len;
+    n[1] = ny / len;
+    n[2] = nz / len;
+    double d = (n[0] * cx + n[1] * cy + n[2] * cz) / count;
+    
+    double deviation = 0.0;
+    k = 0;
+#ifdef CAD_HAVE_SSE2
+    {
+        const __m128d sign = _mm_set1_pd(-0.0);
+        __m128d vn0 = _mm_set1_pd(n[0]), vn1 = _mm_set1_pd(n[1]), vn2 = _mm_set1_pd(n[2]);
+        __m128d vd = _mm_set1_pd(d);
+        __m128d worst = _mm_setzero_pd();
+        for (; k + 2 <= count; k += 2) {
+            __m128d dist = _mm_add_pd(_mm_add_pd(_mm_mul_pd(vn0, _mm_loadu_pd(x + k)),
+                                                 _mm_mul_pd(vn1, _mm_loadu_pd(y + k))),
+                                      _mm_mul_pd(vn2, _mm_loadu_pd(z + k)));
+            worst = _mm_max_pd(worst, _mm_andnot_pd(sign, _mm_sub_pd(dist, vd)));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, worst);
+        deviation = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+#endif
+    for (; k < count; k++) {
+        double dist = fabs(n[0] * x[k] + n[1] * y[k] + n[2] * z[k] - d);
+        if (dist > deviation) deviation = dist;
+    }
+    return deviation;
 }
 
-int CadCore_GetActivePolygonCount(CadCore* core) {
-    if (!core) return 0;
+int CadCore_FlatCheck(CadCore* core, double tolerance, CadIndex* out, int maxCount) {
+    if (!core) return -1;
     
-    int count = 0;
-    for (int i = 0; i < core->data.polygonCount; i++) {
-        if (CadCore_IsPolygonValid(core, i)) count++;
+    const CadFileData* data = &core->data;
+    CadFlatCache* cache = &core->flatCache;
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    int ng = data->polygonCount;
+    CadIndex* stale = (CadIndex*)malloc((size_t)(ng > 0 ? ng : 1) * sizeof(CadIndex));
+    if (!index || !stale) {
+        fprintf(stderr, "Error: Out of memory checking flatness\n");
+        free(stale);
+        return -1;
     }
-    return count;
+    
+    int staleCount = 0;
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        if (!((cache->current[p >> 6] >> (p & 63)) & 1)) stale[staleCount++] = p;
+    }
+    
+    /* Each iteration writes only its own polygon's entries */
+    #pragma omp parallel for schedule(dynamic, 64) if (staleCount >= FLAT_PARALLEL_MIN)
+    for (int s = 0; s < staleCount; s++) {
+        CadIndex p = stale[s];
+        const CadIndex* v = &index->vertices[index->offsets[p]];
+        int count = index->offsets[p + 1] - index->offsets[p];
+        if (count < 3) {
+            cache->deviation[p] = -1.0;
+            cache->normal[3 * p] = cache->normal[3 * p + 1] = cache->normal[3 * p + 2] = 0.0;
+            continue;
+        }
+        double x[256], y[256], z[256];
+        for (int k = 0; k < count; k++) {
+            x[k] = data->pointX[v[k]];
+            y[k] = data->pointY[v[k]];
+            z[k] = data->pointZ[v[k]];
+        }
+        x[count] = x[0];
+        y[count] = y[0];
+        z[count] = z[0];
+        cache->deviation[p] = flat_deviation(x, y, z, count, &cache->normal[3 * p]);
+    }
+    for (int s = 0; s < staleCount; s++) set_bit(cache->current, stale[s]);
+    free(stale);
+    
+    int found = 0;
+    for (CadIndex p = CadCore_NextLivePolygon(core, 0); p >= 0; p = CadCore_NextLivePolygon(core, p + 1)) {
+        if (index->offsets[p + 1] - index->offsets[p] < 4 || !(cache->deviation[p] > tolerance)) continue;
+        if (out && found < maxCount) out[found] = p;
+        found++;
+    }
+    return found;
 }
 
-int CadCore_GetActiveObjectCount(CadCore* core) {
-    if (!core) return 0;
-    
-    int count = 0;
-    for (int i = 0; i < core->data.objectCount; i++) {
-        if (CadCore_IsObjectValid(core, i)) count++;
+double CadCore_GetPolygonDeviation(const CadCore* core, CadIndex polygonIndex) {
+    if (!core || polygonIndex < 0 || polygonIndex >= core->data.polygonCount) return -1.0;
+    const CadFlatCache* cache = &core->flatCache;
+    if (core->data.polygons[polygonIndex].flags == 0 ||
+        !((cache->current[polygonIndex >> 6] >> (polygonIndex & 63)) & 1)) {
+        return -1.0;
     }
-    return count;
+    return cache->deviation[polygonIndex];
 }
 
 /* ----------------------------------------------------------------------------
-   Merge detection
+   Transform
+   Points are gathered in blocks into structure-of-arrays scratch, run
+   through the matrix two at a time with SSE2 and scattered back, so the
+   per-point work outside the kernel is only the undo record and the
+   change hooks.
    ---------------------------------------------------------------------------- */
+#define TRANSFORM_BLOCK 256
 
-/* Convert coordinate to integer (round half up) - matches original Convert() function */
-int CadCore_ConvertCoordinate(double coord) {
-    double fractional;
-    double integer;
-    fractional = coord - (integer = (double)(int)coord);
+void CadCore_MatrixTranslate(double m[12], double dx, double dy, double dz) {
+    static const double identity[12] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0 };
+    memcpy(m, identity, sizeof(identity));
+    m[3] = dx;
+    m[7] = dy;
+    m[11] = dz;
+}
+
+void CadCore_MatrixRotate(double m[12], int axis, double angle, double cx, double cy, double cz) {
+    double c = cos(angle), s = sin(angle);
+    CadCore_MatrixTranslate(m, 0.0, 0.0, 0.0);
     
-    if (coord >= 0.0) {
-        if (fractional >= 0.5) integer += 1.0;
-    } else {
-        if (fractional <= -0.5) integer -= 1.0;
-    }
+    /* Rotate the two coordinates other than the axis, in cyclic order */
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    m[4 * u + u] = c;
+    m[4 * u + v] = -s;
+    m[4 * v + u] = s;
+    m[4 * v + v] = c;
     
-    return (int)integer;
+    /* Keep the pivot fixed: t = pivot - R * pivot */
+    double pivot[3] = { cx, cy, cz };
+    for (int r = 0; r < 3; r++) {
+        m[4 * r + 3] = pivot[r] - (m[4 * r] * cx + m[4 * r + 1] * cy + m[4 * r + 2] * cz);
+    }
 }
 
-static int convert_coordinate(double coord) {
-    return CadCore_ConvertCoordinate(coord);
+void CadCore_MatrixScale(double m[12], double factor, double cx, double cy, double cz) {
+    CadCore_MatrixTranslate(m, cx * (1.0 - factor), cy * (1.0 - factor), cz * (1.0 - factor));
+    m[0] = m[5] = m[10] = factor;
 }
 
-/* Check if coordinates are merged (all coordinates are integers) */
-int CadCore_AreCoordinatesMerged(CadCore* core) {
+int CadCore_CollectSelectionPoints(CadCore* core, int polygons, CadIndex* out, int maxCount) {
     if (!core) return 0;
     
-    /* Check all valid points */
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        CadPoint* pt = &core->data.points[i];
-        if (pt->flags == 0) continue; /* Skip invalid points */
-        
-        /* Check if coordinates are integers (within epsilon) */
-        double x = pt->pointx;
-        double y = pt->pointy;
-        double z = pt->pointz;
-        
-        /* Convert and check if result matches original (within small epsilon) */
-        int conv_x = convert_coordinate(x);
-        int conv_y = convert_coordinate(y);
-        int conv_z = convert_coordinate(z);
-        
-        const double epsilon = 1e-9;
-        if (fabs(x - (double)conv_x) > epsilon ||
-            fabs(y - (double)conv_y) > epsilon ||
-            fabs(z - (double)conv_z) > epsilon) {
-            return 0; /* Found non-integer coordinate */
+    const CadSelection* sel = &core->selection;
+    int found = 0;
+    if (!polygons) {
+        for (int i = 0; i < sel->pointCount; i++) {
+            CadIndex p = sel->selectedPoints[i];
+            if (!CadCore_IsPointValid(core, p)) continue;
+            if (out && found < maxCount) out[found] = p;
+            found++;
         }
+        return found;
     }
     
-    /* Also check object offsets */
-    for (int i = 0; i < core->data.objectCount && i < CAD_MAX_OBJECTS; i++) {
-        CadObject* obj = &core->data.objects[i];
-        if (obj->flags == 0) continue; /* Skip invalid objects */
-        
-        double ox = obj->offsetx;
-        double oy = obj->offsety;
-        double oz = obj->offsetz;
+    /* Faces share corners; a visited bit keeps each point once */
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    uint64_t* seen = (uint64_t*)calloc((size_t)BIT_WORDS(core->data.pointCount) + 1, sizeof(uint64_t));
+    if (!index || !seen) {
+        fprintf(stderr, "Error: Out of memory collecting selected points\n");
+        free(seen);
+        return -1;
+    }
+    for (int i = 0; i < sel->polygonCount; i++) {
+        CadIndex g = sel->selectedPolygons[i];
+        if (!CadCore_IsPolygonValid(core, g)) continue;
+        for (int k = index->offsets[g]; k < index->offsets[g + 1]; k++) {
+            CadIndex p = index->vertices[k];
+            if (test_bit(seen, p)) continue;
+            set_bit(seen, p);
+            if (out && found < maxCount) out[found] = p;
+            found++;
+        }
+    }
+    free(seen);
+    return found;
+}
+
+int CadCore_TransformPoints(CadCore* core, const CadIndex* points, int count, const double m[12]) {
+    if (!core || !points || !m) return 0;
+    
+    CadFileData* data = &core->data;
+    int moved = 0;
+    CadCore_BeginUndoGroup(core);
+    
+    for (int first = 0; first < count; first += TRANSFORM_BLOCK) {
+        int end = first + TRANSFORM_BLOCK < count ? first + TRANSFORM_BLOCK : count;
+        CadIndex idx[TRANSFORM_BLOCK];
+        double x[TRANSFORM_BLOCK], y[TRANSFORM_BLOCK], z[TRANSFORM_BLOCK];
+        int n = 0;
+        for (int i = first; i < end; i++) {
+            CadIndex p = points[i];
+            if (!CadCore_IsPointValid(core, p)) continue;
+            journal_point(core, p);
+            idx[n] = p;
+            x[n] = data->pointX[p];
+            y[n] = data->pointY[p];
+            z[n] = data->pointZ[p];
+            n++;
+        }
         
-        int conv_ox = convert_coordinate(ox);
-        int conv_oy = convert_coordinate(oy);
-        int conv_oz = convert_coordinate(oz);
+        int k = 0;
+#ifdef CAD_HAVE_SSE2
+        {
+            const __m128d m0 = _mm_set1_pd(m[0]), m1 = _mm_set1_pd(m[1]), m2 = _mm_set1_pd(m[2]), m3 = _mm_set1_pd(m[3]);
+            const __m128d m4 = _mm_set1_pd(m[4]), m5 = _mm_set1_pd(m[5]), m6 = _mm_set1_pd(m[6]), m7 = _mm_set1_pd(m[7]);
+            const __m128d m8 = _mm_set1_pd(m[8]), m9 = _mm_set1_pd(m[9]), m10 = _mm_set1_pd(m[10]), m11 = _mm_set1_pd(m[11]);
+            for (; k + 2 <= n; k += 2) {
+                __m128d vx = _mm_loadu_pd(x + k), vy = _mm_loadu_pd(y + k), vz = _mm_loadu_pd(z + k);
+                _mm_storeu_pd(x + k, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m0, vx), _mm_mul_pd(m1, vy)),
+                                                _mm_add_pd(_mm_mul_pd(m2, vz), m3)));
+                _mm_storeu_pd(y + k, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m4, vx), _mm_mul_pd(m5, vy)),
+                                                _mm_add_pd(_mm_mul_pd(m6, vz), m7)));
+                _mm_storeu_pd(z + k, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m8, vx), _mm_mul_pd(m9, vy)),
+                                                _mm_add_pd(_mm_mul_pd(m10, vz), m11)));
+            }
+        }
+#endif
+        for (; k < n; k++) {
+            double px = x[k], py = y[k], pz = z[k];
+            x[k] = (m[0] * px + m[1] * py) + (m[2] * pz + m[3]);
+            y[k] = (m[4] * px + m[5] * py) + (m[6] * pz + m[7]);
+            z[k] = (m[8] * px + m[9] * py) + (m[10] * pz + m[11]);
+        }
         
-        const double epsilon = 1e-9;
-        if (fabs(ox - (double)conv_ox) > epsilon ||
-            fabs(oy - (double)conv_oy) > epsilon ||
-            fabs(oz - (double)conv_oz) > epsilon) {
-            return 0; /* Found non-integer offset */
+        for (k = 0; k < n; k++) {
+            CadIndex p = idx[k];
+            data->pointX[p] = x[k];
+            data->pointY[p] = y[k];
+            data->pointZ[p] = z[k];
+            point_changed(core, p);
+            mark_geometry(&core->changes.points, p);
         }
+        moved += n;
     }
     
-    return 1; /* All coordinates are integers */
+    CadCore_EndUndoGroup(core);
+    if (moved) core->isDirty = 1;
+    return moved;
 }
 
-/* Check if points are merged (no duplicate points at same grid location) */
-int CadCore_ArePointsMerged(CadCore* core) {
-    if (!core) return 0;
+int CadCore_TransformSelection(CadCore* core, int polygons, const double m[12]) {
+    if (!core || !m) return 0;
     
-    /* For each polygon, check for consecutive duplicate points */
-    for (int poly_idx = 0; poly_idx < core->data.polygonCount && poly_idx < CAD_MAX_POLYGONS; poly_idx++) {
-        CadPolygon* poly = &core->data.polygons[poly_idx];
-        if (poly->flags == 0) continue; /* Skip invalid polygons */
-        
-        int16_t point = poly->firstPoint;
-        if (point == INVALID_INDEX) continue;
-        
-        int count = poly->npoints;
-        int16_t visited[64];
-        int visited_count = 0;
-        
-        /* Declare variables for point traversal */
-        int16_t current;
-        int checked;
-        
-        /* Check first point against last point (closed polygon check) */
-        if (count > 1) {
-            int16_t first_point = poly->firstPoint;
-            int16_t last_point = point;
-            
-            /* Find last point */
-            current = point;
-            checked = 0;
-            while (current != INVALID_INDEX && current < CAD_MAX_POINTS && checked < count) {
-                CadPoint* pt = &core->data.points[current];
-                if (pt->flags == 0) break;
-                last_point = current;
-                current = pt->nextPoint;
-                checked++;
-            }
-            
-            if (first_point != INVALID_INDEX && last_point != INVALID_INDEX &&
-                first_point < CAD_MAX_POINTS && last_point < CAD_MAX_POINTS) {
-                CadPoint* first_pt = &core->data.points[first_point];
-                CadPoint* last_pt = &core->data.points[last_point];
-                
-                if (first_pt->flags != 0 && last_pt->flags != 0) {
-                    int first_x = convert_coordinate(first_pt->pointx);
-                    int first_y = convert_coordinate(first_pt->pointy);
-                    int first_z = convert_coordinate(first_pt->pointz);
-                    int last_x = convert_coordinate(last_pt->pointx);
-                    int last_y = convert_coordinate(last_pt->pointy);
-                    int last_z = convert_coordinate(last_pt->pointz);
-                    
-                    if (first_x == last_x && first_y == last_y && first_z == last_z) {
-                        return 0; /* Found duplicate: first and last point are same */
-                    }
+    int count = CadCore_CollectSelectionPoints(core, polygons, NULL, 0);
+    if (count <= 0) return count;
+    CadIndex* points = (CadIndex*)malloc((size_t)count * sizeof(CadIndex));
+    if (!points) {
+        fprintf(stderr, "Error: Out of memory transforming selection\n");
+        return -1;
+    }
+    count = CadCore_CollectSelectionPoints(core, polygons, points, count);
+    int moved = count < 0 ? -1 : CadCore_TransformPoints(core, points, count, m);
+    free(points);
+    return moved;
+}
+
+/* Winding reversal is planned before anything is written: the walks are
+   copied out (the polygon index goes stale with the first relink), faces
+   sharing points with other walks are flagged for a fresh chain and the
+   point pool is reserved for those, so applying the plan cannot fail. The
+   list is copied too: it may be the selection, which reserving can move. */
+typedef struct {
+    CadIndex* polygons;          /* Listed polygons */
+    CadIndex* walk;              /* Walks of the listed polygons, back to back */
+    int* start;                  /* Run of walk per listed polygon (count + 1) */
+    uint8_t* shared;             /* Listed polygon needs a fresh chain */
+    int freshPoints;             /* Points the fresh chains take */
+} ReversePlan;
+
+static void reverse_free(ReversePlan* plan) {
+    free(plan->polygons);
+    free(plan->walk);
+    free(plan->start);
+    free(plan->shared);
+}
+
+static int reverse_plan(CadCore* core, const CadIndex* polygons, int count, ReversePlan* plan) {
+    memset(plan, 0, sizeof(*plan));
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    if (!index) return 0;
+    
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        CadIndex g = polygons[i];
+        if (CadCore_IsPolygonValid(core, g)) total += index->offsets[g + 1] - index->offsets[g];
+    }
+    plan->polygons = (CadIndex*)malloc((size_t)(count > 0 ? count : 1) * sizeof(CadIndex));
+    plan->walk = (CadIndex*)malloc((size_t)(total > 0 ? total : 1) * sizeof(CadIndex));
+    plan->start = (int*)malloc((size_t)(count + 1) * sizeof(int));
+    plan->shared = (uint8_t*)calloc((size_t)(count > 0 ? count : 1), 1);
+    if (!plan->polygons || !plan->walk || !plan->start || !plan->shared) {
+        reverse_free(plan);
+        return 0;
+    }
+    memcpy(plan->polygons, polygons, (size_t)count * sizeof(CadIndex));
+    
+    const CadAdjacency* adj = &core->adjacency;
+    int used = 0;
+    for (int i = 0; i < count; i++) {
+        CadIndex g = polygons[i];
+        plan->start[i] = used;
+        if (!CadCore_IsPolygonValid(core, g)) continue;
+        int n = index->offsets[g + 1] - index->offsets[g];
+        if (n < 2) continue;
+        memcpy(&plan->walk[used], &index->vertices[index->offsets[g]], (size_t)n * sizeof(CadIndex));
+        for (int k = 0; k < n && !plan->shared[i]; k++) {
+            for (CadIndex u = adj->pointFirstUse[plan->walk[used + k]]; u != INVALID_INDEX; u = adj->nodes[u].nextInPoint) {
+                if (adj->nodes[u].polygon != g) {
+                    plan->shared[i] = 1;
+                    plan->freshPoints += n;
+                    break;
                 }
             }
         }
+        used += n;
+    }
+    plan->start[count] = used;
+    
+    if (plan->freshPoints && !CadCore_Reserve(core, 0, 0, core->data.pointCount + plan->freshPoints)) {
+        reverse_free(plan);
+        return 0;
+    }
+    return 1;
+}
+
+/* Runs inside the caller's undo group; fresh chains copy the coordinates
+   current at this point */
+static int reverse_apply(CadCore* core, int count, const ReversePlan* plan) {
+    CadFileData* data = &core->data;
+    int reversed = 0;
+    
+    for (int i = 0; i < count; i++) {
+        const CadIndex* v = &plan->walk[plan->start[i]];
+        int n = plan->start[i + 1] - plan->start[i];
+        if (n < 2) continue;
         
-        /* Check consecutive points in polygon */
-        current = point;
-        int16_t prev_point = INVALID_INDEX;
-        checked = 0;
+        CadIndex head;
+        if (!plan->shared[i]) {
+            /* Only this face walks these points: point each one back at its
+               predecessor and start from the old last vertex */
+            for (int k = 0; k < n; k++) {
+                journal_point(core, v[k]);
+                data->points[v[k]].nextPoint = k > 0 ? v[k - 1] : INVALID_INDEX;
+                mark_topology(&core->changes.points, v[k]);
+            }
+            head = v[n - 1];
+        } else {
+            CadIndex tail = INVALID_INDEX;
+            head = INVALID_INDEX;
+            for (int k = n - 1; k >= 0; k--) {
+                CadIndex pt = CadCore_AddPoint(core, data->pointX[v[k]], data->pointY[v[k]], data->pointZ[v[k]]);
+                if (tail == INVALID_INDEX) head = pt;
+                else CadCore_SetNextPoint(core, tail, pt);
+                tail = pt;
+            }
+        }
         
-        while (current != INVALID_INDEX && current < CAD_MAX_POINTS && checked < count) {
-            /* Cycle detection */
-            int already_visited = 0;
-            for (int v = 0; v < visited_count && v < 64; v++) {
-                if (visited[v] == current) {
-                    already_visited = 1;
-                    break;
-                }
+        CadIndex g = plan->polygons[i];
+        journal_polygon(core, g);
+        data->polygons[g].firstPoint = head;
+        data->polygons[g].npoints = (uint8_t)n;
+        mark_topology(&core->changes.polygons, g);
+        adjacency_refresh_polygon(core, g);
+        reversed++;
+    }
+    
+    /* The old chains of re-chained faces may now be unused */
+    for (int i = 0; i < count; i++) {
+        if (!plan->shared[i]) continue;
+        for (int k = plan->start[i]; k < plan->start[i + 1]; k++) {
+            CadIndex p = plan->walk[k];
+            if (CadCore_IsPointValid(core, p) && core->adjacency.pointFirstUse[p] == INVALID_INDEX) {
+                CadCore_DeletePoint(core, p);
             }
-            if (already_visited) break;
-            if (visited_count < 64) {
-                visited[visited_count++] = current;
+        }
+    }
+    if (reversed) core->isDirty = 1;
+    return reversed;
+}
+
+int CadCore_ReversePolygons(CadCore* core, const CadIndex* polygons, int count) {
+    if (!core || !polygons || count <= 0) return 0;
+    
+    ReversePlan plan;
+    if (!reverse_plan(core, polygons, count, &plan)) {
+        fprintf(stderr, "Error: Out of memory reversing polygons\n");
+        return -1;
+    }
+    CadCore_BeginUndoGroup(core);
+    int reversed = reverse_apply(core, count, &plan);
+    CadCore_EndUndoGroup(core);
+    reverse_free(&plan);
+    return reversed;
+}
+
+int CadCore_ReflectSelection(CadCore* core, int polygons, int axis, double center) {
+    if (!core || axis < 0 || axis > 2) return 0;
+    
+    int count = CadCore_CollectSelectionPoints(core, polygons, NULL, 0);
+    if (count <= 0) return count;
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    int ng = core->data.polygonCount;
+    CadIndex* points = (CadIndex*)malloc((size_t)count * sizeof(CadIndex));
+    CadIndex* faces = (CadIndex*)malloc((size_t)(ng > 0 ? ng : 1) * sizeof(CadIndex));
+    uint64_t* moved = (uint64_t*)calloc((size_t)BIT_WORDS(core->data.pointCount) + 1, sizeof(uint64_t));
+    uint64_t* seen = (uint64_t*)calloc((size_t)BIT_WORDS(ng) + 1, sizeof(uint64_t));
+    if (!index || !points || !faces || !moved || !seen) {
+        fprintf(stderr, "Error: Out of memory reflecting selection\n");
+        free(points);
+        free(faces);
+        free(moved);
+        free(seen);
+        return -1;
+    }
+    count = CadCore_CollectSelectionPoints(core, polygons, points, count);
+    for (int i = 0; i < count; i++) set_bit(moved, points[i]);
+    
+    /* Faces through a moved point whose every point moves come out mirrored */
+    const CadAdjacency* adj = &core->adjacency;
+    int faceCount = 0;
+    for (int i = 0; i < count; i++) {
+        for (CadIndex u = adj->pointFirstUse[points[i]]; u != INVALID_INDEX; u = adj->nodes[u].nextInPoint) {
+            CadIndex g = adj->nodes[u].polygon;
+            if (test_bit(seen, g)) continue;
+            set_bit(seen, g);
+            int k = index->offsets[g];
+            while (k < index->offsets[g + 1] && test_bit(moved, index->vertices[k])) k++;
+            if (k == index->offsets[g + 1]) faces[faceCount++] = g;
+        }
+    }
+    
+    ReversePlan plan;
+    if (count < 0 || !reverse_plan(core, faces, faceCount, &plan)) {
+        fprintf(stderr, "Error: Out of memory reflecting selection\n");
+        free(points);
+        free(faces);
+        free(moved);
+        free(seen);
+        return -1;
+    }
+    
+    double m[12];
+    CadCore_MatrixTranslate(m, 0.0, 0.0, 0.0);
+    m[5 * axis] = -1.0;
+    m[4 * axis + 3] = 2.0 * center;
+    CadCore_BeginUndoGroup(core);
+    int result = CadCore_TransformPoints(core, points, count, m);
+    reverse_apply(core, faceCount, &plan);
+    CadCore_EndUndoGroup(core);
+    
+    reverse_free(&plan);
+    free(points);
+    free(faces);
+    free(moved);
+    free(seen);
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+   Face cut
+   Signed plane distances of every walked vertex of the listed faces are
+   computed in one SSE2 pass; only faces with vertices on both sides go on
+   to be split. Cut vertices live in a hash map keyed by the grid cells of
+   their edge's ends, so each shared edge is intersected once.
+   ---------------------------------------------------------------------------- */
+
+typedef struct {
+    CadIndex a, b;               /* Cells (grid representatives) of the edge's ends, a <= b; -1 = empty */
+    double xyz[3];
+} CutEdge;
+
+static CutEdge* cut_edge_slot(CutEdge* edges, uint32_t mask, CadIndex a, CadIndex b) {
+    uint32_t s = hash_cell((uint32_t)a, (uint32_t)b, 0u) & mask;
+    while (edges[s].a != INVALID_INDEX && (edges[s].a != a || edges[s].b != b)) s = (s + 1) & mask;
+    return &edges[s];
+}
+
+static void cut_distances(const CadFileData* data, const CadIndex* verts, int count, const double plane[4],
+                          double* dist) {
+    int k = 0;
+#ifdef CAD_HAVE_SSE2
+    const __m128d n0 = _mm_set1_pd(plane[0]), n1 = _mm_set1_pd(plane[1]);
+    const __m128d n2 = _mm_set1_pd(plane[2]), w = _mm_set1_pd(plane[3]);
+    for (; k + 2 <= count; k += 2) {
+        __m128d x = _mm_set_pd(data->pointX[verts[k + 1]], data->pointX[verts[k]]);
+        __m128d y = _mm_set_pd(data->pointY[verts[k + 1]], data->pointY[verts[k]]);
+        __m128d z = _mm_set_pd(data->pointZ[verts[k + 1]], data->pointZ[verts[k]]);
+        _mm_storeu_pd(dist + k, _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(n0, x), _mm_mul_pd(n1, y)),
+                                                      _mm_mul_pd(n2, z)), w));
+    }
+#endif
+    for (; k < count; k++) {
+        CadIndex v = verts[k];
+        dist[k] = ((plane[0] * data->pointX[v] + plane[1] * data->pointY[v]) + plane[2] * data->pointZ[v]) - plane[3];
+    }
+}
+
+static int cut_side(double d) {
+    return d > CAD_COPLANAR_EPSILON ? BSP_FRONT : d < -CAD_COPLANAR_EPSILON ? BSP_BACK : BSP_ON;
+}
+
+/* Pieces a ring of count vertices is cut into along diagonals from its
+   first vertex (as bsp_add_piece), and the vertices they take */
+static int cut_piece_count(int count) {
+    return count <= CAD_MAX_FACE_POINTS ? 1 : (count - 2 + CAD_MAX_FACE_POINTS - 3) / (CAD_MAX_FACE_POINTS - 2);
+}
+
+/* Replace face p by the pieces of its split rings: pieces [0, ringCount) */
+static void cut_apply_face(CadCore* core, CadIndex p, const double* xyz, const int* ringStart, int ringCount) {
+    int selected = CadCore_IsPolygonSelected(core, p);
+    CadIndex prev = INVALID_INDEX;
+    double chunk[3 * CAD_MAX_FACE_POINTS];
+    for (int r = 0; r < ringCount; r++) {
+        const double* ring = &xyz[3 * (size_t)ringStart[r]];
+        int count = ringStart[r + 1] - ringStart[r];
+        int start = 1;
+        while (start < count - 1) {
+            int n = count - start + 1 > CAD_MAX_FACE_POINTS ? CAD_MAX_FACE_POINTS : count - start + 1;
+            memcpy(chunk, ring, 3 * sizeof(double));
+            memcpy(&chunk[3], &ring[3 * start], (size_t)(n - 1) * 3 * sizeof(double));
+            CadIndex head = add_piece_chain(core, chunk, n);
+            if (prev == INVALID_INDEX) {
+                set_first_piece(core, p, head, n);
+                prev = p;
+            } else {
+                prev = add_next_piece(core, p, prev, head, n);
+                if (selected) CadCore_SelectPolygon(core, prev);
             }
-            
-            CadPoint* pt = &core->data.points[current];
-            if (pt->flags == 0) break;
-            
-            if (prev_point != INVALID_INDEX && prev_point < CAD_MAX_POINTS) {
-                CadPoint* prev_pt = &core->data.points[prev_point];
-                
-                /* Check if converted coordinates match */
-                int prev_x = convert_coordinate(prev_pt->pointx);
-                int prev_y = convert_coordinate(prev_pt->pointy);
-                int prev_z = convert_coordinate(prev_pt->pointz);
-                int curr_x = convert_coordinate(pt->pointx);
-                int curr_y = convert_coordinate(pt->pointy);
-                int curr_z = convert_coordinate(pt->pointz);
+            start += n - 2;
+        }
+    }
+}
+
+int CadCore_CutPolygons(CadCore* core, const CadIndex* polygons, int count, const double plane[4],
+                        int* cutPoints) {
+    if (cutPoints) *cutPoints = 0;
+    if (!core || !polygons || !plane || count <= 0) return 0;
+    
+    CadFileData* data = &core->data;
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    int total = 0;
+    for (int i = 0; index && i < count; i++) {
+        if (CadCore_IsPolygonValid(core, polygons[i])) total += index->offsets[polygons[i] + 1] - index->offsets[polygons[i]];
+    }
+    CadIndex* verts = (CadIndex*)malloc((size_t)(total > 0 ? total : 1) * sizeof(CadIndex));
+    int* start = (int*)malloc((size_t)(count + 1) * sizeof(int));
+    int* straddlers = (int*)malloc((size_t)count * sizeof(int));   /* Listed position of each cut face */
+    CadIndex* cutFaces = (CadIndex*)malloc((size_t)count * sizeof(CadIndex)); /* Copied: the list may move */
+    double* dist = (double*)malloc((size_t)(total > 0 ? total : 1) * sizeof(double));
+    if (!index || !verts || !start || !straddlers || !cutFaces || !dist) {
+        fprintf(stderr, "Error: Out of memory cutting faces\n");
+        free(verts);
+        free(start);
+        free(straddlers);
+        free(cutFaces);
+        free(dist);
+        return -1;
+    }
+    
+    /* Flatten the walks, then classify every vertex in one pass */
+    int used = 0;
+    for (int i = 0; i < count; i++) {
+        CadIndex g = polygons[i];
+        start[i] = used;
+        if (!CadCore_IsPolygonValid(core, g)) continue;
+        int n = index->offsets[g + 1] - index->offsets[g];
+        memcpy(&verts[used], &index->vertices[index->offsets[g]], (size_t)n * sizeof(CadIndex));
+        used += n;
+    }
+    start[count] = used;
+    cut_distances(data, verts, used, plane, dist);
+    
+    /* Only faces of 3 or more points spanning the plane go further */
+    int straddleCount = 0, straddleVerts = 0;
+    for (int i = 0; i < count; i++) {
+        int sides = BSP_ON;
+        if (start[i + 1] - start[i] >= 3) {
+            for (int k = start[i]; k < start[i + 1] && sides != BSP_SPANNING; k++) sides |= cut_side(dist[k]);
+        }
+        if (sides != BSP_SPANNING) continue;
+        cutFaces[straddleCount] = polygons[i];
+        straddlers[straddleCount++] = i;
+        straddleVerts += start[i + 1] - start[i];
+    }
+    if (straddleCount == 0) {
+        free(verts);
+        free(start);
+        free(straddlers);
+        free(cutFaces);
+        free(dist);
+        return 0;
+    }
+    
+    /* A front and a back ring per face; each takes at most every vertex
+       plus one cut vertex per edge */
+    int size = 64;
+    while (size < (1 << 30) && size / 2 < straddleVerts) size *= 2;
+    CadIndex* rep = (CadIndex*)malloc((size_t)(data->pointCount > 0 ? data->pointCount : 1) * sizeof(CadIndex));
+    CutEdge* edges = (CutEdge*)malloc((size_t)size * sizeof(CutEdge));
+    double* xyz = (double*)malloc((size_t)straddleVerts * 4 * 3 * sizeof(double));
+    int* rings = (int*)malloc(((size_t)straddleCount * 2 + 1) * sizeof(int));
+    int ok = rep && edges && xyz && rings && build_grid_representatives(core, rep);
+    
+    int vertexCount = 0, cuts = 0, addedPolygons = 0;
+    uint32_t mask = (uint32_t)size - 1;
+    for (int s = 0; ok && s < size; s++) edges[s].a = INVALID_INDEX;
+    for (int f = 0; ok && f < straddleCount; f++) {
+        int first = start[straddlers[f]];
+        int n = start[straddlers[f] + 1] - first;
+        for (int side = 0; side < 2; side++) {
+            int skip = side == 0 ? BSP_BACK : BSP_FRONT;
+            rings[2 * f + side] = vertexCount;
+            for (int k = 0; k < n; k++) {
+                int kn = (k + 1) % n;
+                CadIndex p = verts[first + k], q = verts[first + kn];
+                int sp = cut_side(dist[first + k]), sq = cut_side(dist[first + kn]);
+                if (sp != skip) {
+                    double* out = &xyz[3 * (size_t)vertexCount++];
+                    out[0] = data->pointX[p];
+                    out[1] = data->pointY[p];
+                    out[2] = data->pointZ[p];
+                }
+                if ((sp | sq) != BSP_SPANNING) continue;
                 
-                if (prev_x == curr_x && prev_y == curr_y && prev_z == curr_z) {
-                    return 0; /* Found duplicate consecutive points */
+                /* Intersect from the end in the lower cell, the first time
+                   the edge is met from either face */
+                int swap = rep[q] < rep[p];
+                CadIndex a = swap ? q : p, b = swap ? p : q;
+                CutEdge* e = cut_edge_slot(edges, mask, rep[a], rep[b]);
+                if (e->a == INVALID_INDEX) {
+                    double da = swap ? dist[first + kn] : dist[first + k];
+                    double db = swap ? dist[first + k] : dist[first + kn];
+                    double t = da / (da - db);
+                    e->a = rep[a];
+                    e->b = rep[b];
+                    e->xyz[0] = data->pointX[a] + t * (data->pointX[b] - data->pointX[a]);
+                    e->xyz[1] = data->pointY[a] + t * (data->pointY[b] - data->pointY[a]);
+                    e->xyz[2] = data->pointZ[a] + t * (data->pointZ[b] - data->pointZ[a]);
+                    cuts++;
                 }
+                memcpy(&xyz[3 * (size_t)vertexCount++], e->xyz, sizeof(e->xyz));
             }
-            
-            prev_point = current;
-            current = pt->nextPoint;
-            checked++;
-            if (checked > 1000) break; /* Safety limit */
+            addedPolygons += cut_piece_count(vertexCount - rings[2 * f + side]);
         }
+        addedPolygons--; /* The first piece keeps the face's slot */
+    }
+    if (ok) rings[2 * straddleCount] = vertexCount;
+    ok = ok && CadCore_Reserve(core, 0, data->polygonCount + addedPolygons, data->pointCount + vertexCount);
+    if (!ok) {
+        fprintf(stderr, "Error: Out of memory cutting faces\n");
+        free(verts);
+        free(start);
+        free(straddlers);
+        free(cutFaces);
+        free(dist);
+        free(rep);
+        free(edges);
+        free(xyz);
+        free(rings);
+        return -1;
     }
     
-    return 1; /* No duplicate points found */
-}
-
-/* Check if all merge operations have been applied */
-int CadCore_IsFullyMerged(CadCore* core) {
-    if (!core) return 0;
+    CadCore_BeginUndoGroup(core);
+    for (int f = 0; f < straddleCount; f++) {
+        cut_apply_face(core, cutFaces[f], xyz, &rings[2 * f], 2);
+    }
     
-    return CadCore_AreCoordinatesMerged(core) && CadCore_ArePointsMerged(core);
+    /* The old chains may now be unused */
+    for (int f = 0; f < straddleCount; f++) {
+        for (int k = start[straddlers[f]]; k < start[straddlers[f] + 1]; k++) {
+            CadIndex p = verts[k];
+            if (CadCore_IsPointValid(core, p) && core->adjacency.pointFirstUse[p] == INVALID_INDEX) {
+                CadCore_DeletePoint(core, p);
+            }
+        }
+    }
+    CadCore_EndUndoGroup(core);
+    core->isDirty = 1;
+    if (cutPoints) *cutPoints = cuts;
+    
+    free(verts);
+    free(start);
+    free(straddlers);
+    free(cutFaces);
+    free(dist);
+    free(rep);
+    free(edges);
+    free(xyz);
+    free(rings);
+    return straddleCount;
 }
 
 /* ----------------------------------------------------------------------------
-   Check if a point is connected to any polygon
+   Primitives
+   A generator runs twice over the same writer: first only counting points
+   and faces, then, after one reserve, writing them past the high-water
+   mark. Coordinates are relative to the primitive's center.
    ---------------------------------------------------------------------------- */
-int CadCore_IsPointConnected(CadCore* core, int16_t pointIndex) {
-    if (!core || pointIndex < 0 || pointIndex >= CAD_MAX_POINTS) return 0;
-    if (!CadCore_IsPointValid(core, pointIndex)) return 0;
+
+#define PRIMITIVE_PI 3.14159265358979323846
+
+typedef struct {
+    CadCore* core;
+    int writing;                 /* 0 = count only */
+    int points;                  /* Emitted so far */
+    int faces;
+    CadIndex object;             /* Group the faces join, or -1 */
+    CadIndex tail;               /* Last face of that group, or -1 */
+    double center[3];
+    uint8_t color;
+} PrimitiveWriter;
+
+static void primitive_face(PrimitiveWriter* w, double (*xyz)[3], int count) {
+    w->points += count;
+    w->faces++;
+    if (!w->writing) return;
     
-    /* Check all polygons to see if this point is used */
-    for (int i = 0; i < core->data.polygonCount; i++) {
-        CadPolygon* poly = CadCore_GetPolygon(core, i);
-        if (!poly || poly->flags == 0) continue;
-        if (poly->npoints < 2) continue;
-        
-        /* Traverse the polygon's point linked list */
-        int16_t current = poly->firstPoint;
-        int visited_count = 0;
-        int16_t visited[64]; /* Cycle detection */
-        
-        while (current >= 0 && current < CAD_MAX_POINTS && visited_count < 64) {
-            /* Check for cycles */
-            int already_visited = 0;
-            for (int v = 0; v < visited_count; v++) {
-                if (visited[v] == current) {
-                    already_visited = 1;
-                    break;
+    CadCore* core = w->core;
+    CadFileData* data = &core->data;
+    CadIndex head = (CadIndex)data->pointCount;
+    for (int v = 0; v < count; v++) {
+        CadIndex i = (CadIndex)data->pointCount++;
+        init_point_slot(core, i, 0, w->center[0] + xyz[v][0], w->center[1] + xyz[v][1], w->center[2] + xyz[v][2]);
+        if (v > 0) data->points[i - 1].nextPoint = i; /* Journaled and marked by init_point_slot */
+    }
+    
+    CadIndex p = (CadIndex)data->polygonCount++;
+    init_polygon_slot(core, p, 0, head, w->color, (uint8_t)count);
+    if (w->object == INVALID_INDEX) return;
+    if (w->tail == INVALID_INDEX) {
+        journal_object(core, w->object);
+        data->objects[w->object].firstPolygon = p;
+        mark_topology(&core->changes.objects, w->object);
+    } else {
+        journal_polygon(core, w->tail);
+        data->polygons[w->tail].nextPolygon = p;
+        mark_topology(&core->changes.polygons, w->tail);
+    }
+    w->tail = p;
+}
+
+static void primitive_vertex(double* v, double x, double y, double z) {
+    v[0] = x;
+    v[1] = y;
+    v[2] = z;
+}
+
+/* Disc at height y on the unit circle table scaled by rx, rz, facing +Y
+   (up) or -Y: one face if it fits, else a fan around its center */
+static void primitive_cap(PrimitiveWriter* w, int n, const double* cs, const double* sn, double rx, double rz,
+                          double y, int up) {
+    double f[CAD_MAX_FACE_POINTS][3];
+    if (n <= CAD_MAX_FACE_POINTS) {
+        for (int k = 0; k < n; k++) {
+            int c = up ? n - 1 - k : k;
+            primitive_vertex(f[k], rx * cs[c], y, rz * sn[c]);
+        }
+        primitive_face(w, f, n);
+        return;
+    }
+    for (int k = 0; k < n; k++) {
+        int a = up ? k + 1 : k, b = up ? k : k + 1;
+        primitive_vertex(f[0], 0.0, y, 0.0);
+        primitive_vertex(f[1], rx * cs[a], y, rz * sn[a]);
+        primitive_vertex(f[2], rx * cs[b], y, rz * sn[b]);
+        primitive_face(w, f, 3);
+    }
+}
+
+/* Emit every face of the primitive; n and m are the clamped segment and
+   ring counts, cs / sn the unit circle at n + 1 steps (last = first) */
+static void primitive_emit(PrimitiveWriter* w, const CadPrimitive* pr, int n, int m, const double* cs,
+                           const double* sn) {
+    const double r[3] = { 0.5 * pr->size[0], 0.5 * pr->size[1], 0.5 * pr->size[2] };
+    double f[CAD_MAX_FACE_POINTS][3];
+    
+    switch (pr->type) {
+    case CAD_PRIMITIVE_BOX:
+        /* Corners go around +u, +v (whose cross product is +a) on the + side */
+        for (int a = 0; a < 3; a++) {
+            static const int cu[4] = { -1, 1, 1, -1 }, cv[4] = { -1, -1, 1, 1 };
+            int u = (a + 1) % 3, v = (a + 2) % 3;
+            for (int s = 1; s >= -1; s -= 2) {
+                for (int k = 0; k < 4; k++) {
+                    int c = s > 0 ? k : 3 - k;
+                    f[k][a] = s * r[a];
+                    f[k][u] = cu[c] * r[u];
+                    f[k][v] = cv[c] * r[v];
                 }
+                primitive_face(w, f, 4);
             }
-            if (already_visited) break;
-            visited[visited_count++] = current;
-            
-            /* If this point matches, it's connected */
-            if (current == pointIndex) {
-                return 1;
+        }
+        break;
+    case CAD_PRIMITIVE_CYLINDER:
+    case CAD_PRIMITIVE_CONE:
+        for (int k = 0; k < n; k++) {
+            primitive_vertex(f[0], r[0] * cs[k], -r[1], r[2] * sn[k]);
+            if (pr->type == CAD_PRIMITIVE_CONE) {
+                primitive_vertex(f[1], 0.0, r[1], 0.0);
+                primitive_vertex(f[2], r[0] * cs[k + 1], -r[1], r[2] * sn[k + 1]);
+                primitive_face(w, f, 3);
+            } else {
+                primitive_vertex(f[1], r[0] * cs[k], r[1], r[2] * sn[k]);
+                primitive_vertex(f[2], r[0] * cs[k + 1], r[1], r[2] * sn[k + 1]);
+                primitive_vertex(f[3], r[0] * cs[k + 1], -r[1], r[2] * sn[k + 1]);
+                primitive_face(w, f, 4);
             }
-            
-            CadPoint* pt = CadCore_GetPoint(core, current);
-            if (!pt || pt->flags == 0) break;
-            
-            current = pt->nextPoint;
+        }
+        primitive_cap(w, n, cs, sn, r[0], r[2], -r[1], 0);
+        if (pr->type == CAD_PRIMITIVE_CYLINDER) primitive_cap(w, n, cs, sn, r[0], r[2], r[1], 1);
+        break;
+    case CAD_PRIMITIVE_SPHERE:
+        /* Bands from the +Y pole down; the outer bands close on the poles */
+        for (int j = 0; j < m; j++) {
+            double a0 = PRIMITIVE_PI * j / m, a1 = PRIMITIVE_PI * (j + 1) / m;
+            double s0 = sin(a0), y0 = r[1] * cos(a0), s1 = sin(a1), y1 = r[1] * cos(a1);
+            for (int k = 0; k < n; k++) {
+                if (j == 0) {
+                    primitive_vertex(f[0], r[0] * s1 * cs[k], y1, r[2] * s1 * sn[k]);
+                    primitive_vertex(f[1], 0.0, r[1], 0.0);
+                    primitive_vertex(f[2], r[0] * s1 * cs[k + 1], y1, r[2] * s1 * sn[k + 1]);
+                    primitive_face(w, f, 3);
+                } else if (j == m - 1) {
+                    primitive_vertex(f[0], 0.0, -r[1], 0.0);
+                    primitive_vertex(f[1], r[0] * s0 * cs[k], y0, r[2] * s0 * sn[k]);
+                    primitive_vertex(f[2], r[0] * s0 * cs[k + 1], y0, r[2] * s0 * sn[k + 1]);
+                    primitive_face(w, f, 3);
+                } else {
+                    primitive_vertex(f[0], r[0] * s1 * cs[k], y1, r[2] * s1 * sn[k]);
+                    primitive_vertex(f[1], r[0] * s0 * cs[k], y0, r[2] * s0 * sn[k]);
+                    primitive_vertex(f[2], r[0] * s0 * cs[k + 1], y0, r[2] * s0 * sn[k + 1]);
+                    primitive_vertex(f[3], r[0] * s1 * cs[k + 1], y1, r[2] * s1 * sn[k + 1]);
+                    primitive_face(w, f, 4);
+                }
+            }
+        }
+        break;
+    case CAD_PRIMITIVE_GRID:
+        for (int j = 0; j < m; j++) {
+            double z0 = -r[2] + pr->size[2] * j / m, z1 = -r[2] + pr->size[2] * (j + 1) / m;
+            for (int i = 0; i < n; i++) {
+                double x0 = -r[0] + pr->size[0] * i / n, x1 = -r[0] + pr->size[0] * (i + 1) / n;
+                primitive_vertex(f[0], x0, 0.0, z0);
+                primitive_vertex(f[1], x0, 0.0, z1);
+                primitive_vertex(f[2], x1, 0.0, z1);
+                primitive_vertex(f[3], x1, 0.0, z0);
+                primitive_face(w, f, 4);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+int CadCore_AddPrimitive(CadCore* core, CadIndex object, const CadPrimitive* primitive, CadIndex* firstPolygon) {
+    if (firstPolygon) *firstPolygon = INVALID_INDEX;
+    if (!core || !primitive) return 0;
+    if (object != INVALID_INDEX && !CadCore_IsObjectValid(core, object)) return 0;
+    
+    int grid = primitive->type == CAD_PRIMITIVE_GRID;
+    int n = primitive->segments, m = primitive->rings;
+    if (n < (grid ? 1 : 3)) n = grid ? 1 : 3;
+    if (n > CAD_PRIMITIVE_MAX_SEGMENTS) n = CAD_PRIMITIVE_MAX_SEGMENTS;
+    if (m < (grid ? 1 : 2)) m = grid ? 1 : 2;
+    if (m > CAD_PRIMITIVE_MAX_SEGMENTS) m = CAD_PRIMITIVE_MAX_SEGMENTS;
+    
+    double* cs = (double*)malloc(2 * (size_t)(n + 1) * sizeof(double));
+    if (!cs) {
+        fprintf(stderr, "Error: Out of memory generating primitive\n");
+        return -1;
+    }
+    double* sn = cs + n + 1;
+    for (int k = 0; k < n; k++) {
+        double a = 2.0 * PRIMITIVE_PI * k / n;
+        cs[k] = cos(a);
+        sn[k] = sin(a);
+    }
+    cs[n] = cs[0];
+    sn[n] = sn[0];
+    
+    PrimitiveWriter w;
+    memset(&w, 0, sizeof(w));
+    w.core = core;
+    w.object = object;
+    w.tail = INVALID_INDEX;
+    memcpy(w.center, primitive->center, sizeof(w.center));
+    w.color = primitive->color;
+    primitive_emit(&w, primitive, n, m, cs, sn);
+    
+    int faces = w.faces;
+    if (!CadCore_Reserve(core, 0, core->data.polygonCount + faces, core->data.pointCount + w.points)) {
+        fprintf(stderr, "Error: Out of memory generating primitive\n");
+        free(cs);
+        return -1;
+    }
+    
+    /* New faces go after the object's current last face */
+    if (object != INVALID_INDEX) {
+        CadIndex p = core->data.objects[object].firstPolygon;
+        for (int step = 0; CadCore_IsPolygonValid(core, p) && step < core->data.polygonCount; step++) {
+            w.tail = p;
+            p = core->data.polygons[p].nextPolygon;
         }
     }
     
-    return 0; /* Not found in any polygon */
+    CadIndex first = (CadIndex)core->data.polygonCount;
+    w.writing = 1;
+    w.points = 0;
+    w.faces = 0;
+    CadCore_BeginUndoGroup(core);
+    primitive_emit(&w, primitive, n, m, cs, sn);
+    CadCore_EndUndoGroup(core);
+    
+    if (faces > 0) {
+        core->newPolygon = first + faces - 1;
+        core->newPoint = (CadIndex)core->data.pointCount - 1;
+        core->isDirty = 1;
+        if (firstPolygon) *firstPolygon = first;
+    }
+    free(cs);
+    return faces;
 }
 
+/* ----------------------------------------------------------------------------
+   Face copy
+   Faces and walked points are numbered in order of first use through
+   dense remap arrays over the pools; copy k of a pool lands in slot
+   base + k, so remaps double as the new indices.
+   ---------------------------------------------------------------------------- */
+
+int CadCore_CopyPolygons(CadCore* core, const CadIndex* polygons, int count, const double offset[3], int frame,
+                         CadIndex* firstCopy) {
+    if (firstCopy) *firstCopy = INVALID_INDEX;
+    if (!core || !polygons || count <= 0) return 0;
+    
+    CadFileData* data = &core->data;
+    int pointCount = data->pointCount, polygonCount = data->polygonCount;
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    int total = 0;
+    for (int i = 0; index && i < count; i++) {
+        if (CadCore_IsPolygonValid(core, polygons[i])) total += index->offsets[polygons[i] + 1] - index->offsets[polygons[i]];
+    }
+    CadIndex* faces = (CadIndex*)malloc((size_t)count * sizeof(CadIndex)); /* Copied: the list may move */
+    CadIndex* points = (CadIndex*)malloc((size_t)(total > 0 ? total : 1) * sizeof(CadIndex));
+    CadIndex* pointRemap = (CadIndex*)malloc((size_t)(pointCount > 0 ? pointCount : 1) * sizeof(CadIndex));
+    CadIndex* faceRemap = (CadIndex*)malloc((size_t)(polygonCount > 0 ? polygonCount : 1) * sizeof(CadIndex));
+    if (!index || !faces || !points || !pointRemap || !faceRemap) {
+        fprintf(stderr, "Error: Out of memory copying faces\n");
+        free(faces);
+        free(points);
+        free(pointRemap);
+        free(faceRemap);
+        return -1;
+    }
+    for (int i = 0; i < pointCount; i++) pointRemap[i] = INVALID_INDEX;
+    for (int i = 0; i < polygonCount; i++) faceRemap[i] = INVALID_INDEX;
+    
+    /* Number the faces with a walk, and their points in order of first use */
+    int faceCount = 0, copiedPoints = 0;
+    for (int i = 0; i < count; i++) {
+        CadIndex g = polygons[i];
+        if (!CadCore_IsPolygonValid(core, g) || faceRemap[g] != INVALID_INDEX) continue;
+        int first = index->offsets[g], end = index->offsets[g + 1];
+        if (first == end) continue;
+        for (int k = first; k < end; k++) {
+            CadIndex v = index->vertices[k];
+            if (pointRemap[v] == INVALID_INDEX) {
+                pointRemap[v] = (CadIndex)copiedPoints;
+                points[copiedPoints++] = v;
+            }
+        }
+        faceRemap[g] = (CadIndex)faceCount;
+        faces[faceCount++] = g;
+    }
+    if (faceCount == 0 || !CadCore_Reserve(core, 0, polygonCount + faceCount, pointCount + copiedPoints)) {
+        if (faceCount > 0) fprintf(stderr, "Error: Out of memory copying faces\n");
+        free(faces);
+        free(points);
+        free(pointRemap);
+        free(faceRemap);
+        return faceCount > 0 ? -1 : 0;
+    }
+    
+    double dx = offset ? offset[0] : 0.0, dy = offset ? offset[1] : 0.0, dz = offset ? offset[2] : 0.0;
+    CadIndex pointBase = (CadIndex)pointCount, faceBase = (CadIndex)polygonCount;
+    CadCore_BeginUndoGroup(core);
+    
+    /* Points, moved as they are written; then the chains, which may link
+       forward to copies not yet written in the first pass */
+    for (int k = 0; k < copiedPoints; k++) {
+        CadIndex v = points[k];
+        data->pointCount++;
+        init_point_slot(core, pointBase + k, 0, data->pointX[v] + dx, data->pointY[v] + dy, data->pointZ[v] + dz);
+    }
+    for (int k = 0; k < copiedPoints; k++) {
+        CadIndex next = data->points[points[k]].nextPoint;
+        if (next >= 0 && next < pointCount && pointRemap[next] != INVALID_INDEX) {
+            data->points[pointBase + k].nextPoint = pointBase + pointRemap[next]; /* Journaled by init_point_slot */
+        }
+    }
+    
+    /* Faces, each spliced in right after its original */
+    for (int f = 0; f < faceCount; f++) {
+        CadIndex g = faces[f], q = faceBase + f;
+        const CadPolygon* src = &data->polygons[g];
+        data->polygonCount++;
+        init_polygon_slot(core, q, 0, pointBase + pointRemap[src->firstPoint], src->color, src->npoints);
+        CadPolygon* dst = &data->polygons[q];
+        dst->flags = src->flags;
+        dst->side = src->side;
+        dst->animation = frame >= 0 ? (int16_t)frame : src->animation;
+        if (src->both >= 0 && src->both < polygonCount && faceRemap[src->both] != INVALID_INDEX) {
+            dst->both = faceBase + faceRemap[src->both];
+        }
+        dst->nextPolygon = src->nextPolygon;
+        journal_polygon(core, g);
+        data->polygons[g].nextPolygon = q;
+        mark_topology(&core->changes.polygons, g);
+    }
+    CadCore_EndUndoGroup(core);
+    
+    core->newPoint = pointBase + copiedPoints - 1;
+    core->newPolygon = faceBase + faceCount - 1;
+    core->isDirty = 1;
+    if (firstCopy) *firstCopy = faceBase;
+    free(faces);
+    free(points);
+    free(pointRemap);
+    free(faceRemap);
+    return faceCount;
+}
@@ -18,10 +18,49 @@
 #endif
 #endif
 
+/* Next face to write: the back-to-front order if there is one, otherwise
+   live slot order */
+static CadIndex next_face(const CadCore* core, const CadIndex* order, int orderCount, int* cursor) {
+    if (order) return *cursor < orderCount ? order[(*cursor)++] : INVALID_INDEX;
+    CadIndex i = CadCore_NextLivePolygon(core, *cursor);
+    *cursor = i + 1;
+    return i;
+}
+
+/* Painter's order from the eye, or NULL. The tree is in model space, so it
+   only applies while every object offset is zero. */
+static CadIndex* sorted_faces(const CadCore* core, const double* eye, int* count) {
+    *count = 0;
+    const CadBspTree* tree = eye ? CadCore_GetBspTree(core) : NULL;
+    if (!tree) return NULL;
+    const CadHierarchy* hierarchy = CadCore_GetHierarchy(core);
+    if (!hierarchy || !hierarchy->identity) {
+        fprintf(stderr, "Warning: Object offsets are set; writing faces unsorted\n");
+        return NULL;
+    }
+    CadIndex* order = (CadIndex*)malloc((size_t)(tree->faceCount > 0 ? tree->faceCount : 1) * sizeof(CadIndex));
+    if (!order) return NULL;
+    *count = CadCore_GetBackToFrontOrder(core, eye[0], eye[1], eye[2], order, tree->faceCount);
+    if (*count < 0) {
+        free(order);
+        *count = 0;
+        return NULL;
+    }
+    return order;
+}
+
 /* Export CAD data to Fundoshi-Kun format */
-int CadExport_3DG1(const CadCore* core, const char* filename) {
+int CadExport_3DG1(const CadCore* core, const char* filename, const double* eye) {
     if (!core || !filename) return 0;
     
+    /* Face vertex lists come from the flattened polygon index */
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    if (!index) return 0;
+    
+    /* Vertices are written at their world positions (object offsets applied) */
+    const double *wx, *wy, *wz;
+    if (!CadCore_GetWorldPoints(core, &wx, &wy, &wz)) return 0;
+    
     FILE* fp_obj = NULL;
 
 #ifdef _WIN32
@@ -48,17 +87,20 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
     }
 
     /* Step 1: Collect all valid points and create index mapping */
-    int point_to_vertex[CAD_MAX_POINTS];
+    int* point_to_vertex = (int*)malloc((size_t)(core->data.pointCount > 0 ? core->data.pointCount : 1) * sizeof(int));
     int vertex_count = 0;
+    if (!point_to_vertex) {
+        fprintf(stderr, "Error: Out of memory exporting '%s'\n", filename);
+        fclose(fp_obj);
+        return 0;
+    }
     
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags != 0) {
-            point_to_vertex[i] = vertex_count + 1; /* 3DG1 uses 1-based indexing */
-            vertex_count++;
-        } else {
-            point_to_vertex[i] = -1; /* Invalid point */
-        }
+    for (int i = 0; i < core->data.pointCount; i++) {
+        point_to_vertex[i] = -1; /* Invalid point */
+    }
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        point_to_vertex[i] = vertex_count + 1; /* 3DG1 uses 1-based indexing */
+        vertex_count++;
     }
 
     /* Write Fundoshi-Kun header */
@@ -66,12 +108,9 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
     fprintf(fp_obj, "%d\n", vertex_count); // total points in this shape (1-index)
     
     /* Step 2: Write all vertices */
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags != 0) {
-            //fprintf(fp_obj, "%.6f %.6f %.6f\n", pt->pointx, pt->pointy, pt->pointz);
-            fprintf(fp_obj, "%.f %.f %.f\n", pt->pointx, pt->pointy, pt->pointz); // we don't need all this precision
-        }
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        //fprintf(fp_obj, "%.6f %.6f %.6f\n", core->data.pointX[i], core->data.pointY[i], core->data.pointZ[i]);
+        fprintf(fp_obj, "%.f %.f %.f\n", wx[i], wy[i], wz[i]); // we don't need all this precision
     }
     
     /* Step 3: Collect unique colors */
@@ -85,9 +124,9 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
     }
     
     /* Find all unique colors used in polygons */
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
         const CadPolygon* poly = &core->data.polygons[i];
-        if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue; // Star Fox allows faces with at least 2 points (colored lines) 
+        if (poly->npoints < CAD_MIN_FACE_POINTS) continue; // Star Fox allows faces with at least 2 points (colored lines) 
         
         uint8_t color_idx = poly->color;
         if (color_map[color_idx] == -1) {
@@ -98,10 +137,14 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
     
     /* Step 4: Write all faces (polygons) with material assignments */
     uint8_t current_material = 255; /* Invalid, will force first material to be set */
+    int sortedCount;
+    CadIndex* sorted = sorted_faces(core, eye, &sortedCount);
+    int cursor = 0;
     
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (CadIndex i = next_face(core, sorted, sortedCount, &cursor); i >= 0;
+         i = next_face(core, sorted, sortedCount, &cursor)) {
         const CadPolygon* poly = &core->data.polygons[i];
-        if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue; // Star Fox allows faces with at least 2 points (colored lines) 
+        if (poly->npoints < CAD_MIN_FACE_POINTS) continue; // Star Fox allows faces with at least 2 points (colored lines) 
         
         /* Set material if it changed */
         if (poly->color != current_material) {
@@ -109,22 +152,13 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
         }
         
         /* Collect polygon vertices */
-        int16_t point_indices[256];
+        int point_indices[256];
         int point_count = 0;
-        int16_t current = poly->firstPoint;
-        
-        while (current >= 0 && current < CAD_MAX_POINTS && point_count < 256) {
-            if (current >= core->data.pointCount) break;
-            const CadPoint* pt = &core->data.points[current];
-            if (pt->flags == 0) break;
-            
-            int vertex_idx = point_to_vertex[current];
+        for (CadIndex v = index->offsets[i]; v < index->offsets[i + 1] && point_count < 256; v++) {
+            int vertex_idx = point_to_vertex[index->vertices[v]];
             if (vertex_idx > 0) {
-                point_indices[point_count++] = (int16_t)vertex_idx;
+                point_indices[point_count++] = vertex_idx;
             }
-            
-            current = pt->nextPoint;
-            if (point_count > 1000) break; /* Safety limit */
         }
         
         /* Write face if we have at least 2 vertices */
@@ -140,6 +174,8 @@ int CadExport_3DG1(const CadCore* core, const char* filename) {
         }
     }
     fprintf(fp_obj, "\x1a"); // End-of-File marker
+    free(sorted);
+    free(point_to_vertex);
     fclose(fp_obj);
     fprintf(stdout, "Exported 3DG1 file: %s (%d vertices, %d faces, %d materials)\n", 
             filename, vertex_count, core->data.polygonCount, color_count);
@@ -55,6 +55,14 @@ static void color_index_to_rgb(uint8_t color_idx, float* r, float* g, float* b)
 int CadExport_OBJ(const CadCore* core, const char* filename) {
     if (!core || !filename) return 0;
     
+    /* Face vertex lists come from the flattened polygon index */
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    if (!index) return 0;
+    
+    /* Vertices are written at their world positions (object offsets applied) */
+    const double *wx, *wy, *wz;
+    if (!CadCore_GetWorldPoints(core, &wx, &wy, &wz)) return 0;
+    
     FILE* fp_obj = NULL;
     FILE* fp_mtl = NULL;
     
@@ -135,25 +143,26 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
     fprintf(fp_mtl, "\n");
     
     /* Step 1: Collect all valid points and create index mapping */
-    int point_to_vertex[CAD_MAX_POINTS];
+    int* point_to_vertex = (int*)malloc((size_t)(core->data.pointCount > 0 ? core->data.pointCount : 1) * sizeof(int));
     int vertex_count = 0;
+    if (!point_to_vertex) {
+        fprintf(stderr, "Error: Out of memory exporting '%s'\n", filename);
+        fclose(fp_mtl);
+        fclose(fp_obj);
+        return 0;
+    }
     
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags != 0) {
-            point_to_vertex[i] = vertex_count + 1; /* OBJ uses 1-based indexing */
-            vertex_count++;
-        } else {
-            point_to_vertex[i] = -1; /* Invalid point */
-        }
+    for (int i = 0; i < core->data.pointCount; i++) {
+        point_to_vertex[i] = -1; /* Invalid point */
+    }
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        point_to_vertex[i] = vertex_count + 1; /* OBJ uses 1-based indexing */
+        vertex_count++;
     }
     
     /* Step 2: Write all vertices */
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags != 0) {
-            fprintf(fp_obj, "v %.6f %.6f %.6f\n", pt->pointx, pt->pointy, pt->pointz);
-        }
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
+        fprintf(fp_obj, "v %.6f %.6f %.6f\n", wx[i], wy[i], wz[i]);
     }
     
     fprintf(fp_obj, "\n");
@@ -169,9 +178,9 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
     }
     
     /* Find all unique colors used in polygons */
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
         const CadPolygon* poly = &core->data.polygons[i];
-        if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue;
+        if (poly->npoints < CAD_MIN_FACE_POINTS) continue;
         
         uint8_t color_idx = poly->color;
         if (color_map[color_idx] == -1) {
@@ -200,9 +209,9 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
     /* Step 4: Write all faces (polygons) with material assignments */
     uint8_t current_material = 255; /* Invalid, will force first material to be set */
     
-    for (int i = 0; i < core->data.polygonCount && i < CAD_MAX_POLYGONS; i++) {
+    for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
         const CadPolygon* poly = &core->data.polygons[i];
-        if (poly->flags == 0 || poly->npoints < CAD_MIN_FACE_POINTS) continue;
+        if (poly->npoints < CAD_MIN_FACE_POINTS) continue;
         
         /* Set material if it changed */
         if (poly->color != current_material) {
@@ -211,22 +220,13 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
         }
         
         /* Collect polygon vertices */
-        int16_t point_indices[256];
+        int point_indices[256];
         int point_count = 0;
-        int16_t current = poly->firstPoint;
-        
-        while (current >= 0 && current < CAD_MAX_POINTS && point_count < 256) {
-            if (current >= core->data.pointCount) break;
-            const CadPoint* pt = &core->data.points[current];
-            if (pt->flags == 0) break;
-            
-            int vertex_idx = point_to_vertex[current];
+        for (CadIndex v = index->offsets[i]; v < index->offsets[i + 1] && point_count < 256; v++) {
+            int vertex_idx = point_to_vertex[index->vertices[v]];
             if (vertex_idx > 0) {
-                point_indices[point_count++] = (int16_t)vertex_idx;
+                point_indices[point_count++] = vertex_idx;
             }
-            
-            current = pt->nextPoint;
-            if (point_count > 1000) break; /* Safety limit */
         }
         
         /* Write face if we have at least 2 vertices */
@@ -239,6 +239,7 @@ int CadExport_OBJ(const CadCore* core, const char* filename) {
         }
     }
     
+    free(point_to_vertex);
     fclose(fp_obj);
     fprintf(stdout, "Exported OBJ file: %s (%d vertices, %d faces, %d materials)\n", 
             filename, vertex_count, core->data.polygonCount, color_count);
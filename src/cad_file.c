@@ -7,6 +7,7 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <io.h>
+#include <malloc.h>
 #ifndef MAX_PATH
 #define MAX_PATH 260
 #endif
@@ -38,6 +39,44 @@ static inline double swap_double(double value) {
     return u.d;
 }
 
+/* ----------------------------------------------------------------------------
+   On-disk records
+   Layout of the original tool's structures (int16 links, natural padding).
+   In-memory records use 32-bit CadIndex links and are converted here.
+   ---------------------------------------------------------------------------- */
+typedef struct {
+    uint8_t  flags;
+    uint8_t  selectFlag;
+    int16_t  nextPoint;
+    double   pointx;
+    double   pointy;
+    double   pointz;
+} CadPointRecord;
+
+typedef struct {
+    uint8_t  flags;
+    uint8_t  selectFlag;
+    int16_t  nextPolygon;
+    int16_t  firstPoint;
+    int16_t  animation;
+    int16_t  both;
+    uint8_t  side;
+    uint8_t  color;
+    uint8_t  npoints;
+} CadPolygonRecord;
+
+typedef struct {
+    uint8_t  flags;
+    uint8_t  selectFlag;
+    int16_t  parentObject;
+    int16_t  nextBrother;
+    int16_t  childObject;
+    int16_t  firstPolygon;
+    double   offsetx;
+    double   offsety;
+    double   offsetz;
+} CadObjectRecord;
+
 /* Check if system is little-endian (Windows/x86 is little-endian) */
 static inline int is_little_endian(void) {
     union { uint16_t i; uint8_t c[2]; } u;
@@ -50,23 +89,138 @@ void CadFile_Init(CadFileData* data) {
     memset(data, 0, sizeof(CadFileData));
 }
 
+/* ----------------------------------------------------------------------------
+   Aligned allocation for coordinate arrays
+   ---------------------------------------------------------------------------- */
+static void* aligned_alloc_bytes(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, CAD_SIMD_ALIGN);
+#else
+    /* C11 aligned_alloc requires a multiple of the alignment */
+    size = (size + CAD_SIMD_ALIGN - 1) & ~(size_t)(CAD_SIMD_ALIGN - 1);
+    return aligned_alloc(CAD_SIMD_ALIGN, size);
+#endif
+}
+
+static void aligned_free(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
 void CadFile_Clear(CadFileData* data) {
     if (!data) return;
+    free(data->objects);
+    free(data->polygons);
+    free(data->points);
+    aligned_free(data->pointX);
+    aligned_free(data->pointY);
+    aligned_free(data->pointZ);
     CadFile_Init(data);
 }
 
-CadPoint* CadFile_GetPoint(CadFileData* data, int16_t index) {
-    if (!data || index < 0 || index >= CAD_MAX_POINTS) return NULL;
+/* Capacity a pool should grow to for 'needed' slots (0 if over the limit) */
+static int grown_capacity(int capacity, int needed) {
+    if (needed > CAD_MAX_INDEX + 1) {
+        fprintf(stderr, "Error: Pool size %d exceeds index limit %d\n", needed, CAD_MAX_INDEX + 1);
+        return 0;
+    }
+    
+    int new_capacity = capacity > 0 ? capacity * 2 : CAD_POOL_MIN_CAPACITY;
+    if (new_capacity < needed) new_capacity = needed;
+    if (new_capacity > CAD_MAX_INDEX + 1) new_capacity = CAD_MAX_INDEX + 1;
+    return new_capacity;
+}
+
+/* Resize one pool from 'capacity' to 'new_capacity' slots; new slots are zeroed */
+static int resize_pool(void** pool, int capacity, int new_capacity, size_t elem_size) {
+    void* grown = realloc(*pool, (size_t)new_capacity * elem_size);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory growing pool to %d entries\n", new_capacity);
+        return 0;
+    }
+    memset((uint8_t*)grown + (size_t)capacity * elem_size, 0,
+           (size_t)(new_capacity - capacity) * elem_size);
+    *pool = grown;
+    return 1;
+}
+
+/* Same as resize_pool for a CAD_SIMD_ALIGN-aligned coordinate array */
+static int resize_coords(double** coords, int capacity, int new_capacity) {
+    double* grown = (double*)aligned_alloc_bytes((size_t)new_capacity * sizeof(double));
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory growing coordinates to %d entries\n", new_capacity);
+        return 0;
+    }
+    if (capacity > 0) memcpy(grown, *coords, (size_t)capacity * sizeof(double));
+    memset(grown + capacity, 0, (size_t)(new_capacity - capacity) * sizeof(double));
+    aligned_free(*coords);
+    *coords = grown;
+    return 1;
+}
+
+/* Grow one pool to hold at least 'needed' slots */
+static int grow_pool(void** pool, int* capacity, int needed, size_t elem_size) {
+    if (needed <= *capacity) return 1;
+    int new_capacity = grown_capacity(*capacity, needed);
+    if (!new_capacity || !resize_pool(pool, *capacity, new_capacity, elem_size)) return 0;
+    *capacity = new_capacity;
+    return 1;
+}
+
+/* Grow the point records and the coordinate arrays together */
+static int grow_points(CadFileData* data, int needed) {
+    if (needed <= data->pointCapacity) return 1;
+    int capacity = data->pointCapacity;
+    int new_capacity = grown_capacity(capacity, needed);
+    if (!new_capacity ||
+        !resize_pool((void**)&data->points, capacity, new_capacity, sizeof(CadPoint)) ||
+        !resize_coords(&data->pointX, capacity, new_capacity) ||
+        !resize_coords(&data->pointY, capacity, new_capacity) ||
+        !resize_coords(&data->pointZ, capacity, new_capacity)) {
+        return 0;
+    }
+    data->pointCapacity = new_capacity;
+    return 1;
+}
+
+int CadFile_Reserve(CadFileData* data, int objects, int polygons, int points) {
+    if (!data) return 0;
+    return grow_pool((void**)&data->objects, &data->objectCapacity, objects, sizeof(CadObject)) &&
+           grow_pool((void**)&data->polygons, &data->polygonCapacity, polygons, sizeof(CadPolygon)) &&
+           grow_points(data, points);
+}
+
+CadPoint* CadFile_GetPoint(CadFileData* data, CadIndex index) {
+    if (!data || index < 0 || index >= data->pointCount) return NULL;
     return &data->points[index];
 }
 
-CadPolygon* CadFile_GetPolygon(CadFileData* data, int16_t index) {
-    if (!data || index < 0 || index >= CAD_MAX_POLYGONS) return NULL;
+int CadFile_GetPointPosition(const CadFileData* data, CadIndex index, double* x, double* y, double* z) {
+    if (!data || index < 0 || index >= data->pointCount) return 0;
+    if (x) *x = data->pointX[index];
+    if (y) *y = data->pointY[index];
+    if (z) *z = data->pointZ[index];
+    return 1;
+}
+
+int CadFile_SetPointPosition(CadFileData* data, CadIndex index, double x, double y, double z) {
+    if (!data || index < 0 || index >= data->pointCount) return 0;
+    data->pointX[index] = x;
+    data->pointY[index] = y;
+    data->pointZ[index] = z;
+    return 1;
+}
+
+CadPolygon* CadFile_GetPolygon(CadFileData* data, CadIndex index) {
+    if (!data || index < 0 || index >= data->polygonCount) return NULL;
     return &data->polygons[index];
 }
 
-CadObject* CadFile_GetObject(CadFileData* data, int16_t index) {
-    if (!data || index < 0 || index >= CAD_MAX_OBJECTS) return NULL;
+CadObject* CadFile_GetObject(CadFileData* data, CadIndex index) {
+    if (!data || index < 0 || index >= data->objectCount) return NULL;
     return &data->objects[index];
 }
 
@@ -90,7 +244,7 @@ int CadFile_Load(const char* filename, CadFileData* data) {
         return 0;
     }
     
-    CadFile_Init(data);
+    CadFile_Clear(data);
     
     uint8_t tag;
     int16_t index;
@@ -126,9 +280,9 @@ int CadFile_Load(const char* filename, CadFileData* data) {
             if (data->objectCount < 5) {
                 fprintf(stdout, "Debug: Object tag, index=%d (0x%04X) at byte %zu\n", index, (unsigned short)index, bytes_read);
             }
-            if (index >= 0 && index < CAD_MAX_OBJECTS) {
-                CadObject temp_obj;
-                if (fread(&temp_obj, sizeof(CadObject), 1, fp) != 1) {
+            if (index >= 0 && CadFile_Reserve(data, index + 1, 0, 0)) {
+                CadObjectRecord temp_obj;
+                if (fread(&temp_obj, sizeof(CadObjectRecord), 1, fp) != 1) {
                     fprintf(stderr, "Error: Failed to read object data for index %d (at byte %zu)\n", index, bytes_read);
                     fclose(fp);
                     return 0;
@@ -143,12 +297,21 @@ int CadFile_Load(const char* filename, CadFileData* data) {
                     temp_obj.offsety = swap_double(temp_obj.offsety);
                     temp_obj.offsetz = swap_double(temp_obj.offsetz);
                 }
-                data->objects[index] = temp_obj;
+                CadObject* obj = &data->objects[index];
+                obj->flags = temp_obj.flags;
+                obj->selectFlag = temp_obj.selectFlag;
+                obj->parentObject = temp_obj.parentObject;
+                obj->nextBrother = temp_obj.nextBrother;
+                obj->childObject = temp_obj.childObject;
+                obj->firstPolygon = temp_obj.firstPolygon;
+                obj->offsetx = temp_obj.offsetx;
+                obj->offsety = temp_obj.offsety;
+                obj->offsetz = temp_obj.offsetz;
                 if (index >= data->objectCount) data->objectCount = index + 1;
             } else {
-                fprintf(stderr, "Warning: Object index %d out of bounds (0-%d), skipping\n", index, CAD_MAX_OBJECTS - 1);
+                fprintf(stderr, "Warning: Object index %d out of bounds (0-%d), skipping\n", index, CAD_FILE_MAX_INDEX);
                 /* Skip the data for this invalid index */
-                fseek(fp, sizeof(CadObject), SEEK_CUR);
+                fseek(fp, sizeof(CadObjectRecord), SEEK_CUR);
             }
             break;
             
@@ -162,35 +325,9 @@ int CadFile_Load(const char* filename, CadFileData* data) {
             if (is_little_endian()) {
                 index = swap_int16(index);
             }
-            /* The file format appears to store indices as byte offsets from base address */
-            /* Convert byte offset to array index */
-            int actual_index = -1;
-            
-            /* Check if it's a valid direct index first */
-            if (index >= 0 && index < CAD_MAX_POLYGONS) {
-                actual_index = index;
-            } else {
-                /* Try interpreting as byte offset - divide by structure size */
-                /* CadPolygon is typically 16 bytes with alignment */
-                const int poly_size = sizeof(CadPolygon);
-                if (index > 0 && (index % poly_size) == 0) {
-                    actual_index = index / poly_size;
-                    if (actual_index >= CAD_MAX_POLYGONS) {
-                        actual_index = -1; /* Still out of bounds */
-                    }
-                } else {
-                    /* Try as unsigned 16-bit value */
-                    uint16_t uindex = (uint16_t)index;
-                    if (uindex < CAD_MAX_POLYGONS) {
-                        actual_index = uindex;
-                    }
-                }
-            }
-            
-            if (actual_index >= 0 && actual_index < CAD_MAX_POLYGONS) {
-                index = actual_index;
-                CadPolygon temp_poly;
-                if (fread(&temp_poly, sizeof(CadPolygon), 1, fp) != 1) {
+            if (index >= 0 && CadFile_Reserve(data, 0, index + 1, 0)) {
+                CadPolygonRecord temp_poly;
+                if (fread(&temp_poly, sizeof(CadPolygonRecord), 1, fp) != 1) {
                     fprintf(stderr, "Error: Failed to read polygon data for index %d (at byte %zu)\n", index, bytes_read);
                     fclose(fp);
                     return 0;
@@ -202,12 +339,21 @@ int CadFile_Load(const char* filename, CadFileData* data) {
                     temp_poly.animation = swap_int16(temp_poly.animation);
                     temp_poly.both = swap_int16(temp_poly.both);
                 }
-                data->polygons[index] = temp_poly;
+                CadPolygon* poly = &data->polygons[index];
+                poly->flags = temp_poly.flags;
+                poly->selectFlag = temp_poly.selectFlag;
+                poly->nextPolygon = temp_poly.nextPolygon;
+                poly->firstPoint = temp_poly.firstPoint;
+                poly->animation = temp_poly.animation;
+                poly->both = temp_poly.both;
+                poly->side = temp_poly.side;
+                poly->color = temp_poly.color;
+                poly->npoints = temp_poly.npoints;
                 if (index >= data->polygonCount) data->polygonCount = index + 1;
             } else {
-                fprintf(stderr, "Warning: Polygon index %d out of bounds (0-%d), skipping\n", index, CAD_MAX_POLYGONS - 1);
+                fprintf(stderr, "Warning: Polygon index %d out of bounds (0-%d), skipping\n", index, CAD_FILE_MAX_INDEX);
                 /* Skip the data for this invalid index */
-                fseek(fp, sizeof(CadPolygon), SEEK_CUR);
+                fseek(fp, sizeof(CadPolygonRecord), SEEK_CUR);
             }
             break;
         }
@@ -222,35 +368,9 @@ int CadFile_Load(const char* filename, CadFileData* data) {
             if (is_little_endian()) {
                 index = swap_int16(index);
             }
-            /* The file format appears to store indices as byte offsets from base address */
-            /* Convert byte offset to array index */
-            int actual_index = -1;
-            
-            /* Check if it's a valid direct index first */
-            if (index >= 0 && index < CAD_MAX_POINTS) {
-                actual_index = index;
-            } else {
-                /* Try interpreting as byte offset - divide by structure size */
-                /* CadPoint is typically 32 bytes with alignment (2+2+2+8+8+8 = 30, aligned to 32) */
-                const int point_size = sizeof(CadPoint);
-                if (index > 0 && (index % point_size) == 0) {
-                    actual_index = index / point_size;
-                    if (actual_index >= CAD_MAX_POINTS) {
-                        actual_index = -1; /* Still out of bounds */
-                    }
-                } else {
-                    /* Try as unsigned 16-bit value */
-                    uint16_t uindex = (uint16_t)index;
-                    if (uindex < CAD_MAX_POINTS) {
-                        actual_index = uindex;
-                    }
-                }
-            }
-            
-            if (actual_index >= 0 && actual_index < CAD_MAX_POINTS) {
-                index = actual_index;
-                CadPoint temp_point;
-                if (fread(&temp_point, sizeof(CadPoint), 1, fp) != 1) {
+            if (index >= 0 && CadFile_Reserve(data, 0, 0, index + 1)) {
+                CadPointRecord temp_point;
+                if (fread(&temp_point, sizeof(CadPointRecord), 1, fp) != 1) {
                     fprintf(stderr, "Error: Failed to read point data for index %d (at byte %zu)\n", index, bytes_read);
                     fclose(fp);
                     return 0;
@@ -262,12 +382,20 @@ int CadFile_Load(const char* filename, CadFileData* data) {
                     temp_point.pointy = swap_double(temp_point.pointy);
                     temp_point.pointz = swap_double(temp_point.pointz);
                 }
-                data->points[index] = temp_point;
+                CadPoint* pt = &data->points[index];
+                pt->flags = temp_point.flags;
+                pt->selectFlag = temp_point.selectFlag;
+                pt->nextPoint = temp_point.nextPoint;
+                /* Unused slots keep zero coordinates */
+                int live = temp_point.flags != 0;
+                data->pointX[index] = live ? temp_point.pointx : 0.0;
+                data->pointY[index] = live ? temp_point.pointy : 0.0;
+                data->pointZ[index] = live ? temp_point.pointz : 0.0;
                 if (index >= data->pointCount) data->pointCount = index + 1;
             } else {
-                fprintf(stderr, "Warning: Point index %d out of bounds (0-%d), skipping\n", index, CAD_MAX_POINTS - 1);
+                fprintf(stderr, "Warning: Point index %d out of bounds (0-%d), skipping\n", index, CAD_FILE_MAX_INDEX);
                 /* Skip the data for this invalid index */
-                fseek(fp, sizeof(CadPoint), SEEK_CUR);
+                fseek(fp, sizeof(CadPointRecord), SEEK_CUR);
             }
             break;
         }
@@ -296,12 +424,57 @@ int CadFile_Load(const char* filename, CadFileData* data) {
     return 1;
 }
 
+/* Check that a link fits the int16 on-disk format (-1 = none) */
+static int link_fits_file(CadIndex link) {
+    return link >= -1 && link <= CAD_FILE_MAX_INDEX;
+}
+
+/* Verify every live record and link can be stored as int16 before writing */
+static int check_file_limits(const CadFileData* data) {
+    for (int i = 0; i < data->objectCount; i++) {
+        const CadObject* obj = &data->objects[i];
+        if (obj->flags == 0) continue;
+        if (i > CAD_FILE_MAX_INDEX || !link_fits_file(obj->parentObject) ||
+            !link_fits_file(obj->nextBrother) || !link_fits_file(obj->childObject) ||
+            !link_fits_file(obj->firstPolygon)) {
+            fprintf(stderr, "Error: Object %d does not fit the .cad format (indices are limited to %d)\n",
+                    i, CAD_FILE_MAX_INDEX);
+            return 0;
+        }
+    }
+    for (int i = 0; i < data->polygonCount; i++) {
+        const CadPolygon* poly = &data->polygons[i];
+        if (poly->flags == 0) continue;
+        if (i > CAD_FILE_MAX_INDEX || !link_fits_file(poly->nextPolygon) ||
+            !link_fits_file(poly->firstPoint) || !link_fits_file(poly->both)) {
+            fprintf(stderr, "Error: Polygon %d does not fit the .cad format (indices are limited to %d)\n",
+                    i, CAD_FILE_MAX_INDEX);
+            return 0;
+        }
+    }
+    for (int i = 0; i < data->pointCount; i++) {
+        const CadPoint* pt = &data->points[i];
+        if (pt->flags == 0) continue;
+        if (i > CAD_FILE_MAX_INDEX || !link_fits_file(pt->nextPoint)) {
+            fprintf(stderr, "Error: Point %d does not fit the .cad format (indices are limited to %d)\n",
+                    i, CAD_FILE_MAX_INDEX);
+            return 0;
+        }
+    }
+    return 1;
+}
+
 int CadFile_Save(const char* filename, const CadFileData* data) {
     if (!filename || !data) {
         fprintf(stderr, "Error: Invalid parameters to CadFile_Save\n");
         return 0;
     }
     
+    /* Refuse before opening so an existing file is not truncated */
+    if (!check_file_limits(data)) {
+        return 0;
+    }
+    
     /* Convert UTF-8 filename to wide string for Windows */
     wchar_t wfilename[MAX_PATH * 2] = {0};
     int wlen = MultiByteToWideChar(CP_UTF8, 0, filename, -1, wfilename, sizeof(wfilename) / sizeof(wfilename[0]));
@@ -330,8 +503,19 @@ int CadFile_Save(const char* filename, const CadFileData* data) {
             fwrite(&tag, sizeof(uint8_t), 1, fp);
             fwrite(&index, sizeof(int16_t), 1, fp);
             
-            /* Convert object to big-endian and write */
-            CadObject obj = data->objects[i];
+            /* Convert object to the on-disk record (big-endian) and write */
+            const CadObject* src = &data->objects[i];
+            CadObjectRecord obj;
+            memset(&obj, 0, sizeof(obj));
+            obj.flags = src->flags;
+            obj.selectFlag = src->selectFlag;
+            obj.parentObject = (int16_t)src->parentObject;
+            obj.nextBrother = (int16_t)src->nextBrother;
+            obj.childObject = (int16_t)src->childObject;
+            obj.firstPolygon = (int16_t)src->firstPolygon;
+            obj.offsetx = src->offsetx;
+            obj.offsety = src->offsety;
+            obj.offsetz = src->offsetz;
             if (is_little_endian()) {
                 obj.parentObject = swap_int16(obj.parentObject);
                 obj.nextBrother = swap_int16(obj.nextBrother);
@@ -341,7 +525,7 @@ int CadFile_Save(const char* filename, const CadFileData* data) {
                 obj.offsety = swap_double(obj.offsety);
                 obj.offsetz = swap_double(obj.offsetz);
             }
-            fwrite(&obj, sizeof(CadObject), 1, fp);
+            fwrite(&obj, sizeof(CadObjectRecord), 1, fp);
         }
     }
     
@@ -359,15 +543,26 @@ int CadFile_Save(const char* filename, const CadFileData* data) {
             fwrite(&tag, sizeof(uint8_t), 1, fp);
             fwrite(&index, sizeof(int16_t), 1, fp);
             
-            /* Convert polygon to big-endian and write */
-            CadPolygon poly = data->polygons[i];
+            /* Convert polygon to the on-disk record (big-endian) and write */
+            const CadPolygon* src = &data->polygons[i];
+            CadPolygonRecord poly;
+            memset(&poly, 0, sizeof(poly));
+            poly.flags = src->flags;
+            poly.selectFlag = src->selectFlag;
+            poly.nextPolygon = (int16_t)src->nextPolygon;
+            poly.firstPoint = (int16_t)src->firstPoint;
+            poly.animation = src->animation;
+            poly.both = (int16_t)src->both;
+            poly.side = src->side;
+            poly.color = src->color;
+            poly.npoints = src->npoints;
             if (is_little_endian()) {
                 poly.nextPolygon = swap_int16(poly.nextPolygon);
                 poly.firstPoint = swap_int16(poly.firstPoint);
                 poly.animation = swap_int16(poly.animation);
                 poly.both = swap_int16(poly.both);
             }
-            fwrite(&poly, sizeof(CadPolygon), 1, fp);
+            fwrite(&poly, sizeof(CadPolygonRecord), 1, fp);
         }
     }
     
@@ -385,15 +580,23 @@ int CadFile_Save(const char* filename, const CadFileData* data) {
             fwrite(&tag, sizeof(uint8_t), 1, fp);
             fwrite(&index, sizeof(int16_t), 1, fp);
             
-            /* Convert point to big-endian and write */
-            CadPoint pt = data->points[i];
+            /* Convert point to the on-disk record (big-endian) and write */
+            const CadPoint* src = &data->points[i];
+            CadPointRecord pt;
+            memset(&pt, 0, sizeof(pt));
+            pt.flags = src->flags;
+            pt.selectFlag = src->selectFlag;
+            pt.nextPoint = (int16_t)src->nextPoint;
+            pt.pointx = data->pointX[i];
+            pt.pointy = data->pointY[i];
+            pt.pointz = data->pointZ[i];
             if (is_little_endian()) {
                 pt.nextPoint = swap_int16(pt.nextPoint);
                 pt.pointx = swap_double(pt.pointx);
                 pt.pointy = swap_double(pt.pointy);
                 pt.pointz = swap_double(pt.pointz);
             }
-            fwrite(&pt, sizeof(CadPoint), 1, fp);
+            fwrite(&pt, sizeof(CadPointRecord), 1, fp);
         }
     }
     
@@ -36,6 +36,7 @@ void CadView_Init(CadView* view, CadViewType type) {
     view->rot_x = 0.0;
     view->rot_y = 0.0;
     view->wireframe = 1; /* Default to wireframe */
+    view->flat_highlight = 0.0;
 }
 
 void CadView_Reset(CadView* view) {
@@ -98,60 +99,244 @@ void CadView_Pan3DVertical(CadView* view, double dy) {
    3D to 2D projection
    ---------------------------------------------------------------------------- */
 
+/* Per-call projection constants (trig evaluated once, not per point) */
+typedef struct {
+    CadViewType type;
+    double cos_rx, sin_rx;
+    double cos_ry, sin_ry;
+    double zoom, pan_x, pan_y;
+    int half_w, half_h;
+} ViewProjection;
+
+static void setup_projection(ViewProjection* vp, const CadView* view, int viewport_w, int viewport_h) {
+    double rx = view->rot_x * M_PI / 180.0;
+    double ry = view->rot_y * M_PI / 180.0;
+    vp->type = view->type;
+    vp->cos_rx = cos(rx);
+    vp->sin_rx = sin(rx);
+    vp->cos_ry = cos(ry);
+    vp->sin_ry = sin(ry);
+    vp->zoom = view->zoom;
+    vp->pan_x = view->pan_x;
+    vp->pan_y = view->pan_y;
+    vp->half_w = viewport_w / 2;
+    vp->half_h = viewport_h / 2;
+}
+
+/* Project 'count' points from SoA coordinate arrays.
+   out_depth may be NULL when only screen positions are needed. */
+static void project_arrays(const ViewProjection* vp,
+                           const double* xs, const double* ys, const double* zs, int count,
+                           int* out_x, int* out_y, double* out_depth) {
+    const double zoom = vp->zoom, pan_x = vp->pan_x, pan_y = vp->pan_y;
+    const int half_w = vp->half_w, half_h = vp->half_h;
+    
+    if (vp->type == CAD_VIEW_3D) {
+        const double crx = vp->cos_rx, srx = vp->sin_rx;
+        const double cry = vp->cos_ry, sry = vp->sin_ry;
+        for (int i = 0; i < count; i++) {
+            double x = xs[i], y = ys[i], z = zs[i];
+            
+            /* Rotate around X axis, then around Y axis */
+            double y1 = y * crx - z * srx;
+            double z1 = y * srx + z * crx;
+            double px = x * cry + z1 * sry;
+            double pz = -x * sry + z1 * cry;
+            
+            out_x[i] = (int)(half_w + (px * zoom + pan_x));
+            out_y[i] = (int)(half_h - (y1 * zoom + pan_y)); /* Flip Y for screen coordinates */
+            if (out_depth) out_depth[i] = pz;
+        }
+        return;
+    }
+    
+    /* Orthographic projections pick one array per screen axis */
+    const double* hs;  /* horizontal */
+    const double* vs;  /* vertical */
+    const double* ds;  /* depth */
+    double v_sign = 1.0, d_sign = 1.0;
+    switch (vp->type) {
+    case CAD_VIEW_TOP:
+        hs = xs; vs = zs; ds = ys;  /* Y becomes depth */
+        v_sign = -1.0;
+        break;
+    case CAD_VIEW_RIGHT:
+        hs = zs; vs = ys; ds = xs;  /* X is depth (negative, looking from right) */
+        d_sign = -1.0;
+        break;
+    case CAD_VIEW_FRONT:
+    default:
+        hs = xs; vs = ys; ds = zs;  /* Z is depth */
+        break;
+    }
+    for (int i = 0; i < count; i++) {
+        out_x[i] = (int)(half_w + (hs[i] * zoom + pan_x));
+        out_y[i] = (int)(half_h - (v_sign * vs[i] * zoom + pan_y));
+        if (out_depth) out_depth[i] = d_sign * ds[i];
+    }
+}
+
 void CadView_ProjectPoint(const CadView* view, double x, double y, double z, 
                          int* out_x, int* out_y, int viewport_w, int viewport_h) {
     if (!view || !out_x || !out_y) return;
     
-    double px, py, pz;
+    ViewProjection vp;
+    setup_projection(&vp, view, viewport_w, viewport_h);
+    project_arrays(&vp, &x, &y, &z, 1, out_x, out_y, NULL);
+}
+
+void CadView_ProjectPoints(const CadView* view, const CadFileData* data, int first, int count,
+                           int* out_x, int* out_y, double* out_depth,
+                           int viewport_w, int viewport_h) {
+    if (!view || !data || !out_x || !out_y || first < 0 || count <= 0) return;
+    if (first + count > data->pointCount) return;
     
-    /* Apply rotation for 3D view */
-    if (view->type == CAD_VIEW_3D) {
-        double rx = view->rot_x * M_PI / 180.0;
-        double ry = view->rot_y * M_PI / 180.0;
-        
-        /* Rotate around X axis */
-        double y1 = y * cos(rx) - z * sin(rx);
-        double z1 = y * sin(rx) + z * cos(rx);
-        
-        /* Rotate around Y axis */
-        px = x * cos(ry) + z1 * sin(ry);
-        py = y1;
-        pz = -x * sin(ry) + z1 * cos(ry);
-    } else {
-        /* Orthographic projections */
-        switch (view->type) {
-        case CAD_VIEW_TOP:
-            px = x;
-            py = -z;  /* Y becomes depth */
-            pz = y;
-            break;
-        case CAD_VIEW_FRONT:
-            /* Front view: looking from front, X is left/right, Y is up/down, Z is depth */
-            px = x;  /* X is horizontal (left/right) */
-            py = y;  /* Y is vertical (up/down, flipped) */
-            pz = z;  /* Z is depth */
-            break;
-        case CAD_VIEW_RIGHT:
-            /* Right view: looking from right, Z is forward/back, Y is up/down, X is depth */
-            px = z;  /* Z becomes horizontal (forward/back) */
-            py = y;  /* Y is vertical (up/down, flipped) */
-            pz = -x; /* X is depth (negative because we're looking from right) */
-            break;
-        default:
-            px = x;
-            py = y;
-            pz = z;
+    ViewProjection vp;
+    setup_projection(&vp, view, viewport_w, viewport_h);
+    project_arrays(&vp, data->pointX + first, data->pointY + first, data->pointZ + first,
+                   count, out_x, out_y, out_depth);
+}
+
+void CadView_GetEyePosition(const CadView* view, double distance, double eye[3]) {
+    eye[0] = eye[1] = eye[2] = 0.0;
+    if (!view) return;
+    
+    /* The depth axis of project_arrays, scaled */
+    ViewProjection vp;
+    setup_projection(&vp, view, 0, 0);
+    switch (vp.type) {
+    case CAD_VIEW_3D:
+        eye[0] = -vp.sin_ry * distance;
+        eye[1] = vp.sin_rx * vp.cos_ry * distance;
+        eye[2] = vp.cos_rx * vp.cos_ry * distance;
+        break;
+    case CAD_VIEW_TOP:
+        eye[1] = distance;
+        break;
+    case CAD_VIEW_RIGHT:
+        eye[0] = -distance;
+        break;
+    case CAD_VIEW_FRONT:
+    default:
+        eye[2] = distance;
+        break;
+    }
+}
+
+/* Screen positions of every point, cached per view. Points are projected
+   from their world positions (see CadCore_GetWorldPoints). An entry is
+   reused as long as the view parameters, the viewport and the point,
+   object and face-grouping generations it was projected from are
+   unchanged, so idle frames and picks between edits skip the projection
+   pass. */
+#define PROJ_CACHE_SLOTS 4
+
+typedef struct {
+    const CadView* owner;
+    CadView params;
+    const CadCore* core;
+    int viewport_w, viewport_h;
+    int count;
+    int has_depth;
+    uint32_t geometry;
+    uint32_t topology;
+    uint32_t objectGeometry;
+    uint32_t objectTopology;
+    uint32_t polygonTopology;
+    int* x;
+    int* y;
+    double* depth;
+    int capacity;
+} ProjectionCache;
+
+static ProjectionCache s_proj_cache[PROJ_CACHE_SLOTS];
+static int s_proj_evict;
+
+/* Arrays of the entry selected by the last project_all_points call */
+static int*    s_proj_x;
+static int*    s_proj_y;
+static double* s_proj_depth;
+
+static int same_view_params(const CadView* a, const CadView* b) {
+    return a->type == b->type && a->zoom == b->zoom &&
+           a->pan_x == b->pan_x && a->pan_y == b->pan_y &&
+           a->rot_x == b->rot_x && a->rot_y == b->rot_y;
+}
+
+static int project_all_points(const CadView* view, const CadCore* core,
+                              int viewport_w, int viewport_h, int with_depth) {
+    const CadFileData* data = &core->data;
+    ProjectionCache* entry = NULL;
+    for (int i = 0; i < PROJ_CACHE_SLOTS; i++) {
+        if (s_proj_cache[i].owner == view) {
+            entry = &s_proj_cache[i];
             break;
         }
     }
+    if (!entry) {
+        entry = &s_proj_cache[s_proj_evict];
+        s_proj_evict = (s_proj_evict + 1) % PROJ_CACHE_SLOTS;
+        entry->owner = view;
+        entry->core = NULL; /* Force a projection pass */
+    }
+    
+    int n = data->pointCount;
+    if (entry->core == core && entry->count == n &&
+        entry->viewport_w == viewport_w && entry->viewport_h == viewport_h &&
+        (entry->has_depth || !with_depth) &&
+        entry->geometry == core->changes.points.geometry &&
+        entry->topology == core->changes.points.topology &&
+        entry->objectGeometry == core->changes.objects.geometry &&
+        entry->objectTopology == core->changes.objects.topology &&
+        entry->polygonTopology == core->changes.polygons.topology &&
+        same_view_params(&entry->params, view)) {
+        s_proj_x = entry->x;
+        s_proj_y = entry->y;
+        s_proj_depth = entry->depth;
+        return 1;
+    }
     
-    /* Apply zoom and pan */
-    px = px * view->zoom + view->pan_x;
-    py = py * view->zoom + view->pan_y;
+    if (n > entry->capacity) {
+        int capacity = entry->capacity > 0 ? entry->capacity : 256;
+        while (capacity < n) capacity *= 2;
+        int* px = (int*)realloc(entry->x, (size_t)capacity * sizeof(int));
+        if (px) entry->x = px;
+        int* py = (int*)realloc(entry->y, (size_t)capacity * sizeof(int));
+        if (py) entry->y = py;
+        double* pd = (double*)realloc(entry->depth, (size_t)capacity * sizeof(double));
+        if (pd) entry->depth = pd;
+        if (!px || !py || !pd) {
+            entry->core = NULL;
+            return 0;
+        }
+        entry->capacity = capacity;
+    }
+    const double *wx, *wy, *wz;
+    if (!CadCore_GetWorldPoints(core, &wx, &wy, &wz)) {
+        entry->core = NULL;
+        return 0;
+    }
+    if (n > 0) {
+        ViewProjection vp;
+        setup_projection(&vp, view, viewport_w, viewport_h);
+        project_arrays(&vp, wx, wy, wz, n, entry->x, entry->y, with_depth ? entry->depth : NULL);
+    }
+    entry->params = *view;
+    entry->core = core;
+    entry->viewport_w = viewport_w;
+    entry->viewport_h = viewport_h;
+    entry->count = n;
+    entry->has_depth = with_depth;
+    entry->geometry = core->changes.points.geometry;
+    entry->topology = core->changes.points.topology;
+    entry->objectGeometry = core->changes.objects.geometry;
+    entry->objectTopology = core->changes.objects.topology;
+    entry->polygonTopology = core->changes.polygons.topology;
     
-    /* Convert to viewport coordinates (center origin) */
-    *out_x = (int)(viewport_w / 2 + px);
-    *out_y = (int)(viewport_h / 2 - py); /* Flip Y for screen coordinates */
+    s_proj_x = entry->x;
+    s_proj_y = entry->y;
+    s_proj_depth = entry->depth;
+    return 1;
 }
 
 /* ----------------------------------------------------------------------------
@@ -199,16 +384,22 @@ void CadView_Render(const CadView* view, const CadCore* core,
 
     const CadFileData* data = &core->data;
 
+    /* Project every point once for this viewport; faces index the results */
+    if (!project_all_points(view, core, viewport_w, viewport_h, !view->wireframe)) return;
+
+    /* Faces read their vertex lists from the flattened polygon index */
+    const CadPolygonIndex* index = CadCore_GetPolygonIndex(core);
+    if (!index) return;
+
     /* -----------------------------
        Wireframe mode: just draw 2D edges and bail
        ----------------------------- */
     if (view->wireframe) {
-        for (int i = 0; i < data->polygonCount; i++) {
-            CadPolygon* poly = CadCore_GetPolygon((CadCore*)core, i);
-            if (!poly || poly->flags == 0) continue;
+        for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
+            CadPolygon* poly = &data->polygons[i];
 
-            int16_t point_idx = poly->firstPoint;
-            if (point_idx < 0 || point_idx >= CAD_MAX_POINTS) continue;
+            CadIndex point_idx = poly->firstPoint;
+            if (point_idx < 0 || point_idx >= data->pointCount) continue;
             if (poly->npoints < 2) continue;
 
             #define MAX_STACK_POINTS 64
@@ -233,41 +424,25 @@ void CadView_Render(const CadView* view, const CadCore* core,
                 }
             }
 
-            int16_t current = point_idx;
             int count = 0;
-            int16_t visited[64]; /* Track visited points to detect cycles (smaller array) */
-            int visited_count = 0;
-            
-            while (current >= 0 && current < CAD_MAX_POINTS && count < npoints) {
-                /* Check for cycles (only check if we have room to track) */
-                if (visited_count < 64) {
-                    int already_visited = 0;
-                    for (int v = 0; v < visited_count; v++) {
-                        if (visited[v] == current) {
-                            already_visited = 1;
-                            break;
-                        }
-                    }
-                    if (already_visited) break;
-                    visited[visited_count++] = current;
-                }
-                
-                CadPoint* pt = CadCore_GetPoint((CadCore*)core, current);
-                if (!pt || pt->flags == 0) break; /* Invalid point */
-
-                CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz,
-                                     &x_coords[count], &y_coords[count], viewport_w, viewport_h);
-
-                current = pt->nextPoint;
+            for (CadIndex v = index->offsets[i]; v < index->offsets[i + 1] && count < npoints; v++) {
+                CadIndex current = index->vertices[v];
+                x_coords[count] = s_proj_x[current];
+                y_coords[count] = s_proj_y[current];
                 count++;
-                if (count > 1000) break; /* Safety limit */
             }
 
             if (count >= 2) {
                 RG_Color black = { 0, 0, 0, 255 };
+                RG_Color warped = { 0xE0, 0x30, 0x30, 255 }; /* Flat Check: non-planar face */
+                RG_Color color = black;
+                if (view->flat_highlight > 0.0 && count >= 4 &&
+                    CadCore_GetPolygonDeviation(core, i) > view->flat_highlight) {
+                    color = warped;
+                }
                 for (int j = 0; j < count; j++) {
                     int next = (j + 1) % count;
-                    rg_line(x_coords[j], y_coords[j], x_coords[next], y_coords[next], black);
+                    rg_line(x_coords[j], y_coords[j], x_coords[next], y_coords[next], color);
                 }
             }
 
@@ -278,10 +453,7 @@ void CadView_Render(const CadView* view, const CadCore* core,
         }
 
         /* Render all points: selected = red, orphaned = blue */
-        for (int i = 0; i < core->data.pointCount; i++) {
-            CadPoint* pt = CadCore_GetPoint((CadCore*)core, i);
-            if (!pt || pt->flags == 0) continue;
-            
+        for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
             /* Check if point is selected */
             int is_selected = CadCore_IsPointSelected((CadCore*)core, i);
             
@@ -290,8 +462,8 @@ void CadView_Render(const CadView* view, const CadCore* core,
             
             /* Only render selected points (red) or orphaned points (blue) */
             if (is_selected || !is_connected) {
-                int x, y;
-                CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz, &x, &y, viewport_w, viewport_h);
+                int x = s_proj_x[i];
+                int y = s_proj_y[i];
                 
                 RG_Color color;
                 if (is_selected) {
@@ -364,16 +536,16 @@ void CadView_Render(const CadView* view, const CadCore* core,
     /* Polygon color: #AAAAAA */
     RG_Color poly_gray = { 0xAA, 0xAA, 0xAA, 255 };
     RG_Color edge_color = { 0x66, 0x66, 0x66, 255 };
+    RG_Color warped_color = { 0xE0, 0x60, 0x60, 255 }; /* Flat Check: non-planar face */
 
     /* -----------------------------
        Draw polygons (solid)
        ----------------------------- */
-    for (int i = 0; i < data->polygonCount; i++) {
-        CadPolygon* poly = CadCore_GetPolygon((CadCore*)core, i);
-        if (!poly || poly->flags == 0) continue;
+    for (CadIndex i = CadCore_NextLivePolygon(core, 0); i >= 0; i = CadCore_NextLivePolygon(core, i + 1)) {
+        CadPolygon* poly = &data->polygons[i];
 
-        int16_t point_idx = poly->firstPoint;
-        if (point_idx < 0 || point_idx >= CAD_MAX_POINTS) continue;
+        CadIndex point_idx = poly->firstPoint;
+        if (point_idx < 0 || point_idx >= data->pointCount) continue;
         if (poly->npoints < 2) continue;
 
         #define MAX_STACK_POINTS 64
@@ -404,55 +576,15 @@ void CadView_Render(const CadView* view, const CadCore* core,
             }
         }
 
-        int16_t current = point_idx;
         int count = 0;
-        int16_t visited[64]; /* Track visited points to detect cycles (smaller array) */
-        int visited_count = 0;
-
-        while (current >= 0 && current < CAD_MAX_POINTS && count < npoints) {
-            /* Check for cycles (only check if we have room to track) */
-            if (visited_count < 64) {
-                int already_visited = 0;
-                for (int v = 0; v < visited_count; v++) {
-                    if (visited[v] == current) {
-                        already_visited = 1;
-                        break;
-                    }
-                }
-                if (already_visited) break;
-                visited[visited_count++] = current;
-            }
-            
-            CadPoint* pt = CadCore_GetPoint((CadCore*)core, current);
-            if (!pt || pt->flags == 0) break; /* Invalid point */
-
-            CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz,
-                                 &x_coords[count], &y_coords[count], viewport_w, viewport_h);
-
-            /* View-space-ish depth (your existing approach) */
-            double px, py, pz;
-            if (view->type == CAD_VIEW_3D) {
-                double rx = view->rot_x * M_PI / 180.0;
-                double ry = view->rot_y * M_PI / 180.0;
-                double y1 = pt->pointy * cos(rx) - pt->pointz * sin(rx);
-                double z1 = pt->pointy * sin(rx) + pt->pointz * cos(rx);
-                px = pt->pointx * cos(ry) + z1 * sin(ry);
-                py = y1;
-                pz = -pt->pointx * sin(ry) + z1 * cos(ry);
-            } else {
-                switch (view->type) {
-                case CAD_VIEW_TOP:   px = pt->pointx; py = -pt->pointz; pz = pt->pointy;  break;
-                case CAD_VIEW_FRONT: px = pt->pointx; py = -pt->pointy; pz = pt->pointz;  break;
-                case CAD_VIEW_RIGHT: px = pt->pointz; py = -pt->pointy; pz = -pt->pointx; break;
-                default:             px = pt->pointx; py = pt->pointy;  pz = pt->pointz;  break;
-                }
-            }
+        for (CadIndex v = index->offsets[i]; v < index->offsets[i + 1] && count < npoints; v++) {
+            CadIndex current = index->vertices[v];
+            x_coords[count] = s_proj_x[current];
+            y_coords[count] = s_proj_y[current];
 
-            z_coords[count] = pz;
-
-            current = pt->nextPoint;
+            /* View-space depth from the projection pass */
+            z_coords[count] = s_proj_depth[current];
             count++;
-            if (count > 1000) break;
         }
 
         if (count == 2) {
@@ -497,7 +629,12 @@ void CadView_Render(const CadView* view, const CadCore* core,
             }
 
             glNormal3d(nx, ny, nz);
-            glColor4ub(poly_gray.r, poly_gray.g, poly_gray.b, poly_gray.a);
+            if (view->flat_highlight > 0.0 && count >= 4 &&
+                CadCore_GetPolygonDeviation(core, i) > view->flat_highlight) {
+                glColor4ub(warped_color.r, warped_color.g, warped_color.b, warped_color.a);
+            } else {
+                glColor4ub(poly_gray.r, poly_gray.g, poly_gray.b, poly_gray.a);
+            }
 
             glBegin(GL_POLYGON);
             for (int j = 0; j < count; j++) {
@@ -555,10 +692,7 @@ void CadView_Render(const CadView* view, const CadCore* core,
     glLoadIdentity();
 
     /* Render all points: selected = red, orphaned = blue */
-    for (int i = 0; i < core->data.pointCount; i++) {
-        CadPoint* pt = CadCore_GetPoint((CadCore*)core, i);
-        if (!pt || pt->flags == 0) continue;
-        
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
         /* Check if point is selected */
         int is_selected = CadCore_IsPointSelected((CadCore*)core, i);
         
@@ -567,8 +701,8 @@ void CadView_Render(const CadView* view, const CadCore* core,
         
         /* Only render selected points (red) or orphaned points (blue) */
         if (is_selected || !is_connected) {
-            int x, y;
-            CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz, &x, &y, viewport_w, viewport_h);
+            int x = s_proj_x[i];
+            int y = s_proj_y[i];
             
             RG_Color color;
             if (is_selected) {
@@ -602,7 +736,7 @@ void CadView_Render(const CadView* view, const CadCore* core,
    Point selection - find nearest point to screen coordinates
    ---------------------------------------------------------------------------- */
 
-int16_t CadView_FindNearestPoint(const CadView* view, const CadCore* core,
+CadIndex CadView_FindNearestPoint(const CadView* view, const CadCore* core,
                                  int screen_x, int screen_y,
                                  int viewport_x, int viewport_y,
                                  int viewport_w, int viewport_h,
@@ -619,26 +753,21 @@ int16_t CadView_FindNearestPoint(const CadView* view, const CadCore* core,
     }
     
     /* Find nearest point by projecting all points and finding closest in screen space */
-    int16_t nearest_idx = -1;
+    CadIndex nearest_idx = -1;
     double nearest_dist_sq = (double)(threshold_pixels * threshold_pixels);
     
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags == 0) continue; /* Skip invalid points */
-        
-        /* Project point to screen coordinates (CadView_ProjectPoint already applies zoom/pan) */
-        int proj_x, proj_y;
-        CadView_ProjectPoint(view, pt->pointx, pt->pointy, pt->pointz, 
-                            &proj_x, &proj_y, viewport_w, viewport_h);
-        
+    /* Project all points in one pass (applies zoom/pan) */
+    if (!project_all_points(view, core, viewport_w, viewport_h, 0)) return -1;
+    
+    for (CadIndex i = CadCore_NextLivePoint(core, 0); i >= 0; i = CadCore_NextLivePoint(core, i + 1)) {
         /* Calculate distance squared in screen space (viewport-relative) */
-        double dx = (double)vp_x - (double)proj_x;
-        double dy = (double)vp_y - (double)proj_y;
+        double dx = (double)vp_x - (double)s_proj_x[i];
+        double dy = (double)vp_y - (double)s_proj_y[i];
         double dist_sq = dx * dx + dy * dy;
         
         if (dist_sq < nearest_dist_sq) {
             nearest_dist_sq = dist_sq;
-            nearest_idx = (int16_t)i;
+            nearest_idx = i;
         }
     }
     
@@ -655,11 +784,11 @@ int CadView_FindPointsAtLocation(const CadView* view, const CadCore* core,
                                  int viewport_w, int viewport_h,
                                  int threshold_pixels,
                                  double world_threshold,
-                                 int16_t* out_indices, int max_count) {
+                                 CadIndex* out_indices, int max_count) {
     if (!view || !core || !out_indices || max_count <= 0) return 0;
     
     /* First, find the nearest point */
-    int16_t nearest_idx = CadView_FindNearestPoint(view, core, screen_x, screen_y,
+    CadIndex nearest_idx = CadView_FindNearestPoint(view, core, screen_x, screen_y,
                                                    viewport_x, viewport_y,
                                                    viewport_w, viewport_h,
                                                    threshold_pixels);
@@ -667,31 +796,14 @@ int CadView_FindPointsAtLocation(const CadView* view, const CadCore* core,
     if (nearest_idx < 0) return 0;
     
     /* Get the world coordinates of the nearest point */
-    const CadPoint* nearest_pt = &core->data.points[nearest_idx];
-    if (nearest_pt->flags == 0) return 0;
-    
-    double ref_x = nearest_pt->pointx;
-    double ref_y = nearest_pt->pointy;
-    double ref_z = nearest_pt->pointz;
-    
-    /* Find all points within world_threshold distance of this point */
-    int count = 0;
-    for (int i = 0; i < core->data.pointCount && i < CAD_MAX_POINTS && count < max_count; i++) {
-        const CadPoint* pt = &core->data.points[i];
-        if (pt->flags == 0) continue; /* Skip invalid points */
-        
-        /* Calculate 3D distance */
-        double dx = pt->pointx - ref_x;
-        double dy = pt->pointy - ref_y;
-        double dz = pt->pointz - ref_z;
-        double dist_sq = dx * dx + dy * dy + dz * dz;
-        
-        if (dist_sq <= world_threshold * world_threshold) {
-            out_indices[count++] = (int16_t)i;
-        }
-    }
+    const CadFileData* data = &core->data;
+    if (data->points[nearest_idx].flags == 0) return 0;
     
-    return count;
+    /* Every live point within world_threshold of it, from the cells around it */
+    int count = CadCore_FindPointsNear(core, data->pointX[nearest_idx], data->pointY[nearest_idx],
+                                       data->pointZ[nearest_idx], world_threshold,
+                                       out_indices, max_count);
+    return count < max_count ? count : max_count;
 }
 
 /* ----------------------------------------------------------------------------
@@ -105,9 +105,20 @@ struct GuiState {
     int last_mouse_x;
     int last_mouse_y;
     
-    /* Point move state */
+    /* Point move state (move / rotate / scale tools 6-11) */
     int point_move_active; /* 1 if currently moving points, 0 otherwise */
     int point_move_view; /* View index where point move started */
+    CadIndex* move_points; /* Unique points being dragged, collected when the drag starts */
+    int move_point_count;
+    double move_center[3]; /* Pivot for rotate / scale: centroid of move_points */
+    
+    /* Face cut state (tool 18) */
+    int cut_active; /* 1 while dragging the cut line */
+    int cut_view; /* Orthographic view the line is drawn in */
+    int cut_x0, cut_y0; /* Screen position the line starts at */
+    
+    /* Primitive tool (22) */
+    CadPrimitive primitive; /* Shape the next click drops (center is set per click) */
     
     /* View window scaling (individual scale per view) */
     float view_scale[4]; /* Scale factor for each view window (default 1.0) */
@@ -117,6 +128,20 @@ struct GuiState {
     int anim_total_frames;  /* Total number of frames */
     int anim_playing;        /* 1 if playing, 0 if paused */
     int anim_loop;          /* 1 if looping, 0 if not */
+    
+    /* File options */
+    int compact_on_save;    /* 1 = pack live elements before every save */
+    
+    /* Merge options */
+    double grid_step;       /* Grid Merge spacing in world units */
+    
+    /* Option > Flat Check */
+    int flat_check;         /* 1 = highlight non-planar faces in every view */
+    
+    /* Edit > Memory snapshots */
+    CadSnapshotStore snapshots;
+    int memory_taken;       /* Snapshots taken so far (names "Memory N") */
+    int memory_recall;      /* Slot restored last by Recall, or -1 */
 };
 
 static int MenuBarHeight(void) { return 20; }
@@ -145,10 +170,14 @@ static const char* fileMenuItems[] = {
 static const char* editMenuItems[] = {
     " Edit",
     "(U)Undo",
+    " Redo",
     " Memory",
+    " Recall",
     " Paste",
     "-",
     " Copy",
+    "-",
+    " Compact",
     NULL
 };
 
@@ -181,6 +210,8 @@ static const char* optionMenuItems[] = {
     "-",
     " Wire Frame",
     " Solid",
+    "-",
+    " Compact on Save",
     NULL
 };
 
@@ -223,10 +254,253 @@ static const char* menu_display_text(const char* s) {
     return s;
 }
 
+/* -------------------------------------------------------------------------
+   Transform tools (6-11: point/face move, rotate, scale)
+   ------------------------------------------------------------------------- */
+
+static const char* tool_action_names[3] = { "move", "rotate", "scale" };
+
+/* Axis a view looks down (0 = X, 1 = Y, 2 = Z); rotations turn about it */
+static int view_axis(const CadView* view) {
+    switch (view->type) {
+    case CAD_VIEW_FRONT: return 2;
+    case CAD_VIEW_RIGHT: return 0;
+    default: return 1; /* Top, and the 3D view turns about the vertical */
+    }
+}
+
+/* Start a drag: the face tools (odd numbers) move the points of the
+   selected faces. The points are collected once here, not every frame. */
+static int begin_point_move(GuiState* g, int view_idx) {
+    int faces = g->selected_tool & 1;
+    int count = CadCore_CollectSelectionPoints(g->cad, faces, NULL, 0);
+    if (count <= 0) return 0;
+    CadIndex* points = (CadIndex*)malloc((size_t)count * sizeof(CadIndex));
+    if (!points) return 0;
+    count = CadCore_CollectSelectionPoints(g->cad, faces, points, count);
+    
+    double cx = 0.0, cy = 0.0, cz = 0.0;
+    for (int i = 0; i < count; i++) {
+        cx += g->cad->data.pointX[points[i]];
+        cy += g->cad->data.pointY[points[i]];
+        cz += g->cad->data.pointZ[points[i]];
+    }
+    g->move_center[0] = cx / count;
+    g->move_center[1] = cy / count;
+    g->move_center[2] = cz / count;
+    
+    free(g->move_points);
+    g->move_points = points;
+    g->move_point_count = count;
+    g->point_move_active = 1;
+    g->point_move_view = view_idx;
+    CadCore_BeginUndoGroup(g->cad); /* The whole drag undoes as one step */
+    return count;
+}
+
+static void end_point_move(GuiState* g) {
+    if (g->point_move_active) CadCore_EndUndoGroup(g->cad);
+    g->point_move_active = 0;
+    g->point_move_view = -1;
+    free(g->move_points);
+    g->move_points = NULL;
+    g->move_point_count = 0;
+}
+
+/* Apply one mouse delta of the active tool to the collected points */
+static void drag_point_move(GuiState* g, int dx, int dy, int viewport_w, int viewport_h) {
+    const CadView* view = &g->views[g->point_move_view];
+    const double* c = g->move_center;
+    double m[12];
+    
+    switch (g->selected_tool) {
+    case 8: case 9: /* Rotate: half a degree per pixel dragged sideways */
+        CadCore_MatrixRotate(m, view_axis(view), dx * M_PI / 360.0, c[0], c[1], c[2]);
+        break;
+    case 10: case 11: /* Scale: grows dragging right or up, 1% per pixel */
+        CadCore_MatrixScale(m, exp((dx - dy) * 0.01), c[0], c[1], c[2]);
+        break;
+    default: { /* Move: follow the mouse in the view plane */
+        double world_dx, world_dy, world_dz;
+        CadView_UnprojectDelta(view, dx, dy, viewport_w, viewport_h, &world_dx, &world_dy, &world_dz);
+        CadCore_MatrixTranslate(m, world_dx, world_dy, world_dz);
+        break;
+    }
+    }
+    CadCore_TransformPoints(g->cad, g->move_points, g->move_point_count, m);
+}
+
+/* Face copy tool (17): copy the selected faces in place, select the
+   copies and drag them away; copy and drag undo as one step */
+static int begin_face_copy(GuiState* g, int view_idx) {
+    CadCore* cad = g->cad;
+    CadIndex first;
+    CadCore_BeginUndoGroup(cad);
+    int copied = CadCore_CopyPolygons(cad, cad->selection.selectedPolygons, cad->selection.polygonCount, NULL, -1,
+                                      &first);
+    if (copied > 0) {
+        CadCore_ClearSelection(cad);
+        for (int k = 0; k < copied; k++) {
+            CadCore_SelectPolygon(cad, first + k);
+        }
+        begin_point_move(g, view_idx);
+    }
+    CadCore_EndUndoGroup(cad); /* Still open while the drag runs */
+    return copied;
+}
+
+/* -------------------------------------------------------------------------
+   Flip tools (14 flip, 15 mirror, 16 face flip): one click in a view
+   ------------------------------------------------------------------------- */
+
+/* World axis running left to right across a view */
+static int view_horizontal_axis(const CadView* view) {
+    return view->type == CAD_VIEW_RIGHT ? 2 : 0;
+}
+
+/* Flip mirrors the selection in place about the middle of its extent,
+   Mirror across the world plane through the origin, both along the view's
+   horizontal axis; faces that mirror whole are turned around with them.
+   Face Flip only turns the selected faces around. */
+static void apply_flip_tool(GuiState* g, int view_idx) {
+    CadCore* cad = g->cad;
+    if (g->selected_tool == 16) {
+        int n = CadCore_ReversePolygons(cad, cad->selection.selectedPolygons, cad->selection.polygonCount);
+        if (n >= 0) fprintf(stdout, "Face Flip: %d faces reversed\n", n);
+        return;
+    }
+    
+    int faces = cad->selectModeFlag == 0;
+    int axis = view_horizontal_axis(&g->views[view_idx]);
+    const double* column = axis == 0 ? cad->data.pointX : cad->data.pointZ;
+    double center = 0.0;
+    if (g->selected_tool == 14) {
+        int count = CadCore_CollectSelectionPoints(cad, faces, NULL, 0);
+        CadIndex* points = count > 0 ? (CadIndex*)malloc((size_t)count * sizeof(CadIndex)) : NULL;
+        if (!points) return;
+        count = CadCore_CollectSelectionPoints(cad, faces, points, count);
+        double lo = column[points[0]], hi = lo;
+        for (int i = 1; i < count; i++) {
+            if (column[points[i]] < lo) lo = column[points[i]];
+            if (column[points[i]] > hi) hi = column[points[i]];
+        }
+        center = (lo + hi) * 0.5;
+        free(points);
+    }
+    
+    int n = CadCore_ReflectSelection(cad, faces, axis, center);
+    if (n > 0) {
+        fprintf(stdout, "%s: %d points mirrored across %c = %g\n", g->selected_tool == 14 ? "Flip" : "Mirror",
+                n, axis == 0 ? 'X' : 'Z', center);
+    }
+}
+
+/* -------------------------------------------------------------------------
+   Face cut tool (18): drag a line across the selected faces in an
+   orthographic view; they are cut by the plane through the line along the
+   view direction
+   ------------------------------------------------------------------------- */
+static void finish_face_cut(GuiState* g, int mouse_x, int mouse_y) {
+    g->cut_active = 0;
+    const CadView* view = &g->views[g->cut_view];
+    Rect vr = g->view[g->cut_view].r;
+    Rect content = (Rect){ vr.x + 6, vr.y + 26, vr.w - 12, vr.h - 32 };
+    
+    double a[3], b[3];
+    CadView_UnprojectPoint(view, g->cut_x0 - content.x, g->cut_y0 - content.y, content.w, content.h,
+                           &a[0], &a[1], &a[2]);
+    CadView_UnprojectPoint(view, mouse_x - content.x, mouse_y - content.y, content.w, content.h,
+                           &b[0], &b[1], &b[2]);
+    
+    /* Normal = line direction x view direction */
+    double d[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    double e[3] = { 0.0, 0.0, 0.0 };
+    e[view_axis(view)] = 1.0;
+    double n[3] = { d[1] * e[2] - d[2] * e[1], d[2] * e[0] - d[0] * e[2], d[0] * e[1] - d[1] * e[0] };
+    double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (!(len > 1e-9)) return;
+    double plane[4] = { n[0] / len, n[1] / len, n[2] / len, 0.0 };
+    plane[3] = plane[0] * a[0] + plane[1] * a[1] + plane[2] * a[2];
+    
+    int cut_points;
+    int split = CadCore_CutPolygons(g->cad, g->cad->selection.selectedPolygons, g->cad->selection.polygonCount,
+                                    plane, &cut_points);
+    if (split >= 0) fprintf(stdout, "Face Cut: %d faces split, %d cut points\n", split, cut_points);
+}
+
+/* -------------------------------------------------------------------------
+   Primitive tool (22): a click in the Top, Front or Right view drops the
+   current primitive there, selected; a click in the 3D view switches to
+   the next shape
+   ------------------------------------------------------------------------- */
+static const char* primitive_names[CAD_PRIMITIVE_COUNT] = { "Box", "Cylinder", "Sphere", "Cone", "Grid" };
+
+static void place_primitive(GuiState* g, int view_idx, int vp_x, int vp_y, int w, int h) {
+    CadPrimitive* pr = &g->primitive;
+    if (g->views[view_idx].type == CAD_VIEW_3D) {
+        pr->type = (CadPrimitiveType)((pr->type + 1) % CAD_PRIMITIVE_COUNT);
+        fprintf(stdout, "Primitive: %s\n", primitive_names[pr->type]);
+        return;
+    }
+    
+    CadView_UnprojectPoint(&g->views[view_idx], vp_x, vp_y, w, h, &pr->center[0], &pr->center[1], &pr->center[2]);
+    CadIndex first;
+    int faces = CadCore_AddPrimitive(g->cad, INVALID_INDEX, pr, &first);
+    if (faces <= 0) return;
+    CadCore_ClearSelection(g->cad);
+    for (int k = 0; k < faces; k++) {
+        CadCore_SelectPolygon(g->cad, first + k);
+    }
+    fprintf(stdout, "%s: %d faces at (%.2f, %.2f, %.2f)\n", primitive_names[pr->type], faces,
+            pr->center[0], pr->center[1], pr->center[2]);
+}
+
+/* -------------------------------------------------------------------------
+   Animation window copy buttons: AllCopy copies every face of the current
+   frame, PartCopy the selected faces, into a new last frame, which then
+   becomes current
+   ------------------------------------------------------------------------- */
+
+/* Hit areas, matching the layout gui_draw uses */
+static void anim_copy_buttons(const GuiState* g, Rect* all_copy, Rect* part_copy) {
+    Rect ar = g->animationWindow.r;
+    int right_x = ar.x + 6 + (ar.w - 12) - 120;
+    int copy_y = ar.y + 26 + 8 + 25 + 30 + 35 + 35; /* Below frame counter, loop, Add and delete */
+    *all_copy = (Rect){ right_x - 2, copy_y - 2, 110, 34 };
+    *part_copy = (Rect){ right_x, copy_y + 35 + 20, 110, 18 };
+}
+
+static void copy_to_new_frame(GuiState* g, int all) {
+    CadCore* cad = g->cad;
+    int frame = g->anim_total_frames > g->anim_current_frame ? g->anim_total_frames : g->anim_current_frame + 1;
+    CadIndex* faces = cad->selection.selectedPolygons;
+    int count = cad->selection.polygonCount;
+    if (all) {
+        faces = (CadIndex*)malloc((size_t)(cad->live.polygonCount > 0 ? cad->live.polygonCount : 1) * sizeof(CadIndex));
+        if (!faces) return;
+        count = 0;
+        for (CadIndex p = CadCore_NextLivePolygon(cad, 0); p != INVALID_INDEX; p = CadCore_NextLivePolygon(cad, p + 1)) {
+            if (cad->data.polygons[p].animation == g->anim_current_frame) faces[count++] = p;
+        }
+    }
+    int copied = CadCore_CopyPolygons(cad, faces, count, NULL, frame, NULL);
+    if (all) free(faces);
+    if (copied <= 0) return;
+    g->anim_total_frames = frame + 1;
+    g->anim_current_frame = frame;
+    fprintf(stdout, "%s: %d faces copied to frame %d\n", all ? "AllCopy" : "PartCopy", copied, frame);
+}
+
 /* -------------------------------------------------------------------------
    Menu action handlers
    ------------------------------------------------------------------------- */
 
+/* Save through the core, compacting first when the option is on */
+static int save_cad_file(GuiState* g, const char* filename) {
+    if (g->compact_on_save && !CadCore_Compact(g->cad, NULL)) return 0;
+    return CadCore_SaveFile(g->cad, filename);
+}
+
 static void handle_file_menu_action(GuiState* g, int item_index) {
     if (!g || !g->cad) return;
     
@@ -246,8 +520,8 @@ static void handle_file_menu_action(GuiState* g, int item_index) {
         if (FileDialog_OpenCAD(filename, sizeof(filename))) {
             /* Clear all state before loading */
             CadCore_ClearSelection(g->cad);
-            g->point_move_active = 0;
-            g->point_move_view = -1;
+            end_point_move(g);
+            g->cut_active = 0;
             g->view_interacting = -1;
             g->view_right_interacting = -1;
             
@@ -269,7 +543,7 @@ static void handle_file_menu_action(GuiState* g, int item_index) {
     case 3: /* (S)Save */
         if (g->current_filename[0] != '\0') {
             /* Save to current filename */
-            if (CadCore_SaveFile(g->cad, g->current_filename)) {
+            if (save_cad_file(g, g->current_filename)) {
                 fprintf(stdout, "Saved file: %s\n", g->current_filename);
             } else {
                 fprintf(stderr, "Error: Failed to save file: %s\n", g->current_filename);
@@ -277,7 +551,7 @@ static void handle_file_menu_action(GuiState* g, int item_index) {
         } else {
             /* No current filename, use Save As */
             if (FileDialog_SaveCAD(filename, sizeof(filename))) {
-                if (CadCore_SaveFile(g->cad, filename)) {
+                if (save_cad_file(g, filename)) {
                     strncpy(g->current_filename, filename, sizeof(g->current_filename) - 1);
                     g->current_filename[sizeof(g->current_filename) - 1] = '\0';
                     fprintf(stdout, "Saved file: %s\n", filename);
@@ -289,7 +563,7 @@ static void handle_file_menu_action(GuiState* g, int item_index) {
         break;
     case 4: /* Save As... */
         if (FileDialog_SaveCAD(filename, sizeof(filename))) {
-            if (CadCore_SaveFile(g->cad, filename)) {
+            if (save_cad_file(g, filename)) {
                 strncpy(g->current_filename, filename, sizeof(g->current_filename) - 1);
                 g->current_filename[sizeof(g->current_filename) - 1] = '\0';
                 fprintf(stdout, "Saved file: %s\n", filename);
@@ -321,7 +595,10 @@ static void handle_file_menu_action(GuiState* g, int item_index) {
             if (FileDialog_Save(filename, sizeof(filename), 
                               "TXT Files\0*.txt\0All Files\0*.*\0", 
                               "Export 3DG1")) {
-                if (CadExport_3DG1(g->cad, filename)) {
+                /* A sorted model is written back to front from the 3D view's camera */
+                double eye[3];
+                CadView_GetEyePosition(&g->views[1], 1.0e7, eye);
+                if (CadExport_3DG1(g->cad, filename, eye)) {
                     fprintf(stdout, "Exported to: %s\n", filename);
                 } else {
                     fprintf(stderr, "Error: Failed to export 3DG1 file\n");
@@ -354,22 +631,74 @@ static void handle_file_menu_action(GuiState* g, int item_index) {
     }
 }
 
+/* Snapshot taken just before the one in slot 'from' (the newest when from
+   is -1 or the oldest), or -1 when none are stored */
+static int previous_snapshot(const CadSnapshotStore* store, int from) {
+    int best = -1;
+    int newest = -1;
+    for (int s = 0; s < CAD_SNAPSHOT_SLOTS; s++) {
+        if (!store->slots[s].used) continue;
+        uint32_t serial = store->slots[s].serial;
+        if (newest < 0 || (int32_t)(serial - store->slots[newest].serial) > 0) newest = s;
+        if (from >= 0 && store->slots[from].used &&
+            (int32_t)(serial - store->slots[from].serial) < 0 &&
+            (best < 0 || (int32_t)(serial - store->slots[best].serial) > 0)) {
+            best = s;
+        }
+    }
+    return best >= 0 ? best : newest;
+}
+
 static void handle_edit_menu_action(GuiState* g, int item_index) {
     if (!g || !g->cad) return;
     
     switch (item_index) {
     case 1: /* (U)Undo */
-        fprintf(stdout, "Undo (not implemented yet)\n");
+        if (!CadCore_Undo(g->cad)) fprintf(stdout, "Nothing to undo\n");
+        break;
+    case 2: /* Redo */
+        if (!CadCore_Redo(g->cad)) fprintf(stdout, "Nothing to redo\n");
         break;
-    case 2: /* Memory */
-        fprintf(stdout, "Memory (not implemented yet)\n");
+    case 3: /* Memory */
+        {
+            char name[CAD_SNAPSHOT_NAME];
+            snprintf(name, sizeof(name), "Memory %d", g->memory_taken + 1);
+            if (CadCore_TakeSnapshot(g->cad, &g->snapshots, name) >= 0) {
+                g->memory_taken++;
+                g->memory_recall = -1;
+                fprintf(stdout, "Stored %s\n", name);
+            }
+        }
+        break;
+    case 4: /* Recall */
+        {
+            int slot = previous_snapshot(&g->snapshots, g->memory_recall);
+            if (slot < 0) {
+                fprintf(stdout, "No memory stored\n");
+            } else if (CadCore_RestoreSnapshot(g->cad, &g->snapshots, slot)) {
+                g->memory_recall = slot;
+                fprintf(stdout, "Recalled %s\n", g->snapshots.slots[slot].name);
+            }
+        }
         break;
-    case 3: /* Paste */
+    case 5: /* Paste */
         fprintf(stdout, "Paste (not implemented yet)\n");
         break;
-    case 5: /* Copy */
+    case 7: /* Copy */
         fprintf(stdout, "Copy (not implemented yet)\n");
         break;
+    case 9: /* Compact */
+        {
+            int points = g->cad->data.pointCount;
+            int polygons = g->cad->data.polygonCount;
+            int objects = g->cad->data.objectCount;
+            if (CadCore_Compact(g->cad, NULL)) {
+                fprintf(stdout, "Compacted: %d -> %d points, %d -> %d polygons, %d -> %d objects\n",
+                        points, g->cad->data.pointCount, polygons, g->cad->data.polygonCount,
+                        objects, g->cad->data.objectCount);
+            }
+        }
+        break;
     }
 }
 
@@ -509,7 +838,26 @@ static void handle_option_menu_action(GuiState* g, int item_index) {
         fprintf(stdout, "Change Point (not implemented yet)\n");
         break;
     case 4: /* Flat Check */
-        fprintf(stdout, "Flat Check (not implemented yet)\n");
+        /* Toggle the highlight; switching on reports the worst offenders */
+        g->flat_check = !g->flat_check;
+        if (g->flat_check) {
+            CadIndex warped[10];
+            int count = CadCore_FlatCheck(g->cad, CAD_FLAT_TOLERANCE, warped, 10);
+            if (count < 0) {
+                g->flat_check = 0;
+                break;
+            }
+            fprintf(stdout, "Flat Check: %d non-planar faces (tolerance %g)\n", count, CAD_FLAT_TOLERANCE);
+            for (int i = 0; i < count && i < 10; i++) {
+                fprintf(stdout, "  Polygon %d: deviation %.4f\n", (int)warped[i],
+                        CadCore_GetPolygonDeviation(g->cad, warped[i]));
+            }
+        } else {
+            fprintf(stdout, "Flat Check off\n");
+        }
+        for (int i = 0; i < 4; i++) {
+            g->views[i].flat_highlight = g->flat_check ? CAD_FLAT_TOLERANCE : 0.0;
+        }
         break;
     case 5: /* F.Support */
         fprintf(stdout, "Face Support toggle (not implemented yet)\n");
@@ -531,6 +879,10 @@ static void handle_option_menu_action(GuiState* g, int item_index) {
         }
         fprintf(stdout, "Solid mode enabled\n");
         break;
+    case 11: /* Compact on Save */
+        g->compact_on_save = !g->compact_on_save;
+        fprintf(stdout, "Compact on Save: %s\n", g->compact_on_save ? "on" : "off");
+        break;
     }
 }
 
@@ -539,22 +891,39 @@ static void handle_merge_menu_action(GuiState* g, int item_index) {
     
     switch (item_index) {
     case 1: /* Merge */
-        fprintf(stdout, "Merge coordinates (not implemented yet)\n");
+        fprintf(stdout, "Merge: %d elements snapped to integers\n",
+                CadCore_SnapCoordinates(g->cad, 1.0));
         break;
     case 2: /* Grid Merge */
-        fprintf(stdout, "Grid Merge (not implemented yet)\n");
+        fprintf(stdout, "Grid Merge: %d elements snapped to a %g grid\n",
+                CadCore_SnapCoordinates(g->cad, g->grid_step), g->grid_step);
         break;
     case 3: /* Point Merge */
-        fprintf(stdout, "Point Merge (not implemented yet)\n");
+        {
+            int merged = CadCore_MergePoints(g->cad);
+            if (merged >= 0) fprintf(stdout, "Point Merge: %d points merged\n", merged);
+        }
         break;
     case 4: /* Polygon Merge */
-        fprintf(stdout, "Polygon Merge (not implemented yet)\n");
+        {
+            int before, after;
+            if (CadCore_MergePolygons(g->cad, &before, &after) >= 0) {
+                fprintf(stdout, "Polygon Merge: %d polygons -> %d\n", before, after);
+            }
+        }
         break;
     case 5: /* All Merge */
         fprintf(stdout, "All Merge (not implemented yet)\n");
         break;
     case 7: /* Polygon Sort */
-        fprintf(stdout, "Polygon Sort (not implemented yet)\n");
+        {
+            int splits = CadCore_SortPolygons(g->cad);
+            const CadBspTree* tree = CadCore_GetBspTree(g->cad);
+            if (splits >= 0 && tree) {
+                fprintf(stdout, "Polygon Sort: %d faces in %d nodes, %d faces split\n",
+                        tree->faceCount, tree->nodeCount, splits);
+            }
+        }
         break;
     }
 }
@@ -580,6 +949,9 @@ GuiState* gui_create(void) {
     if (g->cad) {
         CadCore_Init(g->cad);
     }
+    CadCore_InitSnapshots(&g->snapshots);
+    g->memory_recall = -1;
+    g->grid_step = 10.0;
     
     /* Initialize current filename */
     g->current_filename[0] = '\0';
@@ -609,6 +981,14 @@ GuiState* gui_create(void) {
     g->selected_tool = -1; /* No tool selected initially */
     g->point_move_active = 0;
     g->point_move_view = -1;
+    g->move_points = NULL;
+    g->move_point_count = 0;
+    g->cut_active = 0;
+    g->cut_view = -1;
+    g->primitive.type = CAD_PRIMITIVE_BOX;
+    g->primitive.size[0] = g->primitive.size[1] = g->primitive.size[2] = 100.0;
+    g->primitive.segments = 16;
+    g->primitive.rings = 8;
     g->view_interacting = -1;
     g->view_right_interacting = -1;
     
@@ -664,6 +1044,8 @@ void gui_destroy(GuiState* g) {
         CadCore_Destroy(g->cad);
         free(g->cad);
     }
+    CadCore_FreeSnapshots(&g->snapshots);
+    free(g->move_points);
     /* Free tool icons */
     for (int i = 0; i < TOOL_COUNT; i++) {
         if (g->tool_icons[i]) {
@@ -862,8 +1244,8 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
         g->resize_edge = 0;
         g->view_interacting = -1;
         g->view_right_interacting = -1;
-        g->point_move_active = 0;
-        g->point_move_view = -1;
+        end_point_move(g);
+        if (g->cut_active) finish_face_cut(g, in->mouse_x, in->mouse_y);
     } else if (g->resize_win) {
         /* Handle window resizing */
         int dx = in->mouse_x - g->resize_start_x;
@@ -921,29 +1303,9 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
         int dy = in->mouse_y - g->last_mouse_y;
         
         if (dx != 0 || dy != 0) {
-            CadView* view = &g->views[g->point_move_view];
             Rect vr = g->view[g->point_move_view].r;
             Rect content = (Rect){ vr.x + 6, vr.y + 26, vr.w - 12, vr.h - 32 };
-            
-            /* Convert screen delta to world delta */
-            double world_dx, world_dy, world_dz;
-            CadView_UnprojectDelta(view, dx, dy, content.w, content.h,
-                                  &world_dx, &world_dy, &world_dz);
-            
-            /* Apply movement to all selected points */
-            for (int i = 0; i < g->cad->selection.pointCount; i++) {
-                int16_t point_idx = g->cad->selection.selectedPoints[i];
-                if (point_idx < 0) continue;
-                
-                CadPoint* pt = CadCore_GetPoint(g->cad, point_idx);
-                if (!pt) continue;
-                
-                pt->pointx += world_dx;
-                pt->pointy += world_dy;
-                pt->pointz += world_dz;
-            }
-            
-            g->cad->isDirty = 1; /* Mark as modified */
+            drag_point_move(g, dx, dy, content.w, content.h);
         }
         
         g->last_mouse_x = in->mouse_x;
@@ -1027,8 +1389,19 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
     }
     
     
+    /* Animation window clicks (the window sits above the views) */
+    int anim_clicked = 0;
+    if (in->mouse_pressed && !g->drag_win && !g->resize_win && g->animationWindow.r.w > 0 &&
+        g->animationWindow.r.h > 0 && pt_in_rect(in->mouse_x, in->mouse_y, g->animationWindow.r)) {
+        Rect all_copy, part_copy;
+        anim_copy_buttons(g, &all_copy, &part_copy);
+        if (pt_in_rect(in->mouse_x, in->mouse_y, all_copy)) copy_to_new_frame(g, 1);
+        else if (pt_in_rect(in->mouse_x, in->mouse_y, part_copy)) copy_to_new_frame(g, 0);
+        anim_clicked = 1;
+    }
+    
     /* Check for view content area clicks (not title bar) - includes right-click for make tool */
-    if ((in->mouse_pressed || (make_tool_active && in->mouse_right_pressed)) && !g->drag_win && !g->resize_win && g->view_interacting < 0 && g->view_right_interacting < 0) {
+    if ((in->mouse_pressed || (make_tool_active && in->mouse_right_pressed)) && !anim_clicked && !g->drag_win && !g->resize_win && g->view_interacting < 0 && g->view_right_interacting < 0) {
         for (int i = 0; i < 4; i++) {
             Rect vr = g->view[i].r;
             Rect content = (Rect){ vr.x + 6, vr.y + 26, vr.w - 12, vr.h - 32 };
@@ -1050,7 +1423,7 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                         /* Make tool - left click adds points, right click selects final point and creates face */
                         if (in->mouse_pressed) {
                             /* Left click - add point to selection */
-                            int16_t point_to_select = CadView_FindNearestPoint(
+                            CadIndex point_to_select = CadView_FindNearestPoint(
                                 &g->views[i], g->cad,
                                 in->mouse_x, in->mouse_y,
                                 viewport_x, viewport_y,
@@ -1075,7 +1448,7 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                             }
                         } else if (in->mouse_right_pressed) {
                             /* Right click - select final point and create face */
-                            int16_t final_point = CadView_FindNearestPoint(
+                            CadIndex final_point = CadView_FindNearestPoint(
                                 &g->views[i], g->cad,
                                 in->mouse_x, in->mouse_y,
                                 viewport_x, viewport_y,
@@ -1101,10 +1474,10 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                                     CadCore_ClearSelection(g->cad);
                                 } else {
                                     /* Get all selected points */
-                                    int16_t selected_points[12];
+                                    CadIndex selected_points[12];
                                     int valid_count = 0;
                                     for (int j = 0; j < point_count && j < 12; j++) {
-                                        int16_t pt_idx = g->cad->selection.selectedPoints[j];
+                                        CadIndex pt_idx = g->cad->selection.selectedPoints[j];
                                         if (pt_idx >= 0 && CadCore_IsPointValid(g->cad, pt_idx)) {
                                             selected_points[valid_count++] = pt_idx;
                                         }
@@ -1114,42 +1487,20 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                                         fprintf(stderr, "Need at least 2 valid points to create a face\n");
                                         CadCore_ClearSelection(g->cad);
                                     } else {
-                                        int16_t p1 = selected_points[0];
+                                        CadIndex p1 = selected_points[0];
                                         
-                                        /* Check if a polygon with these exact points already exists */
+                                        /* Check if a polygon with these exact points already exists.
+                                           A match starts at p1, so only p1's users need comparing. */
                                         int polygon_exists = 0;
-                                        for (int poly_i = 0; poly_i < g->cad->data.polygonCount; poly_i++) {
-                                            CadPolygon* existing_poly = CadCore_GetPolygon(g->cad, poly_i);
-                                            if (!existing_poly || existing_poly->flags == 0) continue;
-                                            if (existing_poly->npoints != valid_count) continue;
-                                            
-                                            /* Traverse the polygon's point chain */
-                                            int16_t chain_points[12];
-                                            int16_t current = existing_poly->firstPoint;
-                                            int count = 0;
-                                            int visited_count = 0;
-                                            int16_t visited[64];
-                                            
-                                            while (current >= 0 && current < CAD_MAX_POINTS && count < valid_count && visited_count < 64) {
-                                                /* Cycle detection */
-                                                int already_visited = 0;
-                                                for (int v = 0; v < visited_count; v++) {
-                                                    if (visited[v] == current) {
-                                                        already_visited = 1;
-                                                        break;
-                                                    }
-                                                }
-                                                if (already_visited) break;
-                                                visited[visited_count++] = current;
-                                                
-                                                chain_points[count++] = current;
-                                                
-                                                CadPoint* curr_pt = CadCore_GetPoint(g->cad, current);
-                                                if (!curr_pt || curr_pt->flags == 0) break;
-                                                current = curr_pt->nextPoint;
-                                            }
+                                        const CadPolygonIndex* poly_index = CadCore_GetPolygonIndex(g->cad);
+                                        const CadAdjacency* adj = &g->cad->adjacency;
+                                        for (CadIndex n = adj->pointFirstUse[p1]; poly_index && n != INVALID_INDEX; n = adj->nodes[n].nextInPoint) {
+                                            CadIndex poly_i = adj->nodes[n].polygon;
+                                            if (g->cad->data.polygons[poly_i].npoints != valid_count) continue;
                                             
                                             /* Check if this polygon has the same points in the same order */
+                                            const CadIndex* chain_points = &poly_index->vertices[poly_index->offsets[poly_i]];
+                                            int count = poly_index->offsets[poly_i + 1] - poly_index->offsets[poly_i];
                                             if (count == valid_count) {
                                                 int match = 1;
                                                 for (int k = 0; k < valid_count; k++) {
@@ -1169,24 +1520,24 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                                             fprintf(stderr, "Polygon with these points already exists\n");
                                             CadCore_ClearSelection(g->cad);
                                         } else {
-                                            /* Create polygon with first point */
-                                            int16_t poly_idx = CadCore_AddPolygon(g->cad, p1, 0, valid_count);
+                                            /* Create polygon with first point (polygon and links undo as one step) */
+                                            CadCore_BeginUndoGroup(g->cad);
+                                            CadIndex poly_idx = CadCore_AddPolygon(g->cad, p1, 0, valid_count);
                                             
                                             if (poly_idx != INVALID_INDEX) {
                                                 /* Link the points together */
                                                 for (int j = 0; j < valid_count; j++) {
-                                                    int16_t current_pt = selected_points[j];
-                                                    int16_t next_pt = (j < valid_count - 1) ? selected_points[j + 1] : INVALID_INDEX;
+                                                    CadIndex current_pt = selected_points[j];
+                                                    CadIndex next_pt = (j < valid_count - 1) ? selected_points[j + 1] : INVALID_INDEX;
                                                     
                                                     CadPoint* pt = CadCore_GetPoint(g->cad, current_pt);
                                                     if (!pt) continue;
                                                     
                                                     /* Check if this point is already used as firstPoint of another polygon */
                                                     int is_firstPoint = 0;
-                                                    for (int poly_i = 0; poly_i < g->cad->data.polygonCount; poly_i++) {
-                                                        CadPolygon* existing_poly = CadCore_GetPolygon(g->cad, poly_i);
-                                                        if (!existing_poly || existing_poly->flags == 0) continue;
-                                                        if (existing_poly->firstPoint == current_pt && poly_i != poly_idx) {
+                                                    for (CadIndex n = adj->pointFirstUse[current_pt]; n != INVALID_INDEX; n = adj->nodes[n].nextInPoint) {
+                                                        CadIndex poly_i = adj->nodes[n].polygon;
+                                                        if (g->cad->data.polygons[poly_i].firstPoint == current_pt && poly_i != poly_idx) {
                                                             is_firstPoint = 1;
                                                             break;
                                                         }
@@ -1195,7 +1546,7 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                                                     /* Only set nextPoint if not already a firstPoint, or if nextPoint matches what we want */
                                                     if (!is_firstPoint) {
                                                         if (pt->nextPoint == INVALID_INDEX || pt->nextPoint == next_pt) {
-                                                            pt->nextPoint = next_pt;
+                                                            CadCore_SetNextPoint(g->cad, current_pt, next_pt);
                                                         }
                                                     } else if (pt->nextPoint == next_pt) {
                                                         /* Already matches, no change needed */
@@ -1210,6 +1561,7 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                                             } else {
                                                 fprintf(stderr, "Failed to create polygon (no free slots)\n");
                                             }
+                                            CadCore_EndUndoGroup(g->cad);
                                         }
                                     }
                                 }
@@ -1217,7 +1569,7 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                         }
                     } else {
                         /* Normal point select tool - find all points at the same location (handles merged points) */
-                        int16_t point_indices[64]; /* Max 64 points at same location */
+                        CadIndex point_indices[64]; /* Max 64 points at same location */
                         int point_count = CadView_FindPointsAtLocation(
                             &g->views[i], g->cad,
                             in->mouse_x, in->mouse_y,
@@ -1270,7 +1622,7 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                     );
                     
                     /* Add the point */
-                    int16_t new_point_idx = CadCore_AddPoint(g->cad, world_x, world_y, world_z);
+                    CadIndex new_point_idx = CadCore_AddPoint(g->cad, world_x, world_y, world_z);
                     if (new_point_idx != INVALID_INDEX) {
                         /* Select the newly added point */
                         CadCore_SelectPoint(g->cad, new_point_idx);
@@ -1279,13 +1631,33 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                     } else {
                         fprintf(stderr, "Failed to add point (no free slots)\n");
                     }
-                } else if (g->selected_tool == 6 && g->cad->selection.pointCount > 0) {
-                    /* Point move tool (tool 6) - start moving selected points */
-                    g->point_move_active = 1;
-                    g->point_move_view = i;
+                } else if (g->selected_tool == 18) {
+                    /* Face cut tool - start the cut line (orthographic views only) */
+                    if (g->views[i].type == CAD_VIEW_3D) {
+                        fprintf(stdout, "Face Cut: drag the cut line in the Top, Front or Right view\n");
+                    } else {
+                        g->cut_active = 1;
+                        g->cut_view = i;
+                        g->cut_x0 = in->mouse_x;
+                        g->cut_y0 = in->mouse_y;
+                    }
+                } else if (g->selected_tool == 17 && begin_face_copy(g, i) > 0) {
+                    /* Face copy tool - drag the fresh copies */
+                    g->last_mouse_x = in->mouse_x;
+                    g->last_mouse_y = in->mouse_y;
+                    fprintf(stdout, "Face Copy: %d faces copied\n", g->cad->selection.polygonCount);
+                } else if (g->selected_tool == 22) {
+                    /* Primitive tool - drop the current shape at the clicked point */
+                    place_primitive(g, i, in->mouse_x - content.x, in->mouse_y - content.y, content.w, content.h);
+                } else if (g->selected_tool >= 14 && g->selected_tool <= 16) {
+                    /* Flip / mirror / face flip tools - apply once per click */
+                    apply_flip_tool(g, i);
+                } else if (g->selected_tool >= 6 && g->selected_tool <= 11 && begin_point_move(g, i) > 0) {
+                    /* Move / rotate / scale tools (6-11) - drag the selection */
                     g->last_mouse_x = in->mouse_x;
                     g->last_mouse_y = in->mouse_y;
-                    fprintf(stdout, "Starting point move (%d points selected)\n", g->cad->selection.pointCount);
+                    fprintf(stdout, "Starting %s (%d points)\n", tool_action_names[(g->selected_tool - 6) / 2],
+                            g->move_point_count);
                 } else {
                     /* Normal view interaction (pan/rotate) */
                     g->view_interacting = i;
@@ -1340,6 +1712,11 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                 Rect btn_rect = { x, y, button_w, button_h };
                 
                 if (pt_in_rect(in->mouse_x, in->mouse_y, btn_rect)) {
+                    if (i == TOOL_COUNT - 1) {
+                        /* UNDO is a one-shot button, not a mode */
+                        if (!CadCore_Undo(g->cad)) fprintf(stdout, "Nothing to undo\n");
+                        break;
+                    }
                     g->selected_tool = (g->selected_tool == i) ? -1 : i; /* Toggle selection */
                     
                     /* Set edit mode based on selected tool */
@@ -1356,10 +1733,33 @@ void gui_update(GuiState* g, const GuiInput* in, int win_w, int win_h) {
                         CadCore_ClearSelection(g->cad);
                         CadCore_SetEditMode(g->cad, CAD_MODE_SELECT_POINT);
                         fprintf(stdout, "Make tool activated - left-click to add points, right-click to finalize face (2-12 points)\n");
-                    } else if (g->selected_tool == 6) {
-                        /* Point move tool */
-                        CadCore_SetEditMode(g->cad, CAD_MODE_EDIT_POINT);
-                        fprintf(stdout, "Point move tool activated\n");
+                    } else if (g->selected_tool >= 6 && g->selected_tool <= 11) {
+                        /* Move / rotate / scale: even tools act on points, odd on faces */
+                        int faces = g->selected_tool & 1;
+                        CadCore_SetEditMode(g->cad, faces ? CAD_MODE_EDIT_POLYGON : CAD_MODE_EDIT_POINT);
+                        fprintf(stdout, "%s %s tool activated\n", faces ? "Face" : "Point",
+                                tool_action_names[(g->selected_tool - 6) / 2]);
+                    } else if (g->selected_tool == 14 || g->selected_tool == 15) {
+                        /* Flip / mirror act on points or faces, as currently selected */
+                        fprintf(stdout, "%s tool activated - click a view to mirror the selection along its horizontal axis\n",
+                                g->selected_tool == 14 ? "Flip" : "Mirror");
+                    } else if (g->selected_tool == 16) {
+                        /* Face flip tool */
+                        CadCore_SetEditMode(g->cad, CAD_MODE_EDIT_POLYGON);
+                        fprintf(stdout, "Face flip tool activated - click a view to reverse the selected faces\n");
+                    } else if (g->selected_tool == 17) {
+                        /* Face copy tool */
+                        CadCore_SetEditMode(g->cad, CAD_MODE_EDIT_POLYGON);
+                        fprintf(stdout, "Face copy tool activated - drag in a view to copy the selected faces and move the copies\n");
+                    } else if (g->selected_tool == 18) {
+                        /* Face cut tool */
+                        CadCore_SetEditMode(g->cad, CAD_MODE_EDIT_POLYGON);
+                        fprintf(stdout, "Face cut tool activated - drag a line across the selected faces in an orthographic view\n");
+                    } else if (g->selected_tool == 22) {
+                        /* Primitive tool - new shapes come out selected as faces */
+                        CadCore_SetEditMode(g->cad, CAD_MODE_EDIT_POLYGON);
+                        fprintf(stdout, "Primitive tool activated (%s) - click an orthographic view to place it, the 3D view to change shape\n",
+                                primitive_names[g->primitive.type]);
                     } else if (g->selected_tool == -1) {
                         /* No tool selected - keep current mode */
                     }
@@ -1645,6 +2045,10 @@ static void gui_draw_view_info_bar(GuiState* g, int view_idx, const GuiInput* in
 static void gui_draw_cad_views(GuiState* g, int win_w, int win_h, int fb_w, int fb_h, const GuiInput* in) {
     if (!g || !g->cad) return;
     
+    /* Flat Check highlight reads the cache; this recomputes only faces
+       edited since the last frame */
+    if (g->flat_check) CadCore_FlatCheck(g->cad, CAD_FLAT_TOLERANCE, NULL, 0);
+    
     /* Calculate scale factors for coordinate conversion */
     float scale_x = (fb_w > 0 && win_w > 0) ? (float)fb_w / (float)win_w : 1.0f;
     float scale_y = (fb_h > 0 && win_h > 0) ? (float)fb_h / (float)win_h : 1.0f;
@@ -1682,11 +2086,20 @@ static void gui_draw_cad_views(GuiState* g, int win_w, int win_h, int fb_w, int
         glDisable(GL_DEPTH_TEST);
         glDisable(GL_CULL_FACE);
         
+        /* Face cut line being dragged */
+        if (g->cut_active && g->cut_view == i && in) {
+            RG_Color cut = { 224,48,48,255 };
+            rg_line(g->cut_x0, g->cut_y0, in->mouse_x, in->mouse_y, cut);
+        }
+        
         /* Draw info bar for this view */
         if (in) {
             gui_draw_view_info_bar(g, i, in, win_w, win_h, fb_w, fb_h);
         }
     }
+    
+    /* Every view has caught up with this frame's edits */
+    CadCore_ClearDirtyRanges(g->cad);
 }
 
 /* ============================================================================
@@ -1745,15 +2158,15 @@ void gui_draw(GuiState* g, const GuiInput* in, int win_w, int win_h, int fb_w, i
             int valid_count = 0;
             
             for (int i = 0; i < g->cad->selection.pointCount; i++) {
-                int16_t point_idx = g->cad->selection.selectedPoints[i];
+                CadIndex point_idx = g->cad->selection.selectedPoints[i];
                 if (point_idx < 0) continue;
                 
-                CadPoint* pt = CadCore_GetPoint(g->cad, point_idx);
-                if (!pt) continue;
+                double px, py, pz;
+                if (!CadCore_GetPointPosition(g->cad, point_idx, &px, &py, &pz)) continue;
                 
-                avg_x += pt->pointx;
-                avg_y += pt->pointy;
-                avg_z += pt->pointz;
+                avg_x += px;
+                avg_y += py;
+                avg_z += pz;
                 valid_count++;
             }
             
@@ -1768,15 +2181,15 @@ void gui_draw(GuiState* g, const GuiInput* in, int win_w, int win_h, int fb_w, i
                 
                 if (valid_count > 1) {
                     for (int i = 0; i < g->cad->selection.pointCount; i++) {
-                        int16_t point_idx = g->cad->selection.selectedPoints[i];
+                        CadIndex point_idx = g->cad->selection.selectedPoints[i];
                         if (point_idx < 0) continue;
                         
-                        CadPoint* pt = CadCore_GetPoint(g->cad, point_idx);
-                        if (!pt) continue;
+                        double px, py, pz;
+                        if (!CadCore_GetPointPosition(g->cad, point_idx, &px, &py, &pz)) continue;
                         
-                        double dx = pt->pointx - avg_x;
-                        double dy = pt->pointy - avg_y;
-                        double dz = pt->pointz - avg_z;
+                        double dx = px - avg_x;
+                        double dy = py - avg_y;
+                        double dz = pz - avg_z;
                         double dist_sq = dx * dx + dy * dy + dz * dz;
                         
                         if (dist_sq > location_threshold * location_threshold) {
@@ -1800,6 +2213,18 @@ void gui_draw(GuiState* g, const GuiInput* in, int win_w, int win_h, int fb_w, i
             snprintf(coord_str, sizeof(coord_str), "No points selected");
         }
         font_draw(g->font, cinner.x + 8, cinner.y + 6, coord_str, 0);
+        
+        /* Merge status is kept up to date by the core, so it is cheap per frame */
+        int off_points, off_objects, duplicates;
+        char merge_str[128];
+        CadCore_GetMergeStatus(g->cad, &off_points, &off_objects, &duplicates);
+        if (off_points == 0 && off_objects == 0 && duplicates == 0) {
+            snprintf(merge_str, sizeof(merge_str), "Fully merged");
+        } else {
+            snprintf(merge_str, sizeof(merge_str), "Off grid: %d points, %d objects   Duplicate edges: %d",
+                     off_points, off_objects, duplicates);
+        }
+        font_draw(g->font, cinner.x + 8, cinner.y + 10 + font_height(g->font), merge_str, 0);
     }
     
     /* Draw animation window content */